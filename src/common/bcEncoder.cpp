@@ -0,0 +1,287 @@
+#include "bcEncoder.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // dominant direction of the block colors through power iteration on the covariance
+    template<int N>
+    void principalAxis(const uint8_t* rgba, float* mean, float* axis) {
+        for (int c = 0; c < N; ++c) {
+            mean[c] = 0.0f;
+            for (int i = 0; i < 16; ++i)
+                mean[c] += rgba[i * 4 + c];
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; ++i) {
+            float d[N];
+            for (int c = 0; c < N; ++c)
+                d[c] = rgba[i * 4 + c] - mean[c];
+            for (int a = 0; a < N; ++a)
+                for (int b = 0; b < N; ++b)
+                    covariance[a][b] += d[a] * d[b];
+        }
+
+        for (int c = 0; c < N; ++c)
+            axis[c] = 1.0f;
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[N] = {};
+            for (int a = 0; a < N; ++a)
+                for (int b = 0; b < N; ++b)
+                    next[a] += covariance[a][b] * axis[b];
+            float length = 0.0f;
+            for (int c = 0; c < N; ++c)
+                length = std::max(length, std::fabs(next[c]));
+            if (length < 1e-6f)
+                break;
+            for (int c = 0; c < N; ++c)
+                axis[c] = next[c] / length;
+        }
+    }
+
+    // project the block on its principal axis and return the extreme colors
+    template<int N>
+    void boundingEndpoints(const uint8_t* rgba, float* minColor, float* maxColor) {
+        float mean[N], axis[N];
+        principalAxis<N>(rgba, mean, axis);
+
+        float minProjection = 1e30f, maxProjection = -1e30f;
+        for (int i = 0; i < 16; ++i) {
+            float projection = 0.0f;
+            for (int c = 0; c < N; ++c)
+                projection += (rgba[i * 4 + c] - mean[c]) * axis[c];
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+
+        float axisLength = 0.0f;
+        for (int c = 0; c < N; ++c)
+            axisLength += axis[c] * axis[c];
+        axisLength = axisLength > 0.0f ? axisLength : 1.0f;
+        for (int c = 0; c < N; ++c) {
+            minColor[c] = std::min(std::max(mean[c] + axis[c] * minProjection / axisLength, 0.0f), 255.0f);
+            maxColor[c] = std::min(std::max(mean[c] + axis[c] * maxProjection / axisLength, 0.0f), 255.0f);
+        }
+    }
+
+    uint16_t packRGB565(const float* color) {
+        uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+        uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+        uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRGB565(uint16_t packed, int* color) {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    int colorDistance(const uint8_t* a, const int* b, int channels) {
+        int distance = 0;
+        for (int c = 0; c < channels; ++c)
+            distance += (a[c] - b[c]) * (a[c] - b[c]);
+        return distance;
+    }
+
+    // four color mode only, which is also how BC3 interprets its color half
+    void encodeColorBlock(const uint8_t* rgba, uint8_t* block) {
+        float minColor[3], maxColor[3];
+        boundingEndpoints<3>(rgba, minColor, maxColor);
+
+        uint16_t color0 = packRGB565(maxColor);
+        uint16_t color1 = packRGB565(minColor);
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            int palette[4][3];
+            unpackRGB565(color0, palette[0]);
+            unpackRGB565(color1, palette[1]);
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, bestDistance = colorDistance(rgba + i * 4, palette[0], 3);
+                for (int p = 1; p < 4; ++p) {
+                    int distance = colorDistance(rgba + i * 4, palette[p], 3);
+                    if (distance < bestDistance) {
+                        best = p;
+                        bestDistance = distance;
+                    }
+                }
+                indices |= uint32_t(best) << (2 * i);
+            }
+        }
+
+        block[0] = color0 & 0xFF;
+        block[1] = color0 >> 8;
+        block[2] = color1 & 0xFF;
+        block[3] = color1 >> 8;
+        memcpy(block + 4, &indices, 4);
+    }
+
+    // eight value mode of the interpolated alpha block
+    void encodeAlphaBlock(const uint8_t* rgba, uint8_t* block) {
+        int alpha0 = 0, alpha1 = 255;
+        for (int i = 0; i < 16; ++i) {
+            alpha0 = std::max<int>(alpha0, rgba[i * 4 + 3]);
+            alpha1 = std::min<int>(alpha1, rgba[i * 4 + 3]);
+        }
+
+        uint64_t indices = 0;
+        if (alpha0 != alpha1) {
+            int palette[8] = {alpha0, alpha1};
+            for (int p = 1; p < 7; ++p)
+                palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+            for (int i = 0; i < 16; ++i) {
+                int alpha = rgba[i * 4 + 3];
+                int best = 0;
+                for (int p = 1; p < 8; ++p)
+                    if (std::abs(palette[p] - alpha) < std::abs(palette[best] - alpha))
+                        best = p;
+                indices |= uint64_t(best) << (3 * i);
+            }
+        }
+
+        block[0] = static_cast<uint8_t>(alpha0);
+        block[1] = static_cast<uint8_t>(alpha1);
+        for (int i = 0; i < 6; ++i)
+            block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+    }
+
+    // little endian bit writer for BC7 blocks
+    struct BitWriter {
+        uint8_t* block;
+        uint32_t position = 0;
+
+        void write(uint32_t value, uint32_t bits) {
+            for (uint32_t i = 0; i < bits; ++i, ++position)
+                if (value & (1u << i))
+                    block[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+        }
+    };
+
+    const int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+}
+
+void encodeBC1Block(const uint8_t* rgba, uint8_t* block) {
+    encodeColorBlock(rgba, block);
+}
+
+void encodeBC3Block(const uint8_t* rgba, uint8_t* block) {
+    encodeAlphaBlock(rgba, block);
+    encodeColorBlock(rgba, block + 8);
+}
+
+void encodeBC7Block(const uint8_t* rgba, uint8_t* block) {
+    float minColor[4], maxColor[4];
+    boundingEndpoints<4>(rgba, minColor, maxColor);
+
+    // mode 6 endpoints are 7 bits plus a shared p-bit per endpoint, try every p-bit pair
+    int bestEndpoints[2][4] = {}, bestPBits[2] = {}, bestIndices[16] = {};
+    int bestError = INT32_MAX;
+    for (int pBits = 0; pBits < 4; ++pBits) {
+        int p[2] = {pBits & 1, pBits >> 1};
+        int endpoints[2][4], colors[2][4];
+        for (int c = 0; c < 4; ++c) {
+            const float* source[2] = {minColor, maxColor};
+            for (int e = 0; e < 2; ++e) {
+                int value = static_cast<int>(std::lround((source[e][c] - p[e]) / 2.0f));
+                endpoints[e][c] = std::min(std::max(value, 0), 127);
+                colors[e][c] = (endpoints[e][c] << 1) | p[e];
+            }
+        }
+
+        int palette[16][4];
+        for (int w = 0; w < 16; ++w)
+            for (int c = 0; c < 4; ++c)
+                palette[w][c] = ((64 - BC7_WEIGHTS4[w]) * colors[0][c] + BC7_WEIGHTS4[w] * colors[1][c] + 32) >> 6;
+
+        int error = 0, indices[16];
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestDistance = colorDistance(rgba + i * 4, palette[0], 4);
+            for (int w = 1; w < 16; ++w) {
+                int distance = colorDistance(rgba + i * 4, palette[w], 4);
+                if (distance < bestDistance) {
+                    best = w;
+                    bestDistance = distance;
+                }
+            }
+            indices[i] = best;
+            error += bestDistance;
+        }
+
+        if (error < bestError) {
+            bestError = error;
+            memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+            memcpy(bestPBits, p, sizeof(p));
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+    }
+
+    // the anchor index drops its top bit, so it has to be in the lower half
+    if (bestIndices[0] >= 8) {
+        for (int c = 0; c < 4; ++c)
+            std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+        std::swap(bestPBits[0], bestPBits[1]);
+        for (int i = 0; i < 16; ++i)
+            bestIndices[i] = 15 - bestIndices[i];
+    }
+
+    memset(block, 0, 16);
+    BitWriter writer{block};
+    writer.write(1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c) {
+        writer.write(bestEndpoints[0][c], 7);
+        writer.write(bestEndpoints[1][c], 7);
+    }
+    writer.write(bestPBits[0], 1);
+    writer.write(bestPBits[1], 1);
+    writer.write(bestIndices[0], 3);
+    for (int i = 1; i < 16; ++i)
+        writer.write(bestIndices[i], 4);
+}
+
+std::vector<uint8_t> compressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, ThreadPool& threadPool) {
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    size_t blockBytes = format == BlockFormat::BC1 ? 8 : 16;
+    std::vector<uint8_t> blocks(size_t(blocksX) * blocksY * blockBytes);
+
+    threadPool.parallelFor(blocksY, 1, [&](size_t begin, size_t end) {
+        uint8_t pixels[64];
+        for (size_t by = begin; by < end; ++by) {
+            for (uint32_t bx = 0; bx < blocksX; ++bx) {
+                // gather the block, clamping at the image edge
+                for (uint32_t y = 0; y < 4; ++y) {
+                    uint32_t sy = std::min<uint32_t>(static_cast<uint32_t>(by) * 4 + y, height - 1);
+                    for (uint32_t x = 0; x < 4; ++x) {
+                        uint32_t sx = std::min(bx * 4 + x, width - 1);
+                        memcpy(pixels + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+                    }
+                }
+
+                uint8_t* block = blocks.data() + (by * blocksX + bx) * blockBytes;
+                switch (format) {
+                case BlockFormat::BC1:
+                    encodeBC1Block(pixels, block);
+                    break;
+                case BlockFormat::BC3:
+                    encodeBC3Block(pixels, block);
+                    break;
+                case BlockFormat::BC7:
+                    encodeBC7Block(pixels, block);
+                    break;
+                }
+            }
+        }
+    });
+    return blocks;
+}
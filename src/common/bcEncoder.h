@@ -0,0 +1,22 @@
+//bcEncoder.h
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+enum class BlockFormat {
+	BC1, // RGB, 4 bpp
+	BC3, // RGBA with interpolated alpha, 8 bpp
+	BC7  // RGBA, mode 6 only, 8 bpp
+};
+
+// encode one 4x4 RGBA8 block, pixels in row order
+void encodeBC1Block(const uint8_t* rgba, uint8_t* block);
+void encodeBC3Block(const uint8_t* rgba, uint8_t* block);
+void encodeBC7Block(const uint8_t* rgba, uint8_t* block);
+
+// compress a whole RGBA8 image, partial edge blocks repeat the last row and column
+std::vector<uint8_t> compressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, ThreadPool& threadPool);
@@ -0,0 +1,250 @@
+#include "ktx2.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+namespace {
+    const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    struct Ktx2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must be 80 bytes.");
+
+    struct Ktx2LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // khronos data format descriptor values
+    enum : uint32_t {
+        KHR_DF_MODEL_RGBSDA = 1,
+        KHR_DF_MODEL_BC1A = 128,
+        KHR_DF_MODEL_BC3 = 130,
+        KHR_DF_MODEL_BC7 = 134,
+        KHR_DF_MODEL_ASTC = 162,
+        KHR_DF_PRIMARIES_BT709 = 1,
+        KHR_DF_TRANSFER_LINEAR = 1,
+        KHR_DF_TRANSFER_SRGB = 2,
+        KHR_DF_CHANNEL_COLOR = 0,
+        KHR_DF_CHANNEL_ALPHA = 15,
+    };
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // basic descriptor block with one sample per 64 bit half of the block
+    std::vector<uint32_t> buildDataFormatDescriptor(VkFormat format, const FormatBlock& block) {
+        uint32_t colorModel = KHR_DF_MODEL_RGBSDA;
+        std::vector<uint32_t> channels;
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC1A;
+            channels = {KHR_DF_CHANNEL_COLOR};
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC3;
+            channels = {KHR_DF_CHANNEL_ALPHA, KHR_DF_CHANNEL_COLOR};
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC7;
+            channels = {KHR_DF_CHANNEL_COLOR};
+            break;
+        default:
+            colorModel = KHR_DF_MODEL_ASTC;
+            channels = {KHR_DF_CHANNEL_COLOR};
+            break;
+        }
+
+        uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(channels.size());
+        std::vector<uint32_t> dfd;
+        dfd.push_back(4 + blockSize); // dfdTotalSize
+        dfd.push_back(0); // vendorId and descriptorType
+        dfd.push_back(2 | (blockSize << 16)); // versionNumber and descriptorBlockSize
+        dfd.push_back(colorModel | (KHR_DF_PRIMARIES_BT709 << 8) |
+            ((isSrgbFormat(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+        dfd.push_back((block.width - 1) | ((block.height - 1) << 8));
+        dfd.push_back(block.bytes); // bytesPlane0
+        dfd.push_back(0);
+
+        uint32_t sampleBits = block.bytes * 8 / static_cast<uint32_t>(channels.size());
+        for (size_t i = 0; i < channels.size(); ++i) {
+            dfd.push_back(static_cast<uint32_t>(i * sampleBits) | ((sampleBits - 1) << 16) | (channels[i] << 24));
+            dfd.push_back(0); // sample position
+            dfd.push_back(0); // sampleLower
+            dfd.push_back(UINT32_MAX); // sampleUpper
+        }
+        return dfd;
+    }
+}
+
+bool getFormatBlock(VkFormat format, FormatBlock& block) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        block = {1, 1, 4};
+        return true;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        block = {4, 4, 8};
+        return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        block = {4, 4, 16};
+        return true;
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+        block = {6, 6, 16};
+        return true;
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+        block = {8, 8, 16};
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isSrgbFormat(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool loadKtx2(const std::string& path, Ktx2Texture& texture) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // header
+    Ktx2Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+        return false;
+
+    // only plain 2D textures that can be handed to vulkan as they are
+    FormatBlock block;
+    VkFormat format = static_cast<VkFormat>(header.vkFormat);
+    if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 ||
+        header.pixelWidth == 0 || header.pixelHeight == 0 || !getFormatBlock(format, block))
+        return false;
+
+    // level index, level 0 first. A chain can't go past 1x1, checked before the index is allocated
+    if (header.levelCount > mipLevelCount(header.pixelWidth, header.pixelHeight))
+        return false;
+    uint32_t levelCnt = header.levelCount == 0 ? 1 : header.levelCount;
+    std::vector<Ktx2LevelIndex> levelIndices(levelCnt);
+    if (!file.read(reinterpret_cast<char*>(levelIndices.data()), levelCnt * sizeof(Ktx2LevelIndex)))
+        return false;
+
+    texture.format = format;
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.levels.clear();
+    size_t totalSize = 0;
+    for (uint32_t i = 0; i < levelCnt; ++i) {
+        MipLevel level;
+        level.width = std::max(header.pixelWidth >> i, 1u);
+        level.height = std::max(header.pixelHeight >> i, 1u);
+        level.offset = totalSize;
+        level.size = size_t((level.width + block.width - 1) / block.width) * ((level.height + block.height - 1) / block.height) * block.bytes;
+        if (levelIndices[i].byteLength != level.size)
+            return false;
+        totalSize += level.size;
+        texture.levels.push_back(level);
+    }
+
+    // level data, stored smallest first in the file
+    texture.data.resize(totalSize);
+    for (uint32_t i = 0; i < levelCnt; ++i) {
+        file.seekg(static_cast<std::streamoff>(levelIndices[i].byteOffset));
+        if (!file.read(reinterpret_cast<char*>(texture.data.data() + texture.levels[i].offset), texture.levels[i].size))
+            return false;
+    }
+    return true;
+}
+
+bool writeKtx2(const std::string& path, const Ktx2Texture& texture) {
+    FormatBlock block;
+    if (!getFormatBlock(texture.format, block) || texture.levels.empty())
+        return false;
+
+    std::vector<uint32_t> dfd = buildDataFormatDescriptor(texture.format, block);
+    uint32_t levelCnt = static_cast<uint32_t>(texture.levels.size());
+
+    Ktx2Header header = {};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = texture.format;
+    header.typeSize = 1;
+    header.pixelWidth = texture.width;
+    header.pixelHeight = texture.height;
+    header.faceCount = 1;
+    header.levelCount = levelCnt;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levelCnt * sizeof(Ktx2LevelIndex));
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+    // level data follows the descriptor, smallest level first, aligned to the block size
+    size_t alignment = std::lcm<size_t>(block.bytes, 4);
+    std::vector<Ktx2LevelIndex> levelIndices(levelCnt);
+    size_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (int32_t i = levelCnt - 1; i >= 0; --i) {
+        offset = alignUp(offset, alignment);
+        levelIndices[i].byteOffset = offset;
+        levelIndices[i].byteLength = texture.levels[i].size;
+        levelIndices[i].uncompressedByteLength = texture.levels[i].size;
+        offset += texture.levels[i].size;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(levelIndices.data()), levelCnt * sizeof(Ktx2LevelIndex));
+    file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+    size_t written = header.dfdByteOffset + header.dfdByteLength;
+    for (int32_t i = levelCnt - 1; i >= 0; --i) {
+        static const char padding[16] = {};
+        file.write(padding, levelIndices[i].byteOffset - written);
+        file.write(reinterpret_cast<const char*>(texture.data.data() + texture.levels[i].offset), texture.levels[i].size);
+        written = levelIndices[i].byteOffset + texture.levels[i].size;
+    }
+    return file.good();
+}
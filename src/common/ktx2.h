@@ -0,0 +1,31 @@
+//ktx2.h
+
+#pragma once
+
+#include "mipmap.h"
+#include <vulkan/vulkan.h>
+#include <string>
+
+// a KTX2 container without supercompression, levels are packed largest first
+struct Ktx2Texture {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> data;
+	std::vector<MipLevel> levels;
+};
+
+// texel block footprint of the formats the loader and the converter understand
+struct FormatBlock {
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytes;
+};
+
+bool getFormatBlock(VkFormat format, FormatBlock& block);
+
+bool isSrgbFormat(VkFormat format);
+
+bool loadKtx2(const std::string& path, Ktx2Texture& texture);
+
+bool writeKtx2(const std::string& path, const Ktx2Texture& texture);
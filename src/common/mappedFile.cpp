@@ -0,0 +1,92 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const char* path) {
+    close();
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        close();
+        return false;
+    }
+    mappedSize = size_t(fileSize.QuadPart);
+    if (mappedSize == 0)
+        return true;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr)
+        mapped = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (mapped == nullptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped != nullptr)
+        UnmapViewOfFile(mapped);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (file != nullptr)
+        CloseHandle(file);
+    mapped = nullptr;
+    mapping = nullptr;
+    file = nullptr;
+    mappedSize = 0;
+}
+#else
+bool MappedFile::open(const char* path) {
+    close();
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close();
+        return false;
+    }
+    mappedSize = size_t(fileStat.st_size);
+    if (mappedSize == 0)
+        return true;
+
+    void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+        close();
+        return false;
+    }
+    mapped = static_cast<const uint8_t*>(address);
+    // parsed front to back, let the kernel read ahead aggressively
+    madvise(address, mappedSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped != nullptr)
+        munmap(const_cast<uint8_t*>(mapped), mappedSize);
+    if (fd >= 0)
+        ::close(fd);
+    mapped = nullptr;
+    fd = -1;
+    mappedSize = 0;
+}
+#endif
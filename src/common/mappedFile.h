@@ -0,0 +1,40 @@
+//mappedFile.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// read only view of a whole file through the page cache, nothing is copied until it is touched
+class MappedFile {
+private:
+	const uint8_t* mapped = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+
+public:
+	MappedFile() = default;
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// false when the file cannot be opened or mapped, an empty file maps to a null pointer
+	bool open(const char* path);
+
+	void close();
+
+	const uint8_t* data() const {
+		return mapped;
+	}
+
+	size_t size() const {
+		return mappedSize;
+	}
+};
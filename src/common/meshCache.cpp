@@ -0,0 +1,230 @@
+#include "meshCache.h"
+#include "meshCodec.h"
+#include "vertexDedup.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    const uint8_t MESH_CACHE_IDENTIFIER[8] = {'V', 'K', 'M', 'E', 'S', 'H', 0x0D, 0x0A};
+    constexpr uint32_t MESH_CACHE_VERSION = 7;
+    constexpr uint64_t BLOB_ALIGNMENT = 64;
+
+    struct MeshCacheHeader {
+        uint8_t identifier[8];
+        uint32_t version;
+        uint32_t attributeCount;
+        uint64_t sourceHash;
+        uint32_t vertexStride;
+        uint32_t indexSize;
+        uint64_t vertexCount;
+        uint64_t vertexOffset;
+        uint64_t indexCount;
+        uint64_t indexOffset;
+        uint32_t submeshCount;
+        uint32_t encoding;
+        MeshBounds bounds;
+        uint64_t fileSize;
+        uint64_t vertexBytes;
+        uint64_t indexBytes;
+        uint32_t meshletCount;
+        uint32_t lodCount;
+        uint32_t materialCount;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(MeshCacheHeader) == 168, "Mesh cache header must be 168 bytes.");
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool hashFile(const char* path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+bool writeMeshCache(const std::string& path, uint64_t sourceHash, const MeshView& mesh, bool compress) {
+    if (mesh.vertexStride == 0 || (mesh.indexSize != 2 && mesh.indexSize != 4) || mesh.encoding != 0)
+        return false;
+
+    // encoded blobs are only kept when they come out smaller
+    uint64_t vertexSize = mesh.vertexCount * mesh.vertexStride, indexSize = mesh.indexCount * mesh.indexSize;
+    const void* vertices = mesh.vertices;
+    const void* indices = mesh.indices;
+    uint32_t encoding = 0;
+    std::vector<uint8_t> encodedVertices, encodedIndices;
+    if (compress) {
+        encodedVertices.resize(encodeVertexBufferBound(mesh.vertexCount, mesh.vertexStride));
+        size_t encodedSize = encodeVertexBuffer(encodedVertices.data(), encodedVertices.size(), mesh.vertices, mesh.vertexCount, mesh.vertexStride);
+        if (encodedSize != 0 && encodedSize < vertexSize) {
+            vertices = encodedVertices.data();
+            vertexSize = encodedSize;
+            encoding |= MESH_ENCODING_VERTICES;
+        }
+        encodedIndices.resize(encodeIndexBufferBound(mesh.indexCount));
+        encodedSize = encodeIndexBuffer(encodedIndices.data(), encodedIndices.size(), mesh.indices, mesh.indexCount, mesh.indexSize);
+        if (encodedSize != 0 && encodedSize < indexSize) {
+            indices = encodedIndices.data();
+            indexSize = encodedSize;
+            encoding |= MESH_ENCODING_INDICES;
+        }
+    }
+
+    MeshCacheHeader header = {};
+    memcpy(header.identifier, MESH_CACHE_IDENTIFIER, sizeof(MESH_CACHE_IDENTIFIER));
+    header.version = MESH_CACHE_VERSION;
+    header.attributeCount = static_cast<uint32_t>(mesh.attributes.size());
+    header.sourceHash = sourceHash;
+    header.vertexStride = mesh.vertexStride;
+    header.indexSize = mesh.indexSize;
+    header.vertexCount = mesh.vertexCount;
+    header.indexCount = mesh.indexCount;
+    header.submeshCount = static_cast<uint32_t>(mesh.submeshes.size());
+    header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+    header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    header.materialCount = static_cast<uint32_t>(mesh.materials.size());
+    header.bounds = mesh.bounds;
+    header.encoding = encoding;
+    header.vertexBytes = vertexSize;
+    header.indexBytes = indexSize;
+
+    // descriptors right behind the header, blobs aligned so they can be copied out of the mapping as they are
+    uint64_t descriptorEnd = sizeof(MeshCacheHeader) + mesh.attributes.size() * sizeof(MeshAttribute) + mesh.materials.size() * sizeof(MeshMaterial) +
+        mesh.submeshes.size() * sizeof(Submesh) + mesh.meshlets.size() * sizeof(Meshlet) + mesh.lods.size() * sizeof(MeshLod);
+    header.vertexOffset = alignUp(descriptorEnd, BLOB_ALIGNMENT);
+    header.indexOffset = alignUp(header.vertexOffset + vertexSize, BLOB_ALIGNMENT);
+    header.fileSize = header.indexOffset + indexSize;
+
+    // written under a temporary name first, a crash halfway leaves no truncated cache behind
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.is_open())
+            return false;
+        static const char padding[BLOB_ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(mesh.attributes.data()), mesh.attributes.size() * sizeof(MeshAttribute));
+        file.write(reinterpret_cast<const char*>(mesh.materials.data()), mesh.materials.size() * sizeof(MeshMaterial));
+        file.write(reinterpret_cast<const char*>(mesh.submeshes.data()), mesh.submeshes.size() * sizeof(Submesh));
+        file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+        file.write(reinterpret_cast<const char*>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+        file.write(padding, header.vertexOffset - descriptorEnd);
+        file.write(static_cast<const char*>(vertices), vertexSize);
+        file.write(padding, header.indexOffset - header.vertexOffset - vertexSize);
+        file.write(static_cast<const char*>(indices), indexSize);
+        if (!file.good())
+            return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+bool loadMeshCache(const std::string& path, uint64_t sourceHash, const std::vector<MeshAttribute>& attributes, uint32_t vertexStride,
+    MappedFile& file, MeshView& mesh) {
+    if (!file.open(path.c_str()))
+        return false;
+
+    MeshCacheHeader header;
+    if (file.size() < sizeof(header)) {
+        file.close();
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    // stale when the source or the vertex layout changed since it was written. Corrupt when the decoded sizes overflow
+    // a size_t, when an encoded blob is too small for its count (a header byte per 4 bytes of a 16 vertex group, a byte
+    // per triangle) or when a blob runs past its range. The ranges are compared as differences so a huge size can't
+    // wrap around
+    uint64_t descriptorEnd = sizeof(MeshCacheHeader) + uint64_t(header.attributeCount) * sizeof(MeshAttribute) +
+        uint64_t(header.materialCount) * sizeof(MeshMaterial) + uint64_t(header.submeshCount) * sizeof(Submesh) +
+        uint64_t(header.meshletCount) * sizeof(Meshlet) + uint64_t(header.lodCount) * sizeof(MeshLod);
+    bool valid = memcmp(header.identifier, MESH_CACHE_IDENTIFIER, sizeof(MESH_CACHE_IDENTIFIER)) == 0 &&
+        header.version == MESH_CACHE_VERSION && header.sourceHash == sourceHash && header.fileSize == file.size() &&
+        header.vertexStride == vertexStride && header.attributeCount == attributes.size() &&
+        (header.indexSize == 2 || header.indexSize == 4) && header.vertexStride != 0 &&
+        header.vertexOffset % BLOB_ALIGNMENT == 0 && header.indexOffset % BLOB_ALIGNMENT == 0 &&
+        (header.encoding & ~(MESH_ENCODING_VERTICES | MESH_ENCODING_INDICES)) == 0 &&
+        header.vertexCount <= SIZE_MAX / header.vertexStride && header.indexCount <= SIZE_MAX / header.indexSize &&
+        ((header.encoding & MESH_ENCODING_VERTICES) ? (header.vertexCount + 15) / 16 * (header.vertexStride / 4) <= header.vertexBytes :
+            header.vertexBytes == header.vertexCount * header.vertexStride) &&
+        ((header.encoding & MESH_ENCODING_INDICES) ? header.indexCount / 3 <= header.indexBytes :
+            header.indexBytes == header.indexCount * header.indexSize) &&
+        descriptorEnd <= header.vertexOffset && header.vertexOffset <= header.indexOffset && header.indexOffset <= header.fileSize &&
+        header.vertexBytes <= header.indexOffset - header.vertexOffset && header.indexBytes <= header.fileSize - header.indexOffset;
+    const MeshAttribute* fileAttributes = reinterpret_cast<const MeshAttribute*>(file.data() + sizeof(MeshCacheHeader));
+    if (valid && !attributes.empty())
+        valid = memcmp(fileAttributes, attributes.data(), attributes.size() * sizeof(MeshAttribute)) == 0;
+
+    // submeshes, meshlets and levels are drawn as they are, a range past the index buffer would read out of bounds on the
+    // GPU, and so would a material index past the material buffer. The indices are checked against the vertex count
+    // by readMeshIndices, once they are decoded
+    const MeshMaterial* fileMaterials = reinterpret_cast<const MeshMaterial*>(fileAttributes + header.attributeCount);
+    const Submesh* fileSubmeshes = reinterpret_cast<const Submesh*>(fileMaterials + header.materialCount);
+    const Meshlet* fileMeshlets = reinterpret_cast<const Meshlet*>(fileSubmeshes + header.submeshCount);
+    const MeshLod* fileLods = reinterpret_cast<const MeshLod*>(fileMeshlets + header.meshletCount);
+    for (uint32_t i = 0; valid && i < header.submeshCount; ++i)
+        valid = uint64_t(fileSubmeshes[i].firstIndex) + fileSubmeshes[i].indexCount <= header.indexCount &&
+            fileSubmeshes[i].material < header.materialCount;
+    for (uint32_t i = 0; valid && i < header.meshletCount; ++i)
+        valid = uint64_t(fileMeshlets[i].firstIndex) + fileMeshlets[i].indexCount <= header.indexCount;
+    for (uint32_t i = 0; valid && i < header.lodCount; ++i)
+        valid = uint64_t(fileLods[i].firstIndex) + fileLods[i].indexCount <= header.indexCount &&
+            uint64_t(fileLods[i].firstSubmesh) + fileLods[i].submeshCount <= header.submeshCount;
+    if (!valid) {
+        file.close();
+        return false;
+    }
+
+    mesh.attributes.assign(fileAttributes, fileAttributes + header.attributeCount);
+    mesh.vertexStride = header.vertexStride;
+    mesh.vertices = file.data() + header.vertexOffset;
+    mesh.vertexCount = header.vertexCount;
+    mesh.indexSize = header.indexSize;
+    mesh.indices = file.data() + header.indexOffset;
+    mesh.indexCount = header.indexCount;
+    mesh.bounds = header.bounds;
+    mesh.materials.assign(fileMaterials, fileMaterials + header.materialCount);
+    mesh.submeshes.assign(fileSubmeshes, fileSubmeshes + header.submeshCount);
+    mesh.meshlets.assign(fileMeshlets, fileMeshlets + header.meshletCount);
+    mesh.lods.assign(fileLods, fileLods + header.lodCount);
+    mesh.encoding = header.encoding;
+    mesh.vertexBytes = header.vertexBytes;
+    mesh.indexBytes = header.indexBytes;
+    return true;
+}
+
+bool readMeshVertices(const MeshView& mesh, void* dst) {
+    if (mesh.encoding & MESH_ENCODING_VERTICES)
+        return decodeVertexBuffer(dst, mesh.vertexCount, mesh.vertexStride, static_cast<const uint8_t*>(mesh.vertices), mesh.vertexBytes);
+    memcpy(dst, mesh.vertices, mesh.vertexCount * mesh.vertexStride);
+    return true;
+}
+
+bool readMeshIndices(const MeshView& mesh, void* dst) {
+    if (mesh.encoding & MESH_ENCODING_INDICES) {
+        if (!decodeIndexBuffer(dst, mesh.indexCount, mesh.indexSize, static_cast<const uint8_t*>(mesh.indices), mesh.indexBytes))
+            return false;
+    }
+    else
+        memcpy(dst, mesh.indices, mesh.indexCount * mesh.indexSize);
+
+    // an index past the vertices would read out of bounds on the GPU
+    uint32_t maxIndex = 0;
+    if (mesh.indexSize == 2) {
+        const uint16_t* indices = static_cast<const uint16_t*>(dst);
+        for (uint64_t i = 0; i < mesh.indexCount; ++i)
+            maxIndex = std::max<uint32_t>(maxIndex, indices[i]);
+    }
+    else {
+        const uint32_t* indices = static_cast<const uint32_t*>(dst);
+        for (uint64_t i = 0; i < mesh.indexCount; ++i)
+            maxIndex = std::max(maxIndex, indices[i]);
+    }
+    return mesh.indexCount == 0 || maxIndex < mesh.vertexCount;
+}
@@ -0,0 +1,91 @@
+//meshCache.h
+
+#pragma once
+
+#include "mappedFile.h"
+#include "meshlet.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one vertex input attribute as the pipeline sees it, format is a VkFormat
+struct MeshAttribute {
+	uint32_t location;
+	uint32_t format;
+	uint32_t offset;
+};
+
+struct MeshBounds {
+	float min[3];
+	float max[3];
+	float center[3];
+	float radius;
+	float uvMin[2];
+	float uvMax[2];
+};
+
+// bits of MeshMaterial::flags
+constexpr uint32_t MESH_MATERIAL_TEXTURED = 1; // the base color is multiplied by the mesh's texture
+
+// what a submesh is shaded with, as the source's material library describes it
+struct MeshMaterial {
+	float baseColor[4]; // diffuse color, alpha is the dissolve
+	uint32_t flags;
+};
+
+// a range of the index buffer drawn on its own, its indices address the whole vertex buffer
+struct Submesh {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t material; // into MeshView::materials
+};
+
+// a level of detail, a range of the index buffer drawn instead of the full mesh. Level 0 is the full mesh
+struct MeshLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error; // how far the surface may have moved from the full mesh, in model units
+	uint32_t firstSubmesh; // the level split by material, submeshCount entries of MeshView::submeshes within the range above
+	uint32_t submeshCount;
+};
+
+// bits of MeshView::encoding, a set bit means the blob is in the meshCodec format
+constexpr uint32_t MESH_ENCODING_VERTICES = 1;
+constexpr uint32_t MESH_ENCODING_INDICES = 2;
+
+// a mesh ready for upload, the blobs point into a mapped cache file or into memory owned by the caller
+struct MeshView {
+	std::vector<MeshAttribute> attributes;
+	uint32_t vertexStride = 0;
+	const void* vertices = nullptr;
+	uint64_t vertexCount = 0;
+	uint32_t indexSize = 4; // 2 or 4 bytes
+	const void* indices = nullptr;
+	uint64_t indexCount = 0;
+	MeshBounds bounds = {};
+	std::vector<MeshMaterial> materials;
+	std::vector<Submesh> submeshes; // the levels' one after the other, finest first
+	std::vector<Meshlet> meshlets; // ranges of the index buffer, in order and never across submeshes, empty when none were built
+	std::vector<MeshLod> lods; // finest first, all indexing the one vertex buffer
+	uint32_t encoding = 0;
+	uint64_t vertexBytes = 0; // blob sizes, only needed for encoded blobs
+	uint64_t indexBytes = 0;
+};
+
+// hash of the whole file, what a cache is keyed by
+bool hashFile(const char* path, uint64_t& hash);
+
+// header, attribute descriptors, materials, submesh ranges, meshlets and levels of detail, then the vertex and index blobs each aligned to 64 bytes. With
+// compress the blobs are stored encoded whenever meshCodec supports the layout and it makes them smaller
+bool writeMeshCache(const std::string& path, uint64_t sourceHash, const MeshView& mesh, bool compress = true);
+
+// map a cache written for the same source and vertex layout, mesh points into file afterwards so file has to stay
+// open until the blobs are uploaded. False when the file is missing, stale or malformed
+bool loadMeshCache(const std::string& path, uint64_t sourceHash, const std::vector<MeshAttribute>& attributes, uint32_t vertexStride,
+	MappedFile& file, MeshView& mesh);
+
+// vertexCount * vertexStride bytes and indexCount * indexSize bytes into dst, decoded when the blob is encoded.
+// False when an encoded blob turns out to be corrupt or, for the indices, one of them is past the vertices
+bool readMeshVertices(const MeshView& mesh, void* dst);
+
+bool readMeshIndices(const MeshView& mesh, void* dst);
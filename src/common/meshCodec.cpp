@@ -0,0 +1,530 @@
+#include "meshCodec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CODEC_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define CODEC_NEON
+#endif
+
+namespace {
+    // first byte of a stream, the low nibble is the format version
+    constexpr uint8_t VERTEX_HEADER = 0xA0;
+    constexpr uint8_t INDEX_HEADER = 0xE0;
+
+    constexpr size_t GROUP_SIZE = 16;
+    constexpr size_t MAX_VERTEX_SIZE = 256;
+
+    // payload bytes of a plane by its 2 bit mode, the deltas take 0, 2, 4 or 8 bits
+    constexpr size_t PLANE_SIZE[4] = {0, 4, 8, 16};
+
+    bool supportedVertexSize(size_t vertexSize) {
+        return vertexSize != 0 && vertexSize % 4 == 0 && vertexSize <= MAX_VERTEX_SIZE;
+    }
+
+    // small deltas of either sign end up as small unsigned values
+    uint8_t zigzag8(uint8_t delta) {
+        return uint8_t(uint8_t(delta << 1) ^ uint8_t(int8_t(delta) >> 7));
+    }
+
+    uint8_t unzigzag8(uint8_t value) {
+        return uint8_t((value >> 1) ^ (0u - (value & 1u)));
+    }
+
+    // the first value takes the high bits of a byte
+    uint8_t* packPlane(uint8_t* dst, const uint8_t deltas[GROUP_SIZE], uint32_t mode) {
+        switch (mode) {
+        case 0:
+            return dst;
+        case 1:
+            for (size_t j = 0; j < 4; ++j)
+                dst[j] = uint8_t(deltas[j * 4] << 6 | deltas[j * 4 + 1] << 4 | deltas[j * 4 + 2] << 2 | deltas[j * 4 + 3]);
+            return dst + 4;
+        case 2:
+            for (size_t j = 0; j < 8; ++j)
+                dst[j] = uint8_t(deltas[j * 2] << 4 | deltas[j * 2 + 1]);
+            return dst + 8;
+        default:
+            memcpy(dst, deltas, GROUP_SIZE);
+            return dst + GROUP_SIZE;
+        }
+    }
+
+    const uint8_t* unpackPlane(uint8_t deltas[GROUP_SIZE], const uint8_t* src, uint32_t mode) {
+        switch (mode) {
+        case 0:
+            memset(deltas, 0, GROUP_SIZE);
+            return src;
+        case 1:
+            for (size_t j = 0; j < 4; ++j) {
+                deltas[j * 4] = src[j] >> 6;
+                deltas[j * 4 + 1] = (src[j] >> 4) & 3;
+                deltas[j * 4 + 2] = (src[j] >> 2) & 3;
+                deltas[j * 4 + 3] = src[j] & 3;
+            }
+            return src + 4;
+        case 2:
+            for (size_t j = 0; j < 8; ++j) {
+                deltas[j * 2] = src[j] >> 4;
+                deltas[j * 2 + 1] = src[j] & 15;
+            }
+            return src + 8;
+        default:
+            memcpy(deltas, src, GROUP_SIZE);
+            return src + GROUP_SIZE;
+        }
+    }
+
+    // four byte planes of a group, modes holds their 2 bit modes starting at the low bits. last is the running value
+    // of every plane, out the first of 16 vertices vertexSize bytes apart
+    void decodePlanesScalar(uint8_t modes, const uint8_t* data, uint8_t last[4], uint8_t* out, size_t vertexSize) {
+        for (size_t k = 0; k < 4; ++k) {
+            uint8_t deltas[GROUP_SIZE];
+            data = unpackPlane(deltas, data, (modes >> (k * 2)) & 3);
+            uint8_t value = last[k];
+            for (size_t i = 0; i < GROUP_SIZE; ++i) {
+                value = uint8_t(value + unzigzag8(deltas[i]));
+                out[i * vertexSize + k] = value;
+            }
+            last[k] = value;
+        }
+    }
+
+#if defined(CODEC_SSE2)
+    // reads only the payload of the plane, unlike the group loop it doesn't advance data
+    __m128i loadPlane(const uint8_t* data, uint32_t mode) {
+        switch (mode) {
+        case 0:
+            return _mm_setzero_si128();
+        case 1: {
+            int32_t bits;
+            memcpy(&bits, data, sizeof(bits));
+            // 16 bit shifts pull in bits of the neighbouring byte, the mask drops them again
+            __m128i packed = _mm_cvtsi32_si128(bits), mask = _mm_set1_epi8(3);
+            __m128i v0 = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+            __m128i v1 = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+            __m128i v2 = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+            __m128i v3 = _mm_and_si128(packed, mask);
+            return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+        }
+        case 2: {
+            __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)), mask = _mm_set1_epi8(15);
+            return _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(packed, 4), mask), _mm_and_si128(packed, mask));
+        }
+        default:
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        }
+    }
+
+    __m128i unzigzag(__m128i deltas) {
+        __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(deltas, _mm_set1_epi8(1)));
+        return _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(deltas, 1), _mm_set1_epi8(0x7F)), sign);
+    }
+
+    // running sum over four vertices, a 32 bit lane each, last holds the vertex before them in every lane
+    __m128i prefixSum(__m128i v, __m128i& last) {
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi8(v, last);
+        last = _mm_shuffle_epi32(v, 0xFF);
+        return v;
+    }
+
+    void storeVertices(uint8_t* out, __m128i v, size_t vertexSize) {
+        int32_t v0 = _mm_cvtsi128_si32(v), v1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(v, 1));
+        int32_t v2 = _mm_cvtsi128_si32(_mm_shuffle_epi32(v, 2)), v3 = _mm_cvtsi128_si32(_mm_shuffle_epi32(v, 3));
+        memcpy(out, &v0, sizeof(v0));
+        memcpy(out + vertexSize, &v1, sizeof(v1));
+        memcpy(out + 2 * vertexSize, &v2, sizeof(v2));
+        memcpy(out + 3 * vertexSize, &v3, sizeof(v3));
+    }
+
+    // the deltas are turned into vertices first, the running sum then adds four bytes of a vertex at once
+    void decodePlanesVector(uint8_t modes, const uint8_t* data, uint8_t last[4], uint8_t* out, size_t vertexSize) {
+        // the plane offsets come from the modes alone, the four loads don't wait on each other
+        uint32_t m0 = modes & 3, m1 = (modes >> 2) & 3, m2 = (modes >> 4) & 3, m3 = modes >> 6;
+        size_t offset1 = PLANE_SIZE[m0], offset2 = offset1 + PLANE_SIZE[m1], offset3 = offset2 + PLANE_SIZE[m2];
+        __m128i p0 = unzigzag(loadPlane(data, m0));
+        __m128i p1 = unzigzag(loadPlane(data + offset1, m1));
+        __m128i p2 = unzigzag(loadPlane(data + offset2, m2));
+        __m128i p3 = unzigzag(loadPlane(data + offset3, m3));
+
+        // planes to vertices, four bytes of each vertex in a 32 bit lane
+        __m128i lo01 = _mm_unpacklo_epi8(p0, p1), hi01 = _mm_unpackhi_epi8(p0, p1);
+        __m128i lo23 = _mm_unpacklo_epi8(p2, p3), hi23 = _mm_unpackhi_epi8(p2, p3);
+        __m128i v0 = _mm_unpacklo_epi16(lo01, lo23), v1 = _mm_unpackhi_epi16(lo01, lo23);
+        __m128i v2 = _mm_unpacklo_epi16(hi01, hi23), v3 = _mm_unpackhi_epi16(hi01, hi23);
+
+        int32_t word;
+        memcpy(&word, last, sizeof(word));
+        __m128i previous = _mm_set1_epi32(word);
+        v0 = prefixSum(v0, previous);
+        v1 = prefixSum(v1, previous);
+        v2 = prefixSum(v2, previous);
+        v3 = prefixSum(v3, previous);
+        word = _mm_cvtsi128_si32(previous);
+        memcpy(last, &word, sizeof(word));
+
+        if (vertexSize == 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v0);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), v1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 32), v2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 48), v3);
+            return;
+        }
+        storeVertices(out, v0, vertexSize);
+        storeVertices(out + 4 * vertexSize, v1, vertexSize);
+        storeVertices(out + 8 * vertexSize, v2, vertexSize);
+        storeVertices(out + 12 * vertexSize, v3, vertexSize);
+    }
+#elif defined(CODEC_NEON)
+    // reads only the payload of the plane, unlike the group loop it doesn't advance data
+    uint8x16_t loadPlane(const uint8_t* data, uint32_t mode) {
+        switch (mode) {
+        case 0:
+            return vdupq_n_u8(0);
+        case 1: {
+            uint32_t bits;
+            memcpy(&bits, data, sizeof(bits));
+            uint8x8_t packed = vreinterpret_u8_u32(vdup_n_u32(bits)), mask = vdup_n_u8(3);
+            uint8x8_t v01 = vzip_u8(vshr_n_u8(packed, 6), vand_u8(vshr_n_u8(packed, 4), mask)).val[0];
+            uint8x8_t v23 = vzip_u8(vand_u8(vshr_n_u8(packed, 2), mask), vand_u8(packed, mask)).val[0];
+            uint16x4x2_t v = vzip_u16(vreinterpret_u16_u8(v01), vreinterpret_u16_u8(v23));
+            return vcombine_u8(vreinterpret_u8_u16(v.val[0]), vreinterpret_u8_u16(v.val[1]));
+        }
+        case 2: {
+            uint8x8_t packed = vld1_u8(data);
+            uint8x8x2_t v = vzip_u8(vshr_n_u8(packed, 4), vand_u8(packed, vdup_n_u8(15)));
+            return vcombine_u8(v.val[0], v.val[1]);
+        }
+        default:
+            return vld1q_u8(data);
+        }
+    }
+
+    uint8x16_t decodePlane(uint8x16_t deltas, uint8_t& last) {
+        uint8x16_t zero = vdupq_n_u8(0);
+        uint8x16_t sign = vsubq_u8(zero, vandq_u8(deltas, vdupq_n_u8(1)));
+        uint8x16_t v = veorq_u8(vshrq_n_u8(deltas, 1), sign);
+        v = vaddq_u8(v, vextq_u8(zero, v, 15));
+        v = vaddq_u8(v, vextq_u8(zero, v, 14));
+        v = vaddq_u8(v, vextq_u8(zero, v, 12));
+        v = vaddq_u8(v, vextq_u8(zero, v, 8));
+        v = vaddq_u8(v, vdupq_n_u8(last));
+        last = vgetq_lane_u8(v, 15);
+        return v;
+    }
+
+    void decodePlanesVector(uint8_t modes, const uint8_t* data, uint8_t last[4], uint8_t* out, size_t vertexSize) {
+        // the plane offsets come from the modes alone, the four loads don't wait on each other
+        uint32_t m0 = modes & 3, m1 = (modes >> 2) & 3, m2 = (modes >> 4) & 3, m3 = modes >> 6;
+        size_t offset1 = PLANE_SIZE[m0], offset2 = offset1 + PLANE_SIZE[m1], offset3 = offset2 + PLANE_SIZE[m2];
+        uint8x16x4_t planes;
+        planes.val[0] = decodePlane(loadPlane(data, m0), last[0]);
+        planes.val[1] = decodePlane(loadPlane(data + offset1, m1), last[1]);
+        planes.val[2] = decodePlane(loadPlane(data + offset2, m2), last[2]);
+        planes.val[3] = decodePlane(loadPlane(data + offset3, m3), last[3]);
+
+        // the interleaving store turns planes into vertices
+        if (vertexSize == 4) {
+            vst4q_u8(out, planes);
+            return;
+        }
+        uint8_t vertices[GROUP_SIZE * 4];
+        vst4q_u8(vertices, planes);
+        for (size_t i = 0; i < GROUP_SIZE; ++i)
+            memcpy(out + i * vertexSize, vertices + i * 4, 4);
+    }
+#endif
+
+    using DecodePlanes = void (*)(uint8_t modes, const uint8_t* data, uint8_t last[4], uint8_t* out, size_t vertexSize);
+
+    // the plane decoder is a template argument so the group loop calls it directly, not through a pointer
+    template<DecodePlanes decodePlanes>
+    bool decodeVertices(uint8_t* dst, size_t vertexCnt, size_t vertexSize, const uint8_t* src, size_t srcSize) {
+        if (!supportedVertexSize(vertexSize) || srcSize == 0 || src[0] != VERTEX_HEADER)
+            return false;
+
+        const uint8_t* data = src + 1;
+        const uint8_t* end = src + srcSize;
+        size_t headerSize = vertexSize / 4;
+        uint8_t last[MAX_VERTEX_SIZE] = {};
+        uint8_t scratch[GROUP_SIZE * MAX_VERTEX_SIZE];
+        for (size_t first = 0; first < vertexCnt; first += GROUP_SIZE) {
+            size_t count = std::min(GROUP_SIZE, vertexCnt - first);
+            if (size_t(end - data) < headerSize)
+                return false;
+            const uint8_t* header = data;
+            data += headerSize;
+
+            // a partial group at the end goes through scratch, dst only receives the vertices it has room for
+            uint8_t* out = count == GROUP_SIZE ? dst + first * vertexSize : scratch;
+            for (size_t k = 0; k < headerSize; ++k) {
+                uint8_t modes = header[k];
+                size_t payload = PLANE_SIZE[modes & 3] + PLANE_SIZE[(modes >> 2) & 3] + PLANE_SIZE[(modes >> 4) & 3] + PLANE_SIZE[modes >> 6];
+                if (size_t(end - data) < payload)
+                    return false;
+                decodePlanes(modes, data, last + k * 4, out + k * 4, vertexSize);
+                data += payload;
+            }
+            if (out == scratch)
+                memcpy(dst + first * vertexSize, scratch, count * vertexSize);
+        }
+        return data == end;
+    }
+
+    constexpr uint32_t EDGE_FIFO_SIZE = 16; // edge code 15 marks a triangle without a known edge
+    constexpr uint32_t VERTEX_FIFO_SIZE = 16;
+    constexpr uint32_t VERTEX_NEXT = 0;
+    constexpr uint32_t VERTEX_EXPLICIT = 15; // codes in between are vertex FIFO entries, 1 being the most recent
+
+    // shared by the encoder and the decoder so both see the same history, entry 0 is the most recent
+    struct IndexFifos {
+        uint32_t edges[EDGE_FIFO_SIZE][2] = {};
+        uint32_t vertices[VERTEX_FIFO_SIZE] = {};
+        uint32_t edgeOffset = 0;
+        uint32_t vertexOffset = 0;
+
+        void pushEdge(uint32_t a, uint32_t b) {
+            edges[edgeOffset][0] = a;
+            edges[edgeOffset][1] = b;
+            edgeOffset = (edgeOffset + 1) % EDGE_FIFO_SIZE;
+        }
+
+        const uint32_t* edge(uint32_t i) const {
+            return edges[(edgeOffset + EDGE_FIFO_SIZE - 1 - i) % EDGE_FIFO_SIZE];
+        }
+
+        void pushVertex(uint32_t v) {
+            vertices[vertexOffset] = v;
+            vertexOffset = (vertexOffset + 1) % VERTEX_FIFO_SIZE;
+        }
+
+        uint32_t vertex(uint32_t i) const {
+            return vertices[(vertexOffset + VERTEX_FIFO_SIZE - 1 - i) % VERTEX_FIFO_SIZE];
+        }
+
+        // the reversed edges are the ones a neighbour with the same winding has
+        void pushTriangle(uint32_t a, uint32_t b, uint32_t c) {
+            pushEdge(b, a);
+            pushEdge(c, b);
+            pushEdge(a, c);
+        }
+    };
+
+    struct IndexEncoder {
+        IndexFifos fifos;
+        uint32_t next = 0; // lowest vertex not seen yet, a fetch optimized buffer mostly counts up
+        uint32_t last = 0; // last vertex coded explicitly
+        uint8_t* data;
+
+        uint32_t encodeVertex(uint32_t v) {
+            if (v == next) {
+                ++next;
+                fifos.pushVertex(v);
+                return VERTEX_NEXT;
+            }
+            for (uint32_t j = 0; j < VERTEX_EXPLICIT - 1; ++j)
+                if (fifos.vertex(j) == v)
+                    return j + 1;
+
+            // zigzag varint of the delta, seven bits a byte
+            uint32_t delta = v - last;
+            uint32_t value = (delta << 1) ^ uint32_t(int32_t(delta) >> 31);
+            while (value >= 0x80) {
+                *data++ = uint8_t(value | 0x80);
+                value >>= 7;
+            }
+            *data++ = uint8_t(value);
+            last = v;
+            fifos.pushVertex(v);
+            return VERTEX_EXPLICIT;
+        }
+    };
+
+    struct IndexDecoder {
+        IndexFifos fifos;
+        uint32_t next = 0;
+        uint32_t last = 0;
+        const uint8_t* data;
+        const uint8_t* end;
+
+        bool decodeVertex(uint32_t code, uint32_t& v) {
+            if (code == VERTEX_NEXT) {
+                v = next++;
+                fifos.pushVertex(v);
+                return true;
+            }
+            if (code != VERTEX_EXPLICIT) {
+                v = fifos.vertex(code - 1);
+                return true;
+            }
+
+            uint32_t value = 0;
+            for (uint32_t shift = 0;; shift += 7) {
+                if (data == end || shift > 28)
+                    return false;
+                uint8_t byte = *data++;
+                value |= uint32_t(byte & 0x7F) << shift;
+                if (byte < 0x80)
+                    break;
+            }
+            last += (value >> 1) ^ (0u - (value & 1u));
+            v = last;
+            fifos.pushVertex(v);
+            return true;
+        }
+    };
+}
+
+const char* meshCodecIsa() {
+#if defined(CODEC_SSE2)
+    return "sse2";
+#elif defined(CODEC_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+size_t encodeVertexBufferBound(size_t vertexCnt, size_t vertexSize) {
+    size_t groupCnt = (vertexCnt + GROUP_SIZE - 1) / GROUP_SIZE;
+    return 1 + groupCnt * (vertexSize / 4 + vertexSize * GROUP_SIZE);
+}
+
+size_t encodeVertexBuffer(uint8_t* dst, size_t dstSize, const void* vertices, size_t vertexCnt, size_t vertexSize) {
+    if (!supportedVertexSize(vertexSize) || dstSize < encodeVertexBufferBound(vertexCnt, vertexSize))
+        return 0;
+
+    const uint8_t* src = static_cast<const uint8_t*>(vertices);
+    uint8_t* data = dst;
+    *data++ = VERTEX_HEADER;
+    uint8_t last[MAX_VERTEX_SIZE] = {};
+    for (size_t first = 0; first < vertexCnt; first += GROUP_SIZE) {
+        size_t count = std::min(GROUP_SIZE, vertexCnt - first);
+        uint8_t* header = data;
+        memset(header, 0, vertexSize / 4);
+        data += vertexSize / 4;
+
+        for (size_t k = 0; k < vertexSize; ++k) {
+            // vertices past the end repeat the last one, their deltas are zero
+            uint8_t deltas[GROUP_SIZE];
+            uint8_t previous = last[k], bits = 0;
+            for (size_t i = 0; i < GROUP_SIZE; ++i) {
+                uint8_t value = i < count ? src[(first + i) * vertexSize + k] : previous;
+                deltas[i] = zigzag8(uint8_t(value - previous));
+                bits |= deltas[i];
+                previous = value;
+            }
+            last[k] = previous;
+
+            uint32_t mode = bits == 0 ? 0 : bits < 4 ? 1 : bits < 16 ? 2 : 3;
+            header[k / 4] |= uint8_t(mode << (k % 4 * 2));
+            data = packPlane(data, deltas, mode);
+        }
+    }
+    return size_t(data - dst);
+}
+
+bool decodeVertexBuffer(void* dst, size_t vertexCnt, size_t vertexSize, const uint8_t* src, size_t srcSize) {
+#if defined(CODEC_SSE2) || defined(CODEC_NEON)
+    return decodeVertices<decodePlanesVector>(static_cast<uint8_t*>(dst), vertexCnt, vertexSize, src, srcSize);
+#else
+    return decodeVertices<decodePlanesScalar>(static_cast<uint8_t*>(dst), vertexCnt, vertexSize, src, srcSize);
+#endif
+}
+
+bool decodeVertexBufferScalar(void* dst, size_t vertexCnt, size_t vertexSize, const uint8_t* src, size_t srcSize) {
+    return decodeVertices<decodePlanesScalar>(static_cast<uint8_t*>(dst), vertexCnt, vertexSize, src, srcSize);
+}
+
+size_t encodeIndexBufferBound(size_t indexCnt) {
+    // a code byte, an extra one without a known edge and up to three five byte varints
+    return 1 + indexCnt / 3 * (2 + 3 * 5);
+}
+
+size_t encodeIndexBuffer(uint8_t* dst, size_t dstSize, const void* indices, size_t indexCnt, size_t indexSize) {
+    if ((indexSize != 2 && indexSize != 4) || indexCnt % 3 != 0 || dstSize < encodeIndexBufferBound(indexCnt))
+        return 0;
+
+    auto index = [&](size_t i) -> uint32_t {
+        return indexSize == 2 ? static_cast<const uint16_t*>(indices)[i] : static_cast<const uint32_t*>(indices)[i];
+    };
+
+    IndexEncoder encoder;
+    encoder.data = dst;
+    *encoder.data++ = INDEX_HEADER;
+    for (size_t i = 0; i < indexCnt; i += 3) {
+        uint32_t triangle[3] = {index(i), index(i + 1), index(i + 2)};
+
+        // the most recent edge this triangle shares, rotated so that edge comes first
+        uint32_t edge = EDGE_FIFO_SIZE - 1;
+        for (uint32_t e = 0; e < EDGE_FIFO_SIZE - 1 && edge == EDGE_FIFO_SIZE - 1; ++e) {
+            const uint32_t* fifoEdge = encoder.fifos.edge(e);
+            for (uint32_t r = 0; r < 3; ++r) {
+                if (fifoEdge[0] == triangle[r] && fifoEdge[1] == triangle[(r + 1) % 3]) {
+                    std::rotate(triangle, triangle + r, triangle + 3);
+                    edge = e;
+                    break;
+                }
+            }
+        }
+        uint32_t a = triangle[0], b = triangle[1], c = triangle[2];
+
+        uint8_t* code = encoder.data++;
+        if (edge != EDGE_FIFO_SIZE - 1) {
+            *code = uint8_t(edge << 4 | encoder.encodeVertex(c));
+        }
+        else {
+            uint8_t* extra = encoder.data++;
+            uint32_t codeA = encoder.encodeVertex(a);
+            uint32_t codeB = encoder.encodeVertex(b);
+            *code = uint8_t((EDGE_FIFO_SIZE - 1) << 4 | encoder.encodeVertex(c));
+            *extra = uint8_t(codeA << 4 | codeB);
+        }
+        encoder.fifos.pushTriangle(a, b, c);
+    }
+    return size_t(encoder.data - dst);
+}
+
+bool decodeIndexBuffer(void* dst, size_t indexCnt, size_t indexSize, const uint8_t* src, size_t srcSize) {
+    if ((indexSize != 2 && indexSize != 4) || indexCnt % 3 != 0 || srcSize == 0 || src[0] != INDEX_HEADER)
+        return false;
+
+    IndexDecoder decoder;
+    decoder.data = src + 1;
+    decoder.end = src + srcSize;
+    for (size_t i = 0; i < indexCnt; i += 3) {
+        if (decoder.data == decoder.end)
+            return false;
+        uint8_t code = *decoder.data++;
+        uint32_t edge = code >> 4, a, b, c;
+        if (edge != EDGE_FIFO_SIZE - 1) {
+            a = decoder.fifos.edge(edge)[0];
+            b = decoder.fifos.edge(edge)[1];
+            if (!decoder.decodeVertex(code & 15, c))
+                return false;
+        }
+        else {
+            if (decoder.data == decoder.end)
+                return false;
+            uint8_t extra = *decoder.data++;
+            if (!decoder.decodeVertex(extra >> 4, a) || !decoder.decodeVertex(extra & 15, b) || !decoder.decodeVertex(code & 15, c))
+                return false;
+        }
+        decoder.fifos.pushTriangle(a, b, c);
+
+        if (indexSize == 2) {
+            uint16_t* out = static_cast<uint16_t*>(dst) + i;
+            out[0] = uint16_t(a), out[1] = uint16_t(b), out[2] = uint16_t(c);
+        }
+        else {
+            uint32_t* out = static_cast<uint32_t*>(dst) + i;
+            out[0] = a, out[1] = b, out[2] = c;
+        }
+    }
+    return decoder.data == decoder.end;
+}
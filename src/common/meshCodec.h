@@ -0,0 +1,34 @@
+//meshCodec.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// instruction set the vertex decoder was compiled for
+const char* meshCodecIsa();
+
+// Vertex buffers are coded in groups of 16 vertices. Every byte of the vertex is a plane of its own: the 16 bytes are
+// deltas to the same byte of the previous vertex, zigzag coded and bit packed at 0, 2, 4 or 8 bits each, whichever
+// is the smallest that fits. Quantized attributes change slowly from one vertex to the next in a fetch optimized
+// order, so most planes pack into 2 or 4 bits. vertexSize has to be a multiple of 4 and at most 256 bytes
+size_t encodeVertexBufferBound(size_t vertexCnt, size_t vertexSize);
+
+// returns the encoded size, 0 when vertexSize is not supported or dst is smaller than the bound
+size_t encodeVertexBuffer(uint8_t* dst, size_t dstSize, const void* vertices, size_t vertexCnt, size_t vertexSize);
+
+// false when src is truncated, malformed or was encoded for a different vertex count or size
+bool decodeVertexBuffer(void* dst, size_t vertexCnt, size_t vertexSize, const uint8_t* src, size_t srcSize);
+
+// plain C++ version, the vector decoder has to match it byte for byte
+bool decodeVertexBufferScalar(void* dst, size_t vertexCnt, size_t vertexSize, const uint8_t* src, size_t srcSize);
+
+// Index buffers are coded a triangle at a time against a FIFO of recently seen edges and one of recently seen vertices.
+// A triangle sharing an edge with one of the last 15 costs a byte, its third vertex is either the next vertex never
+// seen before, one from the vertex FIFO or a varint delta. Triangles come back rotated so the shared edge is first,
+// the winding and the triangle order stay as they are. indexSize is 2 or 4 and indexCnt a multiple of 3
+size_t encodeIndexBufferBound(size_t indexCnt);
+
+size_t encodeIndexBuffer(uint8_t* dst, size_t dstSize, const void* indices, size_t indexCnt, size_t indexSize);
+
+bool decodeIndexBuffer(void* dst, size_t indexCnt, size_t indexSize, const uint8_t* src, size_t srcSize);
@@ -0,0 +1,251 @@
+#include "meshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    // triangles around every vertex as one flat array, offsets[v] .. offsets[v + 1]
+    struct TriangleAdjacency {
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        TriangleAdjacency(const uint32_t* indices, size_t indexCnt, size_t vertexCnt)
+            : counts(vertexCnt, 0), offsets(vertexCnt + 1, 0), triangles(indexCnt) {
+            for (size_t i = 0; i < indexCnt; ++i)
+                ++counts[indices[i]];
+            for (size_t v = 0; v < vertexCnt; ++v)
+                offsets[v + 1] = offsets[v] + counts[v];
+
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indexCnt; ++i)
+                triangles[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+    };
+
+    // a timestamped FIFO, a vertex is resident while fewer than cacheSize misses happened since it was loaded
+    struct FifoCache {
+        std::vector<uint32_t> timestamps;
+        uint32_t cacheSize;
+        uint32_t time;
+
+        FifoCache(size_t vertexCnt, uint32_t cacheSize) : timestamps(vertexCnt, 0), cacheSize(cacheSize), time(cacheSize + 1) {
+        }
+
+        uint32_t access(uint32_t vertex) {
+            if (time - timestamps[vertex] <= cacheSize)
+                return 0;
+            timestamps[vertex] = time++;
+            return 1;
+        }
+
+        uint32_t accessTriangle(const uint32_t* triangle) {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+
+        // everything cached so far counts as evicted
+        void flush() {
+            time += cacheSize + 1;
+        }
+    };
+}
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCnt, size_t vertexCnt, uint32_t cacheSize) {
+    FifoCache cache(vertexCnt, cacheSize);
+    size_t misses = 0;
+    for (size_t i = 0; i + 2 < indexCnt; i += 3)
+        misses += cache.accessTriangle(indices + i);
+
+    VertexCacheStats stats;
+    stats.acmr = indexCnt < 3 ? 0.0f : float(misses) / float(indexCnt / 3);
+    stats.atvr = vertexCnt == 0 ? 0.0f : float(misses) / float(vertexCnt);
+    return stats;
+}
+
+void optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCnt, size_t vertexCnt, uint32_t cacheSize) {
+    size_t triangleCnt = indexCnt / 3;
+    TriangleAdjacency adjacency(indices, triangleCnt * 3, vertexCnt);
+    std::vector<uint32_t>& liveTriangles = adjacency.counts; // still to be emitted around every vertex
+    std::vector<uint8_t> emitted(triangleCnt, 0);
+    std::vector<uint32_t> timestamps(vertexCnt, 0);
+    std::vector<uint32_t> deadEnds; // recently used vertices to continue from when a fan has no good successor
+    std::vector<uint32_t> candidates;
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0; // scan position for the last resort jump
+    size_t outCnt = 0;
+
+    uint32_t fan = triangleCnt == 0 ? INVALID_INDEX : indices[0];
+    while (fan != INVALID_INDEX) {
+        // emit every live triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t k = adjacency.offsets[fan]; k < adjacency.offsets[fan + 1]; ++k) {
+            uint32_t triangle = adjacency.triangles[k];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = 1;
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                dst[outCnt++] = vertex;
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if (time - timestamps[vertex] > cacheSize)
+                    timestamps[vertex] = time++;
+            }
+        }
+
+        // the candidate that stays cached while its remaining fan is emitted, oldest first so it is used before eviction
+        fan = INVALID_INDEX;
+        int32_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0)
+                continue;
+            int32_t priority = 0;
+            uint32_t age = time - timestamps[vertex];
+            if (age + 2 * liveTriangles[vertex] <= cacheSize)
+                priority = int32_t(age);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fan = vertex;
+            }
+        }
+        if (fan != INVALID_INDEX)
+            continue;
+
+        // dead end, back up through recently emitted vertices, then scan the input for any live vertex
+        while (!deadEnds.empty() && fan == INVALID_INDEX) {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0)
+                fan = vertex;
+        }
+        while (fan == INVALID_INDEX && cursor < triangleCnt * 3) {
+            uint32_t vertex = indices[cursor++];
+            if (liveTriangles[vertex] > 0)
+                fan = vertex;
+        }
+    }
+}
+
+void optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCnt, const float* positions, size_t vertexCnt,
+    size_t positionStride, float threshold, uint32_t cacheSize) {
+    size_t triangleCnt = indexCnt / 3;
+    if (triangleCnt == 0)
+        return;
+
+    // hard boundaries where all three vertices miss, the cache optimizer started a new patch there
+    FifoCache cache(vertexCnt, cacheSize);
+    std::vector<uint32_t> hardClusters;
+    for (size_t t = 0; t < triangleCnt; ++t) {
+        if (cache.accessTriangle(indices + t * 3) == 3 || t == 0)
+            hardClusters.push_back(uint32_t(t));
+    }
+
+    // soft boundaries inside every hard cluster, as soon as the running ACMR is good enough
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c < hardClusters.size(); ++c) {
+        size_t begin = hardClusters[c];
+        size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCnt;
+
+        cache.flush();
+        uint32_t clusterMisses = 0;
+        for (size_t t = begin; t < end; ++t)
+            clusterMisses += cache.accessTriangle(indices + t * 3);
+        float clusterThreshold = threshold * float(clusterMisses) / float(end - begin);
+
+        clusters.push_back(uint32_t(begin));
+        cache.flush();
+        uint32_t runningMisses = 0, runningTriangles = 0;
+        for (size_t t = begin; t < end; ++t) {
+            runningMisses += cache.accessTriangle(indices + t * 3);
+            ++runningTriangles;
+            if (float(runningMisses) / float(runningTriangles) <= clusterThreshold && t + 1 < end) {
+                clusters.push_back(uint32_t(t + 1));
+                cache.flush();
+                runningMisses = runningTriangles = 0;
+            }
+        }
+    }
+
+    auto position = [&](uint32_t vertex) {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+    };
+
+    // area weighted centroid of the mesh
+    double meshCenter[3] = {0.0, 0.0, 0.0};
+    double meshArea = 0.0;
+    std::vector<float> clusterCenters(clusters.size() * 3, 0.0f), clusterNormals(clusters.size() * 3, 0.0f);
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCnt;
+        float center[3] = {0.0f, 0.0f, 0.0f}, normal[3] = {0.0f, 0.0f, 0.0f};
+        float clusterArea = 0.0f;
+        for (size_t t = begin; t < end; ++t) {
+            const float* p0 = position(indices[t * 3 + 0]);
+            const float* p1 = position(indices[t * 3 + 1]);
+            const float* p2 = position(indices[t * 3 + 2]);
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            // twice the area along the face normal
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k) {
+                center[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+                normal[k] += n[k];
+            }
+            clusterArea += area;
+        }
+
+        float inverseArea = clusterArea == 0.0f ? 0.0f : 1.0f / clusterArea;
+        float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float inverseLength = normalLength == 0.0f ? 0.0f : 1.0f / normalLength;
+        for (int k = 0; k < 3; ++k) {
+            meshCenter[k] += center[k];
+            clusterCenters[c * 3 + k] = center[k] * inverseArea;
+            clusterNormals[c * 3 + k] = normal[k] * inverseLength;
+        }
+        meshArea += clusterArea;
+    }
+    for (int k = 0; k < 3; ++k)
+        meshCenter[k] = meshArea == 0.0 ? 0.0 : meshCenter[k] / meshArea;
+
+    // clusters that face away from the center occlude the rest, draw them first
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        float key = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            key += (clusterCenters[c * 3 + k] - float(meshCenter[k])) * clusterNormals[c * 3 + k];
+        sortKeys[c] = key;
+    }
+    std::vector<uint32_t> order(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c)
+        order[c] = uint32_t(c);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    size_t outCnt = 0;
+    for (uint32_t c : order) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCnt;
+        memcpy(dst + outCnt, indices + begin * 3, (end - begin) * 3 * sizeof(uint32_t));
+        outCnt += (end - begin) * 3;
+    }
+}
+
+size_t optimizeVertexFetch(void* dstVertices, uint32_t* indices, size_t indexCnt, const void* vertices, size_t vertexCnt, size_t vertexSize) {
+    const uint8_t* src = static_cast<const uint8_t*>(vertices);
+    uint8_t* dst = static_cast<uint8_t*>(dstVertices);
+    std::vector<uint32_t> remap(vertexCnt, INVALID_INDEX);
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < indexCnt; ++i) {
+        uint32_t& target = remap[indices[i]];
+        if (target == INVALID_INDEX) {
+            memcpy(dst + size_t(nextVertex) * vertexSize, src + size_t(indices[i]) * vertexSize, vertexSize);
+            target = nextVertex++;
+        }
+        indices[i] = target;
+    }
+    return nextVertex;
+}
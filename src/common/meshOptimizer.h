@@ -0,0 +1,29 @@
+//meshOptimizer.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// post-transform cache behaviour of an index buffer on a FIFO cache
+struct VertexCacheStats {
+	float acmr; // transformed vertices per triangle, 0.5 is the best a regular grid can do, 3 the worst
+	float atvr; // transformed vertices per vertex, 1 is ideal
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCnt, size_t vertexCnt, uint32_t cacheSize = 16);
+
+// reorder triangles for post-transform cache reuse with Tipsify (Sander et al. 2007), fanning around the most recently
+// used vertex and jumping to a vertex that is still live when the fan dies out. dst must not alias indices
+void optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCnt, size_t vertexCnt, uint32_t cacheSize = 16);
+
+// reorder clusters of a cache optimized index buffer so outward facing clusters far from the center are drawn first.
+// Clusters are split where the cache starts over and then wherever their ACMR stays within threshold times the
+// ACMR of the whole run, so threshold trades cache efficiency for overdraw. positions are three floats at the start
+// of every stride bytes. dst must not alias indices
+void optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCnt, const float* positions, size_t vertexCnt,
+	size_t positionStride, float threshold = 1.05f, uint32_t cacheSize = 16);
+
+// renumber vertices in the order the index buffer first uses them and rewrite indices in place. Vertices no triangle
+// uses are dropped, returns the count written to dstVertices, which must not alias vertices
+size_t optimizeVertexFetch(void* dstVertices, uint32_t* indices, size_t indexCnt, const void* vertices, size_t vertexCnt, size_t vertexSize);
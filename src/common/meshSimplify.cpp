@@ -0,0 +1,235 @@
+#include "meshSimplify.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+    // a collapse is rejected when it turns a neighbouring triangle further than about 75 degrees
+    constexpr double MIN_NORMAL_DOT = 0.25;
+
+    // symmetric 4x4 matrix of the squared distance to a set of planes, weighted by triangle area
+    struct Quadric {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double weight;
+
+        void addPlane(const double n[3], double d, double w) {
+            a00 += w * n[0] * n[0];
+            a01 += w * n[0] * n[1];
+            a02 += w * n[0] * n[2];
+            a11 += w * n[1] * n[1];
+            a12 += w * n[1] * n[2];
+            a22 += w * n[2] * n[2];
+            b0 += w * n[0] * d;
+            b1 += w * n[1] * d;
+            b2 += w * n[2] * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric& q) {
+            a00 += q.a00, a01 += q.a01, a02 += q.a02, a11 += q.a11, a12 += q.a12, a22 += q.a22;
+            b0 += q.b0, b1 += q.b1, b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        // mean squared distance of p to the planes
+        double error(const float* p) const {
+            double x = p[0], y = p[1], z = p[2];
+            double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight == 0.0 ? 0.0 : std::max(e, 0.0) / weight;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double error;
+    };
+
+    // triangles around every vertex of the current index buffer, rebuilt after every pass
+    struct VertexTriangles {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        void build(const std::vector<uint32_t>& indices, size_t vertexCnt) {
+            offsets.assign(vertexCnt + 1, 0);
+            for (uint32_t v : indices)
+                ++offsets[v + 1];
+            for (size_t v = 0; v < vertexCnt; ++v)
+                offsets[v + 1] += offsets[v];
+            triangles.resize(indices.size());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+                triangles[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+    };
+
+    const float* position(const float* positions, size_t positionStride, uint32_t vertex) {
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * positionStride);
+    }
+
+    void triangleNormal(const float* p0, const float* p1, const float* p2, double n[3]) {
+        double e1[3] = {double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2]};
+        double e2[3] = {double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2]};
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    // borders and seams, the vertices whose removal would tear the surface or its texture mapping
+    std::vector<uint8_t> findLockedVertices(const uint32_t* indices, size_t indexCnt, const float* positions, size_t vertexCnt,
+        size_t positionStride) {
+        std::vector<uint8_t> locked(vertexCnt, 0);
+
+        // an edge nobody walks the other way is open
+        std::unordered_set<uint64_t> edges;
+        edges.reserve(indexCnt);
+        for (size_t i = 0; i < indexCnt; ++i)
+            edges.insert(uint64_t(indices[i]) << 32 | indices[i - i % 3 + (i + 1) % 3]);
+        for (size_t i = 0; i < indexCnt; ++i) {
+            uint32_t a = indices[i], b = indices[i - i % 3 + (i + 1) % 3];
+            if (edges.count(uint64_t(b) << 32 | a) == 0)
+                locked[a] = locked[b] = 1;
+        }
+
+        // deduplicated vertices sharing a position differ in some other attribute
+        struct PositionHash {
+            size_t operator()(const std::array<uint32_t, 3>& p) const {
+                return (size_t(p[0]) * 73856093u) ^ (size_t(p[1]) * 19349663u) ^ (size_t(p[2]) * 83492791u);
+            }
+        };
+        std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> firstAtPosition;
+        firstAtPosition.reserve(vertexCnt);
+        for (uint32_t v = 0; v < vertexCnt; ++v) {
+            std::array<uint32_t, 3> key;
+            memcpy(key.data(), position(positions, positionStride, v), sizeof(key));
+            auto inserted = firstAtPosition.emplace(key, v);
+            if (!inserted.second)
+                locked[v] = locked[inserted.first->second] = 1;
+        }
+        return locked;
+    }
+
+    // whether moving from onto to turns any of from's other triangles over or squashes it flat
+    bool flipsTriangle(const std::vector<uint32_t>& indices, const VertexTriangles& adjacency, uint32_t from, uint32_t to,
+        const float* positions, size_t positionStride) {
+        const float* target = position(positions, positionStride, to);
+        for (uint32_t k = adjacency.offsets[from]; k < adjacency.offsets[from + 1]; ++k) {
+            const uint32_t* triangle = &indices[adjacency.triangles[k] * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue; // collapses away
+            const float* p[3];
+            const float* moved[3];
+            for (int c = 0; c < 3; ++c) {
+                p[c] = position(positions, positionStride, triangle[c]);
+                moved[c] = triangle[c] == from ? target : p[c];
+            }
+            double before[3], after[3];
+            triangleNormal(p[0], p[1], p[2], before);
+            triangleNormal(moved[0], moved[1], moved[2], after);
+            double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+            double lengths = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                std::sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+            if (dot <= MIN_NORMAL_DOT * lengths)
+                return true;
+        }
+        return false;
+    }
+}
+
+size_t simplifyMesh(uint32_t* dst, const uint32_t* indices, size_t indexCnt, const float* positions, size_t vertexCnt,
+    size_t positionStride, size_t targetIndexCnt, float targetError, float* resultError) {
+    indexCnt -= indexCnt % 3;
+    std::vector<uint32_t> current(indices, indices + indexCnt);
+    std::vector<uint8_t> locked = findLockedVertices(indices, indexCnt, positions, vertexCnt, positionStride);
+
+    // every vertex starts with the planes of the triangles around it
+    std::vector<Quadric> quadrics(vertexCnt, Quadric{});
+    for (size_t i = 0; i < indexCnt; i += 3) {
+        const float* p0 = position(positions, positionStride, indices[i]);
+        double n[3];
+        triangleNormal(p0, position(positions, positionStride, indices[i + 1]), position(positions, positionStride, indices[i + 2]), n);
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0)
+            continue;
+        n[0] /= length, n[1] /= length, n[2] /= length;
+        double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        for (size_t c = 0; c < 3; ++c)
+            quadrics[indices[i + c]].addPlane(n, d, length * 0.5);
+    }
+
+    double maxError = 0.0, errorLimit = double(targetError) * targetError;
+    VertexTriangles adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> touched(vertexCnt);
+    std::vector<uint32_t> remap(vertexCnt);
+    std::iota(remap.begin(), remap.end(), 0u);
+
+    // passes of independent collapses, cheapest first, until the target is met or nothing cheap enough is left
+    while (current.size() > targetIndexCnt) {
+        adjacency.build(current, vertexCnt);
+
+        // every edge once, from the triangle that walks it from the lower vertex, in its cheaper direction
+        collapses.clear();
+        for (size_t i = 0; i < current.size(); ++i) {
+            uint32_t a = current[i], b = current[i - i % 3 + (i + 1) % 3];
+            if (a >= b || (locked[a] && locked[b]))
+                continue;
+            Quadric merged = quadrics[a];
+            merged.add(quadrics[b]);
+            double toB = locked[a] ? INFINITY : merged.error(position(positions, positionStride, b));
+            double toA = locked[b] ? INFINITY : merged.error(position(positions, positionStride, a));
+            collapses.push_back(toB <= toA ? Collapse{a, b, toB} : Collapse{b, a, toA});
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // a collapse touches the triangles around its vertex, later ones this pass have to stay clear of them
+        std::fill(touched.begin(), touched.end(), uint8_t(0));
+        size_t triangleCnt = current.size() / 3, targetTriangleCnt = targetIndexCnt / 3, collapseCnt = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > errorLimit || triangleCnt <= targetTriangleCnt)
+                break;
+            if (touched[collapse.from] || touched[collapse.to] ||
+                flipsTriangle(current, adjacency, collapse.from, collapse.to, positions, positionStride))
+                continue;
+
+            for (uint32_t k = adjacency.offsets[collapse.from]; k < adjacency.offsets[collapse.from + 1]; ++k) {
+                const uint32_t* triangle = &current[adjacency.triangles[k] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+                triangleCnt -= triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxError = std::max(maxError, collapse.error);
+            ++collapseCnt;
+        }
+        if (collapseCnt == 0)
+            break;
+
+        // a collapsed vertex is never a target in the same pass, one lookup is enough
+        size_t outCnt = 0;
+        for (size_t i = 0; i < current.size(); i += 3) {
+            uint32_t a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            current[outCnt++] = a;
+            current[outCnt++] = b;
+            current[outCnt++] = c;
+        }
+        current.resize(outCnt);
+    }
+
+    if (resultError)
+        *resultError = float(std::sqrt(maxError));
+    std::copy(current.begin(), current.end(), dst);
+    return current.size();
+}
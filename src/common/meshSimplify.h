@@ -0,0 +1,15 @@
+//meshSimplify.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// collapse edges in order of quadric error (Garland and Heckbert 1997) until the index count is down to targetIndexCnt
+// or the next collapse would move the surface further than targetError, in the units of the positions. A vertex only
+// ever collapses onto one of its neighbours, so the result indexes the same vertex buffer and every level of detail
+// can share it. Vertices on open borders and on attribute seams, where vertices at one position differ in their other
+// attributes, are never moved. positions are three floats at the start of every stride bytes, dst may alias indices.
+// Returns the index count written, resultError receives the largest error of the collapses taken
+size_t simplifyMesh(uint32_t* dst, const uint32_t* indices, size_t indexCnt, const float* positions, size_t vertexCnt,
+	size_t positionStride, size_t targetIndexCnt, float targetError, float* resultError = nullptr);
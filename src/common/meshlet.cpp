@@ -0,0 +1,226 @@
+#include "meshlet.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CULL_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CULL_NEON // vsqrtq_f32 only exists on 64-bit arm
+#endif
+
+namespace {
+    // below this the normals spread over more than a hemisphere minus a margin, such a cone never culls
+    constexpr float MIN_CONE_SPREAD = 0.1f;
+
+    const float* position(const float* positions, size_t positionStride, uint32_t vertex) {
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * positionStride);
+    }
+
+    void computeBounds(Meshlet& meshlet, const uint32_t* indices, const float* positions, size_t positionStride) {
+        const uint32_t* first = indices + meshlet.firstIndex;
+
+        // sphere around the box of the corners
+        float minPos[3] = {INFINITY, INFINITY, INFINITY}, maxPos[3] = {-INFINITY, -INFINITY, -INFINITY};
+        for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+            const float* p = position(positions, positionStride, first[i]);
+            for (int c = 0; c < 3; ++c) {
+                minPos[c] = std::min(minPos[c], p[c]);
+                maxPos[c] = std::max(maxPos[c], p[c]);
+            }
+        }
+        float radius = 0.0f;
+        for (int c = 0; c < 3; ++c)
+            meshlet.center[c] = (minPos[c] + maxPos[c]) * 0.5f;
+        for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+            const float* p = position(positions, positionStride, first[i]);
+            float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+            radius = std::max(radius, dx * dx + dy * dy + dz * dz);
+        }
+        meshlet.radius = std::sqrt(radius);
+
+        // cone around the unit normals of the triangles with an area, counter clockwise is front facing
+        std::vector<float> normals;
+        float axis[3] = {0.0f, 0.0f, 0.0f};
+        for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+            const float* p0 = position(positions, positionStride, first[i]);
+            const float* p1 = position(positions, positionStride, first[i + 1]);
+            const float* p2 = position(positions, positionStride, first[i + 2]);
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0.0f)
+                continue;
+            for (int c = 0; c < 3; ++c) {
+                normals.push_back(n[c] / length);
+                axis[c] += n[c] / length;
+            }
+        }
+        float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        float minDot = 1.0f;
+        for (int c = 0; c < 3; ++c)
+            meshlet.coneAxis[c] = axisLength == 0.0f ? 0.0f : axis[c] / axisLength;
+        for (size_t i = 0; i < normals.size(); i += 3)
+            minDot = std::min(minDot, normals[i] * meshlet.coneAxis[0] + normals[i + 1] * meshlet.coneAxis[1] + normals[i + 2] * meshlet.coneAxis[2]);
+        meshlet.coneCutoff = axisLength == 0.0f || minDot <= MIN_CONE_SPREAD ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+
+    // the tests of cullMeshlets for meshlets first .. last
+    size_t cullRange(const MeshletCullData& data, const float planes[6][4], const float camera[3], size_t first, size_t last, uint32_t* visible) {
+        size_t visibleCnt = 0;
+        for (size_t i = first; i < last; ++i) {
+            float x = data.centerX[i], y = data.centerY[i], z = data.centerZ[i], r = data.radius[i];
+            bool inside = true;
+            for (int p = 0; p < 6; ++p)
+                inside &= planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] >= -r;
+
+            // every triangle faces away when the view direction stays within the cone's complement for the whole sphere
+            float vx = x - camera[0], vy = y - camera[1], vz = z - camera[2];
+            float distance = std::sqrt(vx * vx + vy * vy + vz * vz);
+            bool backFacing = vx * data.axisX[i] + vy * data.axisY[i] + vz * data.axisZ[i] >= data.cutoff[i] * distance + r;
+            if (inside && !backFacing)
+                visible[visibleCnt++] = uint32_t(i);
+        }
+        return visibleCnt;
+    }
+}
+
+std::vector<Meshlet> buildMeshlets(const uint32_t* indices, size_t indexCnt, const float* positions, size_t vertexCnt,
+    size_t positionStride, size_t maxVertices, size_t maxTriangles) {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> owner(vertexCnt, UINT32_MAX); // meshlet a vertex was last counted for
+    Meshlet meshlet = {};
+    for (size_t i = 0; i + 2 < indexCnt; i += 3) {
+        uint32_t newCnt = 0;
+        for (size_t c = 0; c < 3; ++c) {
+            uint32_t v = indices[i + c];
+            newCnt += owner[v] != meshlets.size() && (c == 0 || v != indices[i]) && (c < 2 || v != indices[i + 1]);
+        }
+
+        // the triangle opens the next meshlet when it does not fit
+        if (meshlet.indexCount != 0 && (meshlet.vertexCount + newCnt > maxVertices || meshlet.indexCount / 3 == maxTriangles)) {
+            computeBounds(meshlet, indices, positions, positionStride);
+            meshlets.push_back(meshlet);
+            meshlet = {};
+            meshlet.firstIndex = uint32_t(i);
+            newCnt = 0;
+            for (size_t c = 0; c < 3; ++c)
+                newCnt += (c == 0 || indices[i + c] != indices[i]) && (c < 2 || indices[i + c] != indices[i + 1]);
+        }
+        for (size_t c = 0; c < 3; ++c)
+            owner[indices[i + c]] = uint32_t(meshlets.size());
+        meshlet.vertexCount += newCnt;
+        meshlet.indexCount += 3;
+    }
+    if (meshlet.indexCount != 0) {
+        computeBounds(meshlet, indices, positions, positionStride);
+        meshlets.push_back(meshlet);
+    }
+    return meshlets;
+}
+
+MeshletCullData prepareMeshletCulling(const std::vector<Meshlet>& meshlets) {
+    MeshletCullData data;
+    data.count = meshlets.size();
+    for (const Meshlet& meshlet : meshlets) {
+        data.centerX.push_back(meshlet.center[0]);
+        data.centerY.push_back(meshlet.center[1]);
+        data.centerZ.push_back(meshlet.center[2]);
+        data.radius.push_back(meshlet.radius);
+        data.axisX.push_back(meshlet.coneAxis[0]);
+        data.axisY.push_back(meshlet.coneAxis[1]);
+        data.axisZ.push_back(meshlet.coneAxis[2]);
+        data.cutoff.push_back(meshlet.coneCutoff);
+    }
+    return data;
+}
+
+void extractFrustumPlanes(const float clipFromObject[16], float planes[6][4]) {
+    // row r of the matrix is element r of every column
+    auto row = [&](int r, int c) { return clipFromObject[c * 4 + r]; };
+    for (int c = 0; c < 4; ++c) {
+        planes[0][c] = row(3, c) + row(0, c); // left
+        planes[1][c] = row(3, c) - row(0, c); // right
+        planes[2][c] = row(3, c) + row(1, c); // bottom or top, the sign of y does not matter
+        planes[3][c] = row(3, c) - row(1, c);
+        planes[4][c] = row(2, c); // near, depth is 0 there
+        planes[5][c] = row(3, c) - row(2, c); // far
+    }
+    for (int p = 0; p < 6; ++p) {
+        float length = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        for (int c = 0; c < 4; ++c)
+            planes[p][c] /= length;
+    }
+}
+
+const char* meshletCullIsa() {
+#if defined(CULL_SSE2)
+    return "sse2";
+#elif defined(CULL_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+size_t cullMeshletsScalar(const MeshletCullData& data, const float planes[6][4], const float camera[3], uint32_t* visible) {
+    return cullRange(data, planes, camera, 0, data.count, visible);
+}
+
+size_t cullMeshlets(const MeshletCullData& data, const float planes[6][4], const float camera[3], uint32_t* visible) {
+    size_t i = 0, visibleCnt = 0;
+#if defined(CULL_SSE2)
+    __m128 cameraX = _mm_set1_ps(camera[0]), cameraY = _mm_set1_ps(camera[1]), cameraZ = _mm_set1_ps(camera[2]);
+    for (; i + 4 <= data.count; i += 4) {
+        __m128 x = _mm_loadu_ps(&data.centerX[i]), y = _mm_loadu_ps(&data.centerY[i]), z = _mm_loadu_ps(&data.centerZ[i]);
+        __m128 r = _mm_loadu_ps(&data.radius[i]);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p][0]), x), _mm_mul_ps(_mm_set1_ps(planes[p][1]), y)),
+                _mm_mul_ps(_mm_set1_ps(planes[p][2]), z)), _mm_set1_ps(planes[p][3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+        }
+
+        __m128 vx = _mm_sub_ps(x, cameraX), vy = _mm_sub_ps(y, cameraY), vz = _mm_sub_ps(z, cameraZ);
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+        __m128 facing = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&data.axisX[i])), _mm_mul_ps(vy, _mm_loadu_ps(&data.axisY[i]))),
+            _mm_mul_ps(vz, _mm_loadu_ps(&data.axisZ[i])));
+        __m128 backFacing = _mm_cmpge_ps(facing, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&data.cutoff[i]), distance), r));
+
+        int mask = _mm_movemask_ps(_mm_andnot_ps(backFacing, inside));
+        for (int lane = 0; lane < 4; ++lane)
+            if (mask & (1 << lane))
+                visible[visibleCnt++] = uint32_t(i + lane);
+    }
+#elif defined(CULL_NEON)
+    float32x4_t cameraX = vdupq_n_f32(camera[0]), cameraY = vdupq_n_f32(camera[1]), cameraZ = vdupq_n_f32(camera[2]);
+    for (; i + 4 <= data.count; i += 4) {
+        float32x4_t x = vld1q_f32(&data.centerX[i]), y = vld1q_f32(&data.centerY[i]), z = vld1q_f32(&data.centerZ[i]);
+        float32x4_t r = vld1q_f32(&data.radius[i]);
+        float32x4_t negR = vnegq_f32(r);
+        uint32x4_t inside = vdupq_n_u32(UINT32_MAX);
+        for (int p = 0; p < 6; ++p) {
+            // separate multiplies and adds, a fused multiply add would round differently from the scalar version
+            float32x4_t d = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(x, planes[p][0]), vmulq_n_f32(y, planes[p][1])),
+                vmulq_n_f32(z, planes[p][2])), vdupq_n_f32(planes[p][3]));
+            inside = vandq_u32(inside, vcgeq_f32(d, negR));
+        }
+
+        float32x4_t vx = vsubq_f32(x, cameraX), vy = vsubq_f32(y, cameraY), vz = vsubq_f32(z, cameraZ);
+        float32x4_t distance = vsqrtq_f32(vaddq_f32(vaddq_f32(vmulq_f32(vx, vx), vmulq_f32(vy, vy)), vmulq_f32(vz, vz)));
+        float32x4_t facing = vaddq_f32(vaddq_f32(vmulq_f32(vx, vld1q_f32(&data.axisX[i])), vmulq_f32(vy, vld1q_f32(&data.axisY[i]))),
+            vmulq_f32(vz, vld1q_f32(&data.axisZ[i])));
+        uint32x4_t backFacing = vcgeq_f32(facing, vaddq_f32(vmulq_f32(vld1q_f32(&data.cutoff[i]), distance), r));
+
+        uint32_t lanes[4];
+        vst1q_u32(lanes, vbicq_u32(inside, backFacing));
+        for (int lane = 0; lane < 4; ++lane)
+            if (lanes[lane])
+                visible[visibleCnt++] = uint32_t(i + lane);
+    }
+#endif
+    return visibleCnt + cullRange(data, planes, camera, i, data.count, visible + visibleCnt);
+}
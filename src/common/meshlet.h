@@ -0,0 +1,47 @@
+//meshlet.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a cluster of triangles drawn as one range of the index buffer, with the bounds it is culled by
+struct Meshlet {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexCount; // distinct vertices the range references
+	float center[3];
+	float radius;
+	float coneAxis[3]; // average facing of the triangles
+	float coneCutoff; // sine of the cone's half angle, 1 when the triangles face too many ways to ever cull
+};
+
+// split an index buffer into meshlets of at most maxVertices distinct vertices and maxTriangles triangles. Triangles
+// keep their order, so a cache and overdraw optimized buffer turns into meshlets without being rewritten. positions
+// are three floats at the start of every stride bytes
+std::vector<Meshlet> buildMeshlets(const uint32_t* indices, size_t indexCnt, const float* positions, size_t vertexCnt,
+	size_t positionStride, size_t maxVertices = 64, size_t maxTriangles = 124);
+
+// meshlet bounds one array per component, so the culling kernels test four meshlets at once
+struct MeshletCullData {
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> axisX, axisY, axisZ, cutoff;
+	size_t count = 0;
+};
+
+MeshletCullData prepareMeshletCulling(const std::vector<Meshlet>& meshlets);
+
+// six inward facing planes, (a, b, c, d) with a normalized abc, of a column major clip from object matrix whose
+// depth range is [0, 1]. The planes are in object space, where the meshlet bounds are
+void extractFrustumPlanes(const float clipFromObject[16], float planes[6][4]);
+
+// instruction set the culling kernel was compiled for
+const char* meshletCullIsa();
+
+// writes the indices of the meshlets that intersect the frustum and may face camera, both in the meshlets' space, in
+// ascending order to visible and returns their count
+size_t cullMeshlets(const MeshletCullData& data, const float planes[6][4], const float camera[3], uint32_t* visible);
+
+// plain C++ version, the vector kernel uses it for its tail and must agree with it
+size_t cullMeshletsScalar(const MeshletCullData& data, const float planes[6][4], const float camera[3], uint32_t* visible);
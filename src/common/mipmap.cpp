@@ -0,0 +1,128 @@
+#include "mipmap.h"
+#include "pixelConvert.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MIPMAP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define MIPMAP_NEON
+#endif
+
+namespace {
+    // average 2x2 blocks of two linear rows into one output row
+    void downsampleRow(const uint16_t* row0, const uint16_t* row1, uint32_t srcWidth, uint16_t* dst, uint32_t dstWidth) {
+        uint32_t x = 0;
+        if (srcWidth >= 2) {
+#if defined(MIPMAP_SSE2)
+            const __m128i rounding = _mm_set1_epi16(2);
+            for (; x + 2 <= dstWidth; x += 2) {
+                // two source pixel pairs per row and register
+                __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+                __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 8));
+                __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+                __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 8));
+                __m128i s0 = _mm_add_epi16(a0, b0);
+                __m128i s1 = _mm_add_epi16(a1, b1);
+                // fold the horizontal neighbours, low half of each sum is one output pixel
+                s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+                s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+                __m128i sum = _mm_unpacklo_epi64(s0, s1);
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), sum);
+            }
+#elif defined(MIPMAP_NEON)
+            const uint16x4_t rounding = vdup_n_u16(2);
+            for (; x < dstWidth; ++x) {
+                uint16x8_t s = vaddq_u16(vld1q_u16(row0 + x * 8), vld1q_u16(row1 + x * 8));
+                uint16x4_t sum = vadd_u16(vadd_u16(vget_low_u16(s), vget_high_u16(s)), rounding);
+                vst1_u16(dst + x * 4, vshr_n_u16(sum, 2));
+            }
+#endif
+        }
+        for (; x < dstWidth; ++x) {
+            uint32_t x0 = std::min(2 * x, srcWidth - 1);
+            uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+            for (uint32_t c = 0; c < 4; ++c) {
+                uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+                dst[x * 4 + c] = static_cast<uint16_t>((sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        ++levels;
+    return levels;
+}
+
+MipChain generateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, ThreadPool& threadPool) {
+    // lay out all levels
+    MipChain chain;
+    uint32_t levelCnt = mipLevelCount(width, height);
+    size_t totalSize = 0;
+    for (uint32_t i = 0; i < levelCnt; ++i) {
+        MipLevel level;
+        level.width = std::max(width >> i, 1u);
+        level.height = std::max(height >> i, 1u);
+        level.offset = totalSize;
+        level.size = size_t(level.width) * level.height * 4;
+        totalSize += level.size;
+        chain.levels.push_back(level);
+    }
+    chain.data.resize(totalSize);
+    memcpy(chain.data.data(), rgba, chain.levels[0].size);
+
+    // keep the chain in linear space so every level is filtered from full precision data
+    std::vector<uint16_t> srcLinear(size_t(width) * height * 4);
+    std::vector<uint16_t> dstLinear(size_t(std::max(width >> 1, 1u)) * std::max(height >> 1, 1u) * 4);
+    threadPool.parallelFor(height, 16, [&](size_t begin, size_t end) {
+        rgbaToLinearFixed(rgba + begin * width * 4, srcLinear.data() + begin * width * 4, (end - begin) * width, srgb);
+    });
+
+    for (uint32_t i = 1; i < levelCnt; ++i) {
+        const MipLevel& src = chain.levels[i - 1];
+        const MipLevel& dst = chain.levels[i];
+        uint8_t* out = chain.data.data() + dst.offset;
+        threadPool.parallelFor(dst.height, 8, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                const uint16_t* row0 = srcLinear.data() + std::min<size_t>(2 * y, src.height - 1) * src.width * 4;
+                const uint16_t* row1 = srcLinear.data() + std::min<size_t>(2 * y + 1, src.height - 1) * src.width * 4;
+                uint16_t* dstRow = dstLinear.data() + y * dst.width * 4;
+                downsampleRow(row0, row1, src.width, dstRow, dst.width);
+                linearFixedToRgba(dstRow, out + y * dst.width * 4, dst.width, srgb);
+            }
+        });
+        std::swap(srcLinear, dstLinear);
+    }
+
+    return chain;
+}
+
+uint32_t mipTailLevel(const std::vector<MipLevel>& levels, uint32_t tailSize) {
+    uint32_t level = 0;
+    while (level + 1 < levels.size() && std::max(levels[level].width, levels[level].height) > tailSize)
+        ++level;
+    return level;
+}
+
+std::vector<MipLevel> mipLevelRange(const std::vector<MipLevel>& levels, uint32_t first) {
+    std::vector<MipLevel> range(levels.begin() + first, levels.end());
+    for (auto& level : range)
+        level.offset -= levels[first].offset;
+    return range;
+}
+
+uint32_t screenSpaceMipLevel(uint32_t textureSize, float worldSize, float distance, float fovY, uint32_t screenHeight, uint32_t levelCount) {
+    // pixels covered by worldSize units at that distance, then one level per halving of the texel density
+    float pixels = worldSize / (2.0f * std::max(distance, 1e-3f) * std::tan(fovY * 0.5f)) * screenHeight;
+    float texelsPerPixel = textureSize / std::max(pixels, 1.0f);
+    uint32_t level = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel))) : 0;
+    return std::min(level, levelCount - 1);
+}
@@ -0,0 +1,38 @@
+//mipmap.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+struct MipLevel {
+	uint32_t width;
+	uint32_t height;
+	size_t offset;
+	size_t size;
+};
+
+struct MipChain {
+	std::vector<uint8_t> data; // all levels packed one after another, RGBA8
+	std::vector<MipLevel> levels;
+};
+
+// number of levels down to 1x1
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// build a full RGBA8 mip chain with a 2x2 box filter, averaging in linear space when srgb is set
+// so the chain does not darken, levels are filtered on the thread pool
+MipChain generateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, ThreadPool& threadPool);
+
+// first level no larger than tailSize in either dimension, the part of a streamed texture made resident up front
+uint32_t mipTailLevel(const std::vector<MipLevel>& levels, uint32_t tailSize);
+
+// levels from first to the end, offsets rebased so first starts at 0
+std::vector<MipLevel> mipLevelRange(const std::vector<MipLevel>& levels, uint32_t first);
+
+// finest level worth sampling for a textureSize texel wide texture stretched over worldSize units seen at distance,
+// from how many texels land on one pixel of a screenHeight tall viewport with vertical field of view fovY
+uint32_t screenSpaceMipLevel(uint32_t textureSize, float worldSize, float distance, float fovY, uint32_t screenHeight, uint32_t levelCount);
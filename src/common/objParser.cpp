@@ -0,0 +1,510 @@
+#include "objParser.h"
+#include "mappedFile.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        std::vector<float> positions;
+        std::vector<float> texcoords;
+        std::vector<ObjIndex> corners; // face corners as written, before triangulation
+        std::vector<uint8_t> faceSizes; // 3 or 4
+        // negative indices count back from the current line, they are resolved once earlier chunks are counted
+        std::vector<std::pair<size_t, int32_t>> positionFixups;
+        std::vector<std::pair<size_t, int32_t>> texcoordFixups;
+        std::vector<std::string> libraries;
+        std::vector<std::pair<size_t, std::string>> materialUses; // usemtl names at the triangle corner they start at
+        size_t triangleCornerCnt = 0;
+        std::string error;
+    };
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    const char* skipBlanks(const char* cursor, const char* end) {
+        while (cursor < end && isBlank(*cursor))
+            ++cursor;
+        return cursor;
+    }
+
+    const char* tokenEnd(const char* cursor, const char* end) {
+        while (cursor < end && !isBlank(*cursor) && *cursor != '\r')
+            ++cursor;
+        return cursor;
+    }
+
+    // tinyobj parses into a double and narrows, so does this, a missing or malformed value reads as 0
+    float parseFloat(const char*& cursor, const char* end) {
+        cursor = skipBlanks(cursor, end);
+        const char* last = tokenEnd(cursor, end);
+        const char* first = cursor < last && *cursor == '+' ? cursor + 1 : cursor;
+        double value = 0.0;
+        if (std::from_chars(first, last, value).ec != std::errc())
+            value = 0.0;
+        cursor = last;
+        return static_cast<float>(value);
+    }
+
+    bool parseInt(const char*& cursor, const char* end, int32_t& value) {
+        if (cursor < end && *cursor == '+')
+            ++cursor;
+        auto result = std::from_chars(cursor, end, value);
+        cursor = result.ptr;
+        return result.ec == std::errc();
+    }
+
+    // one based or negative relative to the count so far, false for 0 which OBJ does not allow
+    bool resolveIndex(int32_t raw, size_t localCnt, size_t corner, std::vector<std::pair<size_t, int32_t>>& fixups, int32_t& index) {
+        if (raw > 0) {
+            index = raw - 1;
+            return true;
+        }
+        if (raw < 0) {
+            index = 0;
+            fixups.push_back({corner, int32_t(localCnt) + raw});
+            return true;
+        }
+        return false;
+    }
+
+    bool parseFace(Chunk& chunk, const char* cursor, const char* end) {
+        ObjIndex face[4];
+        size_t faceSize = 0;
+        while (true) {
+            cursor = skipBlanks(cursor, end);
+            if (cursor >= end || *cursor == '\r')
+                break;
+            if (faceSize == 4) {
+                chunk.error = "polygons with more than four corners are not supported";
+                return false;
+            }
+
+            // v, v/vt, v//vn or v/vt/vn
+            int32_t position = 0, texcoord = 0;
+            if (!parseInt(cursor, end, position)) {
+                chunk.error = "malformed face";
+                return false;
+            }
+            if (cursor < end && *cursor == '/') {
+                ++cursor;
+                if (cursor < end && *cursor != '/' && !parseInt(cursor, end, texcoord)) {
+                    chunk.error = "malformed face";
+                    return false;
+                }
+            }
+            cursor = tokenEnd(cursor, end);
+
+            size_t corner = chunk.corners.size() + faceSize;
+            ObjIndex& index = face[faceSize++];
+            index.texcoord = -1;
+            if (!resolveIndex(position, chunk.positions.size() / 3, corner, chunk.positionFixups, index.position) ||
+                (texcoord != 0 && !resolveIndex(texcoord, chunk.texcoords.size() / 2, corner, chunk.texcoordFixups, index.texcoord))) {
+                chunk.error = "face index 0";
+                return false;
+            }
+        }
+
+        // tinyobj drops faces with less than three corners
+        if (faceSize < 3) {
+            chunk.positionFixups.erase(std::remove_if(chunk.positionFixups.begin(), chunk.positionFixups.end(),
+                [&](const std::pair<size_t, int32_t>& fixup) { return fixup.first >= chunk.corners.size(); }), chunk.positionFixups.end());
+            chunk.texcoordFixups.erase(std::remove_if(chunk.texcoordFixups.begin(), chunk.texcoordFixups.end(),
+                [&](const std::pair<size_t, int32_t>& fixup) { return fixup.first >= chunk.corners.size(); }), chunk.texcoordFixups.end());
+            return true;
+        }
+        chunk.corners.insert(chunk.corners.end(), face, face + faceSize);
+        chunk.faceSizes.push_back(uint8_t(faceSize));
+        chunk.triangleCornerCnt += (faceSize - 2) * 3;
+        return true;
+    }
+
+    void parseChunk(Chunk& chunk) {
+        for (const char* line = chunk.begin; line < chunk.end;) {
+            const char* lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+            if (lineEnd == nullptr)
+                lineEnd = chunk.end;
+
+            const char* cursor = skipBlanks(line, lineEnd);
+            size_t length = lineEnd - cursor;
+            if (length >= 2 && cursor[0] == 'v' && isBlank(cursor[1])) {
+                cursor += 2;
+                for (int i = 0; i < 3; ++i)
+                    chunk.positions.push_back(parseFloat(cursor, lineEnd));
+            }
+            else if (length >= 3 && cursor[0] == 'v' && cursor[1] == 't' && isBlank(cursor[2])) {
+                cursor += 3;
+                for (int i = 0; i < 2; ++i)
+                    chunk.texcoords.push_back(parseFloat(cursor, lineEnd));
+            }
+            else if (length >= 2 && cursor[0] == 'f' && isBlank(cursor[1])) {
+                if (!parseFace(chunk, cursor + 2, lineEnd))
+                    return;
+            }
+            else if (length >= 7 && memcmp(cursor, "usemtl", 6) == 0 && isBlank(cursor[6])) {
+                // the first word, as tinyobj reads it
+                cursor = skipBlanks(cursor + 7, lineEnd);
+                chunk.materialUses.push_back({chunk.triangleCornerCnt, std::string(cursor, tokenEnd(cursor, lineEnd))});
+            }
+            else if (length >= 7 && memcmp(cursor, "mtllib", 6) == 0 && isBlank(cursor[6])) {
+                for (cursor = skipBlanks(cursor + 7, lineEnd); cursor < lineEnd && *cursor != '\r'; cursor = skipBlanks(cursor, lineEnd)) {
+                    const char* last = tokenEnd(cursor, lineEnd);
+                    chunk.libraries.emplace_back(cursor, last);
+                    cursor = last;
+                }
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+    bool inRange(int32_t index, size_t count) {
+        return index >= 0 && size_t(index) < count;
+    }
+
+    // line aligned chunks, a few per worker, parsed in parallel
+    bool parseText(const char* text, size_t size, ThreadPool& threadPool, std::vector<Chunk>& chunks, std::string& error) {
+        size_t chunkSize = std::max(MIN_CHUNK_SIZE, size / (threadPool.size() * 4) + 1);
+        chunks.clear();
+        for (const char* begin = text; begin < text + size;) {
+            const char* end = begin + std::min(chunkSize, size_t(text + size - begin));
+            const char* newline = end < text + size ? static_cast<const char*>(memchr(end, '\n', text + size - end)) : nullptr;
+            end = newline != nullptr ? newline + 1 : text + size;
+            chunks.emplace_back();
+            chunks.back().begin = begin;
+            chunks.back().end = end;
+            begin = end;
+        }
+
+        threadPool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i)
+                parseChunk(chunks[i]);
+        });
+        for (const auto& chunk : chunks) {
+            if (!chunk.error.empty()) {
+                error = chunk.error;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // negative indices become absolute once the attributes before every chunk are counted. positionCnt and
+    // texcoordCnt are the ones before the first chunk
+    void resolveFixups(std::vector<Chunk>& chunks, size_t positionCnt, size_t texcoordCnt, ThreadPool& threadPool) {
+        std::vector<size_t> positionBase(chunks.size()), texcoordBase(chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            positionBase[i] = positionCnt;
+            texcoordBase[i] = texcoordCnt;
+            positionCnt += chunks[i].positions.size() / 3;
+            texcoordCnt += chunks[i].texcoords.size() / 2;
+        }
+        threadPool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                for (const auto& fixup : chunks[i].positionFixups)
+                    chunks[i].corners[fixup.first].position = int32_t(positionBase[i]) + fixup.second;
+                for (const auto& fixup : chunks[i].texcoordFixups)
+                    chunks[i].corners[fixup.first].texcoord = int32_t(texcoordBase[i]) + fixup.second;
+                chunks[i].positionFixups.clear();
+                chunks[i].texcoordFixups.clear();
+            }
+        });
+    }
+
+    bool seekFile(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+        return _fseeki64(file, int64_t(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    bool appendSpill(FILE* spill, const std::vector<float>& values) {
+        return fseek(spill, 0, SEEK_END) == 0 && fwrite(values.data(), sizeof(float), values.size(), spill) == values.size();
+    }
+
+    // reads the attributes of the sorted ids back, ids close to each other in one read of the span between them
+    bool readSpill(FILE* spill, size_t components, const std::vector<uint32_t>& ids, std::vector<float>& values) {
+        constexpr uint32_t MAX_GAP = 256, MAX_SPAN = 16384;
+        values.resize(ids.size() * components);
+        std::vector<float> span;
+        for (size_t first = 0; first < ids.size();) {
+            size_t last = first + 1;
+            while (last < ids.size() && ids[last] - ids[last - 1] <= MAX_GAP && ids[last] - ids[first] < MAX_SPAN)
+                ++last;
+            size_t spanCnt = ids[last - 1] - ids[first] + 1;
+            span.resize(spanCnt * components);
+            if (!seekFile(spill, uint64_t(ids[first]) * components * sizeof(float)) ||
+                fread(span.data(), components * sizeof(float), spanCnt, spill) != spanCnt)
+                return false;
+            for (size_t i = first; i < last; ++i)
+                memcpy(&values[i * components], &span[(ids[i] - ids[first]) * components], components * sizeof(float));
+            first = last;
+        }
+        return true;
+    }
+
+    void sortUnique(std::vector<uint32_t>& ids) {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    // reads the attributes the corners of the chunks reference back from the spill files and renumbers the corners to
+    // index them, a block needs no more attribute memory than it has corners. positionCnt and texcoordCnt are the
+    // attributes written so far, a corner past them is out of range
+    bool gatherAttributes(std::vector<Chunk>& chunks, FILE* positionSpill, size_t positionCnt, FILE* texcoordSpill, size_t texcoordCnt,
+        ObjMesh& mesh, ThreadPool& threadPool, std::string& error) {
+        std::vector<uint32_t> positionIds, texcoordIds;
+        for (const auto& chunk : chunks) {
+            for (const auto& corner : chunk.corners) {
+                if (!inRange(corner.position, positionCnt) || (corner.texcoord != -1 && !inRange(corner.texcoord, texcoordCnt))) {
+                    error = "face index out of range";
+                    return false;
+                }
+                positionIds.push_back(uint32_t(corner.position));
+                if (corner.texcoord != -1)
+                    texcoordIds.push_back(uint32_t(corner.texcoord));
+            }
+        }
+        sortUnique(positionIds);
+        sortUnique(texcoordIds);
+        if (!readSpill(positionSpill, 3, positionIds, mesh.positions) || !readSpill(texcoordSpill, 2, texcoordIds, mesh.texcoords)) {
+            error = "cannot read the attribute spill file";
+            return false;
+        }
+
+        threadPool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                for (auto& corner : chunks[i].corners) {
+                    corner.position = int32_t(std::lower_bound(positionIds.begin(), positionIds.end(), uint32_t(corner.position)) - positionIds.begin());
+                    if (corner.texcoord != -1)
+                        corner.texcoord = int32_t(std::lower_bound(texcoordIds.begin(), texcoordIds.end(), uint32_t(corner.texcoord)) - texcoordIds.begin());
+                }
+            }
+        });
+        return true;
+    }
+
+    // appends the triangles of the chunks to mesh.indices. positionCnt and texcoordCnt are the attributes that come
+    // before the first chunk, the chunks' own attributes are appended as well unless the mesh already holds them
+    bool mergeChunks(std::vector<Chunk>& chunks, size_t positionCnt, size_t texcoordCnt, bool appendAttributes, ObjMesh& mesh,
+        ThreadPool& threadPool, std::string& error) {
+        // where every chunk's attributes and triangles start in the merged arrays
+        std::vector<size_t> positionBase(chunks.size() + 1, positionCnt * 3), texcoordBase(chunks.size() + 1, texcoordCnt * 2);
+        std::vector<size_t> cornerBase(chunks.size() + 1, mesh.indices.size());
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            positionBase[i + 1] = positionBase[i] + chunks[i].positions.size();
+            texcoordBase[i + 1] = texcoordBase[i] + chunks[i].texcoords.size();
+            cornerBase[i + 1] = cornerBase[i] + chunks[i].triangleCornerCnt;
+        }
+        if (appendAttributes) {
+            mesh.positions.resize(positionBase.back());
+            mesh.texcoords.resize(texcoordBase.back());
+        }
+        mesh.indices.resize(cornerBase.back());
+        size_t meshPositionCnt = mesh.positions.size() / 3, meshTexcoordCnt = mesh.texcoords.size() / 2;
+        resolveFixups(chunks, positionCnt, texcoordCnt, threadPool);
+
+        // positions first, quads need them all to pick their diagonal
+        if (appendAttributes) {
+            threadPool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i) {
+                    std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), mesh.positions.begin() + positionBase[i]);
+                    std::copy(chunks[i].texcoords.begin(), chunks[i].texcoords.end(), mesh.texcoords.begin() + texcoordBase[i]);
+                }
+            });
+        }
+
+        std::vector<uint8_t> chunkValid(chunks.size(), 1); // written from several workers, so not vector<bool>
+        threadPool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                const Chunk& chunk = chunks[i];
+                ObjIndex* out = mesh.indices.data() + cornerBase[i];
+                const ObjIndex* corner = chunk.corners.data();
+                for (uint8_t faceSize : chunk.faceSizes) {
+                    for (uint8_t k = 0; k < faceSize; ++k) {
+                        if (!inRange(corner[k].position, meshPositionCnt) || (corner[k].texcoord != -1 && !inRange(corner[k].texcoord, meshTexcoordCnt))) {
+                            chunkValid[i] = 0;
+                            break;
+                        }
+                    }
+                    if (!chunkValid[i])
+                        break;
+
+                    if (faceSize == 3) {
+                        out[0] = corner[0], out[1] = corner[1], out[2] = corner[2];
+                        out += 3;
+                    }
+                    else {
+                        // the shorter diagonal, same float math as tinyobj
+                        const float* v0 = &mesh.positions[size_t(corner[0].position) * 3];
+                        const float* v1 = &mesh.positions[size_t(corner[1].position) * 3];
+                        const float* v2 = &mesh.positions[size_t(corner[2].position) * 3];
+                        const float* v3 = &mesh.positions[size_t(corner[3].position) * 3];
+                        float e02x = v2[0] - v0[0], e02y = v2[1] - v0[1], e02z = v2[2] - v0[2];
+                        float e13x = v3[0] - v1[0], e13y = v3[1] - v1[1], e13z = v3[2] - v1[2];
+                        float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+                        float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+                        if (sqr02 < sqr13) {
+                            out[0] = corner[0], out[1] = corner[1], out[2] = corner[2];
+                            out[3] = corner[0], out[4] = corner[2], out[5] = corner[3];
+                        }
+                        else {
+                            out[0] = corner[0], out[1] = corner[1], out[2] = corner[3];
+                            out[3] = corner[1], out[4] = corner[2], out[5] = corner[3];
+                        }
+                        out += 6;
+                    }
+                    corner += faceSize;
+                }
+            }
+        });
+        if (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end()) {
+            error = "face index out of range";
+            return false;
+        }
+
+        // names are numbered in first use order, a usemtl with no triangles before the next one is dropped
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            for (const auto& library : chunks[i].libraries) {
+                if (std::find(mesh.materialLibraries.begin(), mesh.materialLibraries.end(), library) == mesh.materialLibraries.end())
+                    mesh.materialLibraries.push_back(library);
+            }
+            for (const auto& use : chunks[i].materialUses) {
+                auto name = std::find(mesh.materialNames.begin(), mesh.materialNames.end(), use.second);
+                int32_t material = int32_t(name - mesh.materialNames.begin());
+                if (name == mesh.materialNames.end())
+                    mesh.materialNames.push_back(use.second);
+                size_t firstCorner = cornerBase[i] + use.first;
+                if (!mesh.materialRanges.empty() && mesh.materialRanges.back().firstCorner == firstCorner)
+                    mesh.materialRanges.pop_back();
+                if (mesh.materialRanges.empty() || mesh.materialRanges.back().material != material)
+                    mesh.materialRanges.push_back({firstCorner, material});
+            }
+        }
+        return true;
+    }
+}
+
+bool loadObj(const char* path, ObjMesh& mesh, ThreadPool& threadPool, std::string& error) {
+    MappedFile file;
+    if (!file.open(path)) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+
+    std::vector<Chunk> chunks;
+    if (!parseText(reinterpret_cast<const char*>(file.data()), file.size(), threadPool, chunks, error))
+        return false;
+    mesh = ObjMesh();
+    return mergeChunks(chunks, 0, 0, true, mesh, threadPool, error);
+}
+
+ObjStream::ObjStream(ThreadPool& threadPool, size_t blockSize) : threadPool(threadPool), blockSize(blockSize) {
+}
+
+ObjStream::~ObjStream() {
+    close();
+}
+
+bool ObjStream::open(const char* path, std::string& error) {
+    close();
+    file = fopen(path, "rb");
+    if (file == nullptr) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    positionSpill = tmpfile();
+    texcoordSpill = tmpfile();
+    if (positionSpill == nullptr || texcoordSpill == nullptr) {
+        close();
+        error = "cannot create the attribute spill files";
+        return false;
+    }
+    streamMesh = ObjMesh();
+    bufferUsed = 0;
+    endOfFile = false;
+    positionCnt = 0;
+    texcoordCnt = 0;
+    cornerCnt = 0;
+    return true;
+}
+
+void ObjStream::close() {
+    for (FILE** handle : {&file, &positionSpill, &texcoordSpill}) {
+        if (*handle != nullptr)
+            fclose(*handle);
+        *handle = nullptr;
+    }
+    endOfFile = true;
+    bufferUsed = 0;
+    buffer.clear();
+    buffer.shrink_to_fit();
+}
+
+bool ObjStream::read(std::string& error) {
+    // the material in effect at the end of the last block carries over to the start of this one
+    int32_t material = streamMesh.materialRanges.empty() ? -1 : streamMesh.materialRanges.back().material;
+    streamMesh.positions.clear();
+    streamMesh.texcoords.clear();
+    streamMesh.indices.clear();
+    streamMesh.materialRanges.clear();
+    if (material != -1)
+        streamMesh.materialRanges.push_back({0, material});
+    if (endOfFile)
+        return true;
+
+    // top the block up behind the partial line left over from the last read
+    if (buffer.size() < blockSize)
+        buffer.resize(blockSize);
+    size_t readSize = fread(buffer.data() + bufferUsed, 1, buffer.size() - bufferUsed, file);
+    bufferUsed += readSize;
+    endOfFile = bufferUsed < buffer.size();
+
+    size_t parseSize = bufferUsed;
+    if (!endOfFile) {
+        const char* text = buffer.data();
+        const char* lastNewline = nullptr;
+        for (const char* cursor = text + bufferUsed; cursor > text; --cursor) {
+            if (cursor[-1] == '\n') {
+                lastNewline = cursor - 1;
+                break;
+            }
+        }
+        // a line longer than the block, grow until it fits
+        if (lastNewline == nullptr) {
+            buffer.resize(buffer.size() * 2);
+            return read(error);
+        }
+        parseSize = lastNewline + 1 - text;
+    }
+
+    std::vector<Chunk> chunks;
+    if (!parseText(buffer.data(), parseSize, threadPool, chunks, error))
+        return false;
+    resolveFixups(chunks, positionCnt, texcoordCnt, threadPool);
+
+    // faces of any later block may still reference this block's attributes, they wait in the spill files
+    for (const auto& chunk : chunks) {
+        if (!appendSpill(positionSpill, chunk.positions) || !appendSpill(texcoordSpill, chunk.texcoords)) {
+            error = "cannot write the attribute spill files";
+            return false;
+        }
+        positionCnt += chunk.positions.size() / 3;
+        texcoordCnt += chunk.texcoords.size() / 2;
+    }
+    if (!gatherAttributes(chunks, positionSpill, positionCnt, texcoordSpill, texcoordCnt, streamMesh, threadPool, error) ||
+        !mergeChunks(chunks, 0, 0, false, streamMesh, threadPool, error))
+        return false;
+    cornerCnt += streamMesh.indices.size();
+
+    memmove(buffer.data(), buffer.data() + parseSize, bufferUsed - parseSize);
+    bufferUsed -= parseSize;
+    return true;
+}
@@ -0,0 +1,88 @@
+//objParser.h
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// one triangle corner, zero based, texcoord is -1 when the face has none
+struct ObjIndex {
+	int32_t position;
+	int32_t texcoord;
+};
+
+// the corners from firstCorner up to the next range's are drawn with material, an index into ObjMesh::materialNames,
+// or -1 for none
+struct ObjMaterialRange {
+	size_t firstCorner;
+	int32_t material;
+};
+
+struct ObjMesh {
+	std::vector<float> positions; // xyz per v line
+	std::vector<float> texcoords; // uv per vt line
+	std::vector<ObjIndex> indices; // triangulated faces in file order
+	std::vector<std::string> materialLibraries; // file names of the mtllib lines, relative to the OBJ
+	std::vector<std::string> materialNames; // of the usemtl lines, in first use order
+	std::vector<ObjMaterialRange> materialRanges; // ascending, corners before the first range have no material
+};
+
+// parse an OBJ through a memory mapping, line aligned chunks are parsed on the pool with std::from_chars and
+// merged with prefix sums. Triangles and quads come out exactly as tinyobj::LoadObj triangulates them, files it
+// would treat differently (polygons with more than four corners, out of range indices) fail with error set,
+// so the caller can fall back to tinyobj. Materials are only named, reading the libraries is up to the caller.
+// Normals and groups are skipped
+bool loadObj(const char* path, ObjMesh& mesh, ThreadPool& threadPool, std::string& error);
+
+// reads an OBJ once, a block at a time, so memory is bounded by the block size however large the file is. Attributes
+// go to temporary spill files as they are parsed, since any later face may reference them, and every block reads back
+// only the ones its triangles use
+class ObjStream {
+private:
+	ThreadPool& threadPool;
+	size_t blockSize;
+	FILE* file = nullptr;
+	FILE* positionSpill = nullptr;
+	FILE* texcoordSpill = nullptr;
+	std::vector<char> buffer;
+	size_t bufferUsed = 0; // bytes in buffer, the partial last line of the previous block
+	bool endOfFile = true;
+	size_t positionCnt = 0, texcoordCnt = 0; // spilled so far
+	size_t cornerCnt = 0; // handed out so far
+	ObjMesh streamMesh;
+
+public:
+	ObjStream(ThreadPool& threadPool, size_t blockSize = 4 << 20);
+
+	~ObjStream();
+
+	ObjStream(const ObjStream&) = delete;
+	ObjStream& operator=(const ObjStream&) = delete;
+
+	bool open(const char* path, std::string& error);
+
+	void close();
+
+	// parse the next block, its triangles replace mesh().indices, the attributes they use mesh().positions and
+	// mesh().texcoords, and their materials mesh().materialRanges. Same errors as loadObj, forward references to
+	// attributes defined in a later block are out of range here
+	bool read(std::string& error);
+
+	bool done() const {
+		return endOfFile && bufferUsed == 0;
+	}
+
+	// the last block, its indices index its own attributes. Libraries and material names are all the ones seen so far
+	const ObjMesh& mesh() const {
+		return streamMesh;
+	}
+
+	// triangle corners handed out so far
+	size_t cornerCount() const {
+		return cornerCnt;
+	}
+};
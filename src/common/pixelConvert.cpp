@@ -0,0 +1,360 @@
+#include "pixelConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define PIXEL_AVX2
+#endif
+#if defined(__F16C__)
+    #include <immintrin.h>
+    #define PIXEL_F16C
+#endif
+#if defined(__SSSE3__)
+    #include <tmmintrin.h>
+    #define PIXEL_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PIXEL_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define PIXEL_NEON
+#endif
+
+namespace {
+    uint16_t floatToHalf(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = bits & 0x7FFFFF;
+        if (exponent <= 0)
+            return static_cast<uint16_t>(sign); // unorm8 never reaches the subnormal range
+        // round to nearest even, a carry out of the mantissa bumps the exponent as it should
+        uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+        uint32_t remainder = mantissa & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+            ++half;
+        return static_cast<uint16_t>(half);
+    }
+
+    struct ConversionTables {
+        float srgbToLinear[256];
+        float unormToFloat[256];
+        uint16_t unormToHalf[256];
+        uint16_t srgbToLinearFixed[256];
+        uint16_t unormToLinearFixed[256];
+        uint8_t linearToSrgb[LINEAR_FIXED_MAX + 1]; // float values are quantized to fixed point first
+        uint8_t linearToUnorm[LINEAR_FIXED_MAX + 1];
+
+        ConversionTables() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                float c = i / 255.0f;
+                srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                unormToFloat[i] = c;
+                unormToHalf[i] = floatToHalf(c);
+                srgbToLinearFixed[i] = static_cast<uint16_t>(std::lround(srgbToLinear[i] * LINEAR_FIXED_MAX));
+                unormToLinearFixed[i] = static_cast<uint16_t>(std::lround(c * LINEAR_FIXED_MAX));
+            }
+            for (uint32_t i = 0; i <= LINEAR_FIXED_MAX; ++i) {
+                float linear = i / float(LINEAR_FIXED_MAX);
+                float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+                linearToSrgb[i] = static_cast<uint8_t>(std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f));
+                linearToUnorm[i] = static_cast<uint8_t>(std::lround(linear * 255.0f));
+            }
+        }
+    };
+
+    const ConversionTables& tables() {
+        static const ConversionTables conversionTables;
+        return conversionTables;
+    }
+
+    // clamp and scale to a table index, NaN maps to 0 like the vector min and max do
+    uint32_t quantize(float value, float scale) {
+        value = value > 0.0f ? value : 0.0f;
+        value = value < 1.0f ? value : 1.0f;
+        return static_cast<uint32_t>(value * scale + 0.5f);
+    }
+}
+
+const char* pixelConvertIsa() {
+#if defined(PIXEL_AVX2)
+    return "avx2";
+#elif defined(PIXEL_SSSE3)
+    return "ssse3";
+#elif defined(PIXEL_SSE2)
+    return "sse2";
+#elif defined(PIXEL_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void expandRgbToRgbaScalar(const uint8_t* rgb, uint8_t* rgba, size_t pixelCnt, uint8_t alpha) {
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        // read the whole pixel first, the last ones overlap their output when expanding in place
+        uint8_t r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+        rgba[i * 4] = r;
+        rgba[i * 4 + 1] = g;
+        rgba[i * 4 + 2] = b;
+        rgba[i * 4 + 3] = alpha;
+    }
+}
+
+void expandRgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixelCnt, uint8_t alpha) {
+    // every block is loaded before it is stored and writes never pass the next unread input,
+    // which keeps the in place layout (rgb at rgba + pixelCnt) valid
+    size_t i = 0;
+#if defined(PIXEL_AVX2)
+    const __m256i shuffle256 = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha256 = _mm256_set1_epi32(int(uint32_t(alpha) << 24));
+    for (; i + 10 <= pixelCnt; i += 8) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3 + 12));
+        __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        px = _mm256_or_si256(_mm256_shuffle_epi8(px, shuffle256), alpha256);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), px);
+    }
+#endif
+#if defined(PIXEL_SSSE3)
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha128 = _mm_set1_epi32(int(uint32_t(alpha) << 24));
+    for (; i + 6 <= pixelCnt; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+        px = _mm_or_si128(_mm_shuffle_epi8(px, shuffle), alpha128);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), px);
+    }
+#elif defined(PIXEL_NEON)
+    for (; i + 16 <= pixelCnt; i += 16) {
+        uint8x16x3_t px = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t out = {{px.val[0], px.val[1], px.val[2], vdupq_n_u8(alpha)}};
+        vst4q_u8(rgba + i * 4, out);
+    }
+#endif
+    expandRgbToRgbaScalar(rgb + i * 3, rgba + i * 4, pixelCnt - i, alpha);
+}
+
+void swizzleRgbaScalar(const uint8_t* src, uint8_t* dst, size_t pixelCnt, const uint8_t order[4]) {
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        uint8_t px[4] = {src[i * 4], src[i * 4 + 1], src[i * 4 + 2], src[i * 4 + 3]};
+        for (int c = 0; c < 4; ++c)
+            dst[i * 4 + c] = px[order[c]];
+    }
+}
+
+void swizzleRgba(const uint8_t* src, uint8_t* dst, size_t pixelCnt, const uint8_t order[4]) {
+    size_t i = 0;
+#if defined(PIXEL_SSSE3)
+    alignas(16) int8_t indices[16];
+    for (int p = 0; p < 4; ++p)
+        for (int c = 0; c < 4; ++c)
+            indices[p * 4 + c] = static_cast<int8_t>(p * 4 + order[c]);
+    const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(indices));
+#if defined(PIXEL_AVX2)
+    const __m256i shuffle256 = _mm256_broadcastsi128_si256(shuffle);
+    for (; i + 8 <= pixelCnt; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_shuffle_epi8(px, shuffle256));
+    }
+#endif
+    for (; i + 4 <= pixelCnt; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_shuffle_epi8(px, shuffle));
+    }
+#elif defined(PIXEL_NEON)
+    for (; i + 16 <= pixelCnt; i += 16) {
+        uint8x16x4_t px = vld4q_u8(src + i * 4);
+        uint8x16x4_t out = {{px.val[order[0]], px.val[order[1]], px.val[order[2]], px.val[order[3]]}};
+        vst4q_u8(dst + i * 4, out);
+    }
+#endif
+    swizzleRgbaScalar(src + i * 4, dst + i * 4, pixelCnt - i, order);
+}
+
+void premultiplyAlphaScalar(const uint8_t* src, uint8_t* dst, size_t pixelCnt) {
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        uint32_t alpha = src[i * 4 + 3];
+        for (int c = 0; c < 3; ++c) {
+            // exact round(c * a / 255) without a division
+            uint32_t t = src[i * 4 + c] * alpha + 128;
+            dst[i * 4 + c] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+        }
+        dst[i * 4 + 3] = static_cast<uint8_t>(alpha);
+    }
+}
+
+void premultiplyAlpha(const uint8_t* src, uint8_t* dst, size_t pixelCnt) {
+    size_t i = 0;
+#if defined(PIXEL_AVX2)
+    const __m256i zero256 = _mm256_setzero_si256();
+    const __m256i rounding256 = _mm256_set1_epi16(128);
+    const __m256i alphaMask256 = _mm256_set1_epi32(int(0xFF000000));
+    for (; i + 8 <= pixelCnt; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        __m256i lo = _mm256_unpacklo_epi8(px, zero256);
+        __m256i hi = _mm256_unpackhi_epi8(px, zero256);
+        __m256i alphaLo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m256i alphaHi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF);
+        lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alphaLo), rounding256);
+        hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, alphaHi), rounding256);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+        __m256i color = _mm256_packus_epi16(lo, hi);
+        px = _mm256_or_si256(_mm256_andnot_si256(alphaMask256, color), _mm256_and_si256(alphaMask256, px));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), px);
+    }
+#endif
+#if defined(PIXEL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(128);
+    const __m128i alphaMask = _mm_set1_epi32(int(0xFF000000));
+    for (; i + 4 <= pixelCnt; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+        // broadcast each pixel's alpha over its four 16 bit lanes
+        __m128i alphaLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i alphaHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, alphaLo), rounding);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, alphaHi), rounding);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        __m128i color = _mm_packus_epi16(lo, hi);
+        px = _mm_or_si128(_mm_andnot_si128(alphaMask, color), _mm_and_si128(alphaMask, px));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), px);
+    }
+#elif defined(PIXEL_NEON)
+    const uint16x8_t rounding = vdupq_n_u16(128);
+    for (; i + 8 <= pixelCnt; i += 8) {
+        uint8x8x4_t px = vld4_u8(src + i * 4);
+        for (int c = 0; c < 3; ++c) {
+            uint16x8_t t = vaddq_u16(vmull_u8(px.val[c], px.val[3]), rounding);
+            px.val[c] = vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+        }
+        vst4_u8(dst + i * 4, px);
+    }
+#endif
+    premultiplyAlphaScalar(src + i * 4, dst + i * 4, pixelCnt - i);
+}
+
+void srgbToLinearScalar(const uint8_t* src, float* dst, size_t pixelCnt) {
+    const ConversionTables& table = tables();
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        dst[i * 4] = table.srgbToLinear[src[i * 4]];
+        dst[i * 4 + 1] = table.srgbToLinear[src[i * 4 + 1]];
+        dst[i * 4 + 2] = table.srgbToLinear[src[i * 4 + 2]];
+        dst[i * 4 + 3] = table.unormToFloat[src[i * 4 + 3]];
+    }
+}
+
+void srgbToLinear(const uint8_t* src, float* dst, size_t pixelCnt) {
+    // 256 entry tables beat any vector evaluation of the transfer curve, so every instruction set shares them
+    srgbToLinearScalar(src, dst, pixelCnt);
+}
+
+void linearToSrgbScalar(const float* src, uint8_t* dst, size_t pixelCnt) {
+    const ConversionTables& table = tables();
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        for (int c = 0; c < 3; ++c)
+            dst[i * 4 + c] = table.linearToSrgb[quantize(src[i * 4 + c], float(LINEAR_FIXED_MAX))];
+        dst[i * 4 + 3] = static_cast<uint8_t>(quantize(src[i * 4 + 3], 255.0f));
+    }
+}
+
+void linearToSrgb(const float* src, uint8_t* dst, size_t pixelCnt) {
+    const ConversionTables& table = tables();
+    size_t i = 0;
+#if defined(PIXEL_SSE2) || defined(PIXEL_NEON)
+    // clamp, scale and round in vector registers, only the table lookups stay scalar
+    alignas(16) uint32_t indices[16];
+#if defined(PIXEL_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 scale = _mm_setr_ps(float(LINEAR_FIXED_MAX), float(LINEAR_FIXED_MAX), float(LINEAR_FIXED_MAX), 255.0f);
+#else
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t scale = {float(LINEAR_FIXED_MAX), float(LINEAR_FIXED_MAX), float(LINEAR_FIXED_MAX), 255.0f};
+#endif
+    for (; i + 4 <= pixelCnt; i += 4) {
+        for (int p = 0; p < 4; ++p) {
+#if defined(PIXEL_SSE2)
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + (i + p) * 4), zero), one);
+            _mm_store_si128(reinterpret_cast<__m128i*>(indices + p * 4), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+#else
+            float32x4_t v = vld1q_f32(src + (i + p) * 4);
+            v = vminq_f32(vmaxq_f32(v, zero), one);
+            // vmaxq keeps NaN, the equality mask zeroes those lanes like the scalar path
+            v = vbslq_f32(vceqq_f32(v, v), v, zero);
+            vst1q_u32(indices + p * 4, vcvtq_u32_f32(vaddq_f32(vmulq_f32(v, scale), half)));
+#endif
+        }
+        for (int p = 0; p < 4; ++p) {
+            dst[(i + p) * 4] = table.linearToSrgb[indices[p * 4]];
+            dst[(i + p) * 4 + 1] = table.linearToSrgb[indices[p * 4 + 1]];
+            dst[(i + p) * 4 + 2] = table.linearToSrgb[indices[p * 4 + 2]];
+            dst[(i + p) * 4 + 3] = static_cast<uint8_t>(indices[p * 4 + 3]);
+        }
+    }
+#endif
+    linearToSrgbScalar(src + i * 4, dst + i * 4, pixelCnt - i);
+}
+
+void unormToHalfScalar(const uint8_t* src, uint16_t* dst, size_t valueCnt) {
+    const ConversionTables& table = tables();
+    for (size_t i = 0; i < valueCnt; ++i)
+        dst[i] = table.unormToHalf[src[i]];
+}
+
+void unormToHalf(const uint8_t* src, uint16_t* dst, size_t valueCnt) {
+    size_t i = 0;
+#if defined(PIXEL_F16C)
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; i + 4 <= valueCnt; i += 4) {
+        int32_t packed;
+        memcpy(&packed, src + i, sizeof(packed));
+        __m128 v = _mm_div_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed))), scale);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+#elif defined(PIXEL_NEON) && defined(__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(255.0f);
+    for (; i + 8 <= valueCnt; i += 8) {
+        uint16x8_t v = vmovl_u8(vld1_u8(src + i));
+        float32x4_t lo = vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), scale);
+        float32x4_t hi = vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), scale);
+        vst1q_u16(dst + i, vreinterpretq_u16_f16(vcombine_f16(vcvt_f16_f32(lo), vcvt_f16_f32(hi))));
+    }
+#endif
+    unormToHalfScalar(src + i, dst + i, valueCnt - i);
+}
+
+void rgbaToLinearFixed(const uint8_t* src, uint16_t* dst, size_t pixelCnt, bool srgb) {
+    // table lookups on every instruction set, like srgbToLinear
+    const ConversionTables& table = tables();
+    const uint16_t* colorToLinear = srgb ? table.srgbToLinearFixed : table.unormToLinearFixed;
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        dst[i * 4] = colorToLinear[src[i * 4]];
+        dst[i * 4 + 1] = colorToLinear[src[i * 4 + 1]];
+        dst[i * 4 + 2] = colorToLinear[src[i * 4 + 2]];
+        dst[i * 4 + 3] = table.unormToLinearFixed[src[i * 4 + 3]];
+    }
+}
+
+void linearFixedToRgba(const uint16_t* src, uint8_t* dst, size_t pixelCnt, bool srgb) {
+    // values are already in range, only the encode table is left
+    const ConversionTables& table = tables();
+    const uint8_t* linearToColor = srgb ? table.linearToSrgb : table.linearToUnorm;
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        dst[i * 4] = linearToColor[src[i * 4]];
+        dst[i * 4 + 1] = linearToColor[src[i * 4 + 1]];
+        dst[i * 4 + 2] = linearToColor[src[i * 4 + 2]];
+        dst[i * 4 + 3] = table.linearToUnorm[src[i * 4 + 3]];
+    }
+}
@@ -0,0 +1,46 @@
+//pixelConvert.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// instruction set the kernels were compiled for
+const char* pixelConvertIsa();
+
+// RGB8 to RGBA8 with a constant alpha. rgb may also sit at rgba + pixelCnt inside the same
+// allocation, so a decoder can write RGB into the tail of the final buffer and expand in place
+void expandRgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixelCnt, uint8_t alpha = 255);
+
+// output channel c takes input channel order[c], {2, 1, 0, 3} swaps red and blue, src may equal dst
+void swizzleRgba(const uint8_t* src, uint8_t* dst, size_t pixelCnt, const uint8_t order[4]);
+
+// color channels times alpha, rounded, src may equal dst
+void premultiplyAlpha(const uint8_t* src, uint8_t* dst, size_t pixelCnt);
+
+// sRGB encoded RGBA8 to linear float, alpha is linear in both
+void srgbToLinear(const uint8_t* src, float* dst, size_t pixelCnt);
+
+// linear float RGBA to sRGB encoded RGBA8, values are clamped to [0, 1]
+void linearToSrgb(const float* src, uint8_t* dst, size_t pixelCnt);
+
+// unorm8 values to IEEE half floats
+void unormToHalf(const uint8_t* src, uint16_t* dst, size_t valueCnt);
+
+// linear values in 14 bit fixed point, close to one step of 8 bit sRGB near black, and four of them
+// still add up within an unsigned 16 bit lane
+constexpr uint32_t LINEAR_FIXED_MAX = 16383;
+
+// RGBA8 to fixed point linear, the color channels are sRGB decoded when srgb is set, alpha never is
+void rgbaToLinearFixed(const uint8_t* src, uint16_t* dst, size_t pixelCnt, bool srgb);
+
+// fixed point linear RGBA back to RGBA8, sRGB encoding the color channels when srgb is set
+void linearFixedToRgba(const uint16_t* src, uint8_t* dst, size_t pixelCnt, bool srgb);
+
+// plain C++ versions, the vector kernels use them for their tails and must match them bit for bit
+void expandRgbToRgbaScalar(const uint8_t* rgb, uint8_t* rgba, size_t pixelCnt, uint8_t alpha = 255);
+void swizzleRgbaScalar(const uint8_t* src, uint8_t* dst, size_t pixelCnt, const uint8_t order[4]);
+void premultiplyAlphaScalar(const uint8_t* src, uint8_t* dst, size_t pixelCnt);
+void srgbToLinearScalar(const uint8_t* src, float* dst, size_t pixelCnt);
+void linearToSrgbScalar(const float* src, uint8_t* dst, size_t pixelCnt);
+void unormToHalfScalar(const uint8_t* src, uint16_t* dst, size_t valueCnt);
@@ -0,0 +1,91 @@
+// single stb_image implementation shared by the loaders
+#include "stbImage.h"
+#include "pixelConvert.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    // caller memory that the next allocation the size of the output image is served from
+    struct DecodeTarget {
+        unsigned char* memory = nullptr;
+        size_t size = 0; // RGBA8 pixel bytes
+        bool claimed = false;
+    };
+    thread_local DecodeTarget decodeTarget;
+
+    void* decodeMalloc(size_t size) {
+        if (decodeTarget.memory != nullptr && !decodeTarget.claimed &&
+            (size == decodeTarget.size || size == decodeTarget.size + 1)) {
+            decodeTarget.claimed = true;
+            return decodeTarget.memory;
+        }
+        return malloc(size);
+    }
+
+    void* decodeRealloc(void* p, size_t size) {
+        // the target cannot grow, move to the heap and release it
+        if (p != nullptr && p == decodeTarget.memory) {
+            void* moved = malloc(size);
+            if (moved != nullptr)
+                memcpy(moved, p, std::min(size, decodeTarget.size));
+            decodeTarget.claimed = false;
+            return moved;
+        }
+        return realloc(p, size);
+    }
+
+    bool isPng(const char* path) {
+        static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+        unsigned char header[8] = {};
+        FILE* file = fopen(path, "rb");
+        if (file == nullptr)
+            return false;
+        bool result = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, signature, sizeof(header)) == 0;
+        fclose(file);
+        return result;
+    }
+
+    void decodeFree(void* p) {
+        if (p != nullptr && p == decodeTarget.memory) {
+            decodeTarget.claimed = false;
+            return;
+        }
+        free(p);
+    }
+}
+
+#define STBI_MALLOC(size) decodeMalloc(size)
+#define STBI_REALLOC(p, size) decodeRealloc(p, size)
+#define STBI_FREE(p) decodeFree(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+bool stbiLoadInto(const char* path, unsigned char* dst, size_t dstSize, int* width, int* height) {
+    int channel;
+    if (!stbi_info(path, width, height, &channel) || stbiLoadIntoSize(*width, *height) > dstSize)
+        return false;
+
+    // RGB pngs decode to three channels in the tail of dst, the vector kernel then widens them in place
+    size_t pixelCnt = size_t(*width) * *height;
+    bool expandRgb = channel == 3 && isPng(path);
+    int components = expandRgb ? STBI_rgb : STBI_rgb_alpha;
+    size_t size = pixelCnt * components;
+    unsigned char* target = dst + pixelCnt * 4 - size;
+    decodeTarget = {target, size, false};
+    unsigned char* pixels = stbi_load(path, width, height, &channel, components);
+    bool inPlace = pixels == target;
+    decodeTarget = {};
+
+    if (pixels == nullptr)
+        return false;
+    if (!inPlace) {
+        // an intermediate buffer took the target, it is dead by now so the result can be copied over it
+        memcpy(target, pixels, size);
+        stbi_image_free(pixels);
+    }
+    if (expandRgb)
+        expandRgbToRgba(target, dst, pixelCnt);
+    return true;
+}
@@ -0,0 +1,15 @@
+//stbImage.h
+
+#pragma once
+
+#include <cstddef>
+
+// bytes stbiLoadInto needs for an image, the jpeg decoder allocates one byte past the RGBA8 pixels
+inline size_t stbiLoadIntoSize(int width, int height) {
+	return size_t(width) * height * 4 + 1;
+}
+
+// decode to RGBA8 straight into dst, which must hold stbiLoadIntoSize bytes. the allocation hooks hand
+// dst to stb_image as its output buffer, so most images skip the heap copy, otherwise the result is
+// copied into dst. returns false when decoding fails or the image does not fit dst
+bool stbiLoadInto(const char* path, unsigned char* dst, size_t dstSize, int* width, int* height);
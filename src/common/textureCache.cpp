@@ -0,0 +1,124 @@
+#include "textureCache.h"
+#include <algorithm>
+
+TextureCache::TextureCache(const Callbacks& callbacks, VkDeviceSize budget)
+    : callbacks(callbacks), budget(budget) {
+}
+
+TextureCache::~TextureCache() {
+    clear();
+}
+
+const Texture* TextureCache::acquire(const TextureKey& key) {
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        ++cacheStats.hits;
+    }
+    else {
+        ++cacheStats.misses;
+        Entry entry;
+        entry.texture = callbacks.create(key);
+        cacheStats.residentBytes += entry.texture.size;
+        cacheStats.peakBytes = std::max(cacheStats.peakBytes, cacheStats.residentBytes);
+        it = entries.emplace(key, entry).first;
+    }
+
+    TextureResidency& residency = it->second.residency;
+    ++residency.refCount;
+    ++residency.acquireCount;
+    residency.lastUsedFrame = frame;
+
+    enforceBudget();
+    return &it->second.texture;
+}
+
+void TextureCache::release(const TextureKey& key) {
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.residency.refCount > 0)
+        --it->second.residency.refCount;
+}
+
+const Texture* TextureCache::find(const TextureKey& key) const {
+    auto it = entries.find(key);
+    return it != entries.end() ? &it->second.texture : nullptr;
+}
+
+void TextureCache::replace(const TextureKey& key, const Texture& texture) {
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return;
+    cacheStats.residentBytes = cacheStats.residentBytes - it->second.texture.size + texture.size;
+    cacheStats.peakBytes = std::max(cacheStats.peakBytes, cacheStats.residentBytes);
+    it->second.texture = texture;
+    enforceBudget();
+}
+
+void TextureCache::touch(const TextureKey& key) {
+    auto it = entries.find(key);
+    if (it != entries.end())
+        it->second.residency.lastUsedFrame = frame;
+}
+
+void TextureCache::setBudget(VkDeviceSize bytes) {
+    budget = bytes;
+    enforceBudget();
+}
+
+const TextureResidency* TextureCache::residency(const TextureKey& key) const {
+    auto it = entries.find(key);
+    return it != entries.end() ? &it->second.residency : nullptr;
+}
+
+void TextureCache::enforceBudget() {
+    while (cacheStats.residentBytes > budget) {
+        // least recently used texture nobody references
+        auto victim = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->second.residency.refCount == 0 &&
+                (victim == entries.end() || it->second.residency.lastUsedFrame < victim->second.residency.lastUsedFrame))
+                victim = it;
+        if (victim != entries.end()) {
+            cacheStats.residentBytes -= victim->second.texture.size;
+            callbacks.destroy(victim->first, victim->second.texture);
+            entries.erase(victim);
+            ++cacheStats.evictions;
+            continue;
+        }
+
+        // otherwise the least recently used referenced texture that still has a level to give up
+        auto shrink = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->second.texture.mipLevels > 1 &&
+                (shrink == entries.end() || it->second.residency.lastUsedFrame < shrink->second.residency.lastUsedFrame))
+                shrink = it;
+        if (shrink == entries.end() || !callbacks.dropMips)
+            return; // over budget with nothing left to release
+
+        VkDeviceSize oldSize = shrink->second.texture.size;
+        if (!callbacks.dropMips(shrink->first, shrink->second.texture, 1))
+            return;
+        cacheStats.residentBytes = cacheStats.residentBytes - oldSize + shrink->second.texture.size;
+        ++shrink->second.residency.droppedLevels;
+        ++cacheStats.mipDrops;
+    }
+}
+
+void TextureCache::printStats(std::ostream& out) const {
+    out << "Texture cache: " << entries.size() << " textures, " << cacheStats.residentBytes / 1024 << " / " << budget / 1024 << " KB (peak "
+        << cacheStats.peakBytes / 1024 << " KB), " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, "
+        << cacheStats.evictions << " evictions, " << cacheStats.mipDrops << " mip drops" << std::endl;
+    for (const auto& entry : entries) {
+        const Texture& texture = entry.second.texture;
+        const TextureResidency& residency = entry.second.residency;
+        out << "    " << entry.first.path << ": " << texture.width << "x" << texture.height << ", " << texture.mipLevels << " levels from "
+            << texture.baseLevel << " (" << residency.droppedLevels << " dropped), " << texture.size / 1024 << " KB, " << residency.refCount << " refs, "
+            << residency.acquireCount << " acquires, last used frame " << residency.lastUsedFrame << std::endl;
+    }
+}
+
+void TextureCache::clear() {
+    for (auto& entry : entries)
+        callbacks.destroy(entry.first, entry.second.texture);
+    entries.clear();
+    cacheStats.residentBytes = 0;
+}
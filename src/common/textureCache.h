@@ -0,0 +1,132 @@
+//textureCache.h
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// a cached texture is identified by its asset and how it is sampled
+struct TextureKey {
+	std::string path;
+	VkFormat format = VK_FORMAT_R8G8B8A8_SRGB; // requested decode format, compressed files keep their own
+	VkFilter filter = VK_FILTER_LINEAR;
+	VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	bool operator==(const TextureKey& other) const {
+		return path == other.path && format == other.format && filter == other.filter && addressMode == other.addressMode;
+	}
+};
+
+struct TextureKeyHash {
+	size_t operator()(const TextureKey& key) const {
+		size_t hash = std::hash<std::string>()(key.path);
+		hash ^= (size_t(key.format) << 16 | size_t(key.filter) << 8 | size_t(key.addressMode)) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+		return hash;
+	}
+};
+
+struct Texture {
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipLevels = 1;
+	uint32_t baseLevel = 0; // level of the source chain held in mip 0, the ones above are not resident
+	VkDeviceSize size = 0; // device memory bound to the image
+};
+
+// residency bookkeeping of one cached texture
+struct TextureResidency {
+	uint32_t refCount = 0;
+	uint32_t acquireCount = 0;
+	uint32_t droppedLevels = 0; // top mips released under memory pressure
+	uint64_t lastUsedFrame = 0;
+};
+
+struct TextureCacheStats {
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+	uint32_t evictions = 0;
+	uint32_t mipDrops = 0;
+	VkDeviceSize residentBytes = 0;
+	VkDeviceSize peakBytes = 0;
+};
+
+// deduplicates texture loads and keeps device memory under a budget, unreferenced textures are evicted
+// least recently used first, then referenced ones give up their top mip level until the budget holds
+class TextureCache {
+public:
+	struct Callbacks {
+		std::function<Texture(const TextureKey& key)> create;
+		std::function<void(const TextureKey& key, Texture& texture)> destroy;
+		// recreate the texture without its top dropCount levels, returns false when it cannot
+		std::function<bool(const TextureKey& key, Texture& texture, uint32_t dropCount)> dropMips;
+	};
+
+private:
+	struct Entry {
+		Texture texture;
+		TextureResidency residency;
+	};
+
+	Callbacks callbacks;
+	VkDeviceSize budget;
+	uint64_t frame = 0;
+	std::unordered_map<TextureKey, Entry, TextureKeyHash> entries; // node based, so Texture pointers stay valid
+	TextureCacheStats cacheStats;
+
+	void enforceBudget();
+
+public:
+	TextureCache(const Callbacks& callbacks, VkDeviceSize budget);
+
+	~TextureCache();
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// load or reuse, the pointer stays valid while referenced, its contents change when mips are dropped
+	const Texture* acquire(const TextureKey& key);
+
+	// unreferenced textures stay cached until the budget needs their memory
+	void release(const TextureKey& key);
+
+	// cached texture without taking a reference, nullptr when not resident
+	const Texture* find(const TextureKey& key) const;
+
+	// swap in a texture the caller rebuilt with another level count, e.g. by streaming mips in or out,
+	// the old handles are the caller's to destroy and the budget is enforced with the new size
+	void replace(const TextureKey& key, const Texture& texture);
+
+	// mark a texture as used this frame for the LRU order
+	void touch(const TextureKey& key);
+
+	void nextFrame() {
+		++frame;
+	}
+
+	void setBudget(VkDeviceSize bytes);
+
+	VkDeviceSize getBudget() const {
+		return budget;
+	}
+
+	const TextureCacheStats& stats() const {
+		return cacheStats;
+	}
+
+	const TextureResidency* residency(const TextureKey& key) const;
+
+	void printStats(std::ostream& out) const;
+
+	// destroy every texture, referenced or not
+	void clear();
+};
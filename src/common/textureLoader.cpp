@@ -0,0 +1,78 @@
+#include "textureLoader.h"
+#include "threadPool.h"
+#include "stbImage.h"
+#include "stb_image.h"
+
+TextureLoader::TextureLoader(ThreadPool& threadPool, size_t maxBytesInFlight)
+    : threadPool(threadPool), maxBytesInFlight(maxBytesInFlight) {
+}
+
+void TextureLoader::load(const std::vector<std::string>& paths, const std::function<void(const DecodedImage&)>& onDecoded,
+    const DestinationFunc& destination) {
+    std::vector<Slot> slots(paths.size());
+    size_t bytesInFlight = 0;
+    size_t submitted = 0;
+
+    for (size_t delivered = 0; delivered < slots.size(); ++delivered) {
+        // queue decodes ahead while they fit the budget, the next image to deliver is always queued
+        while (submitted < slots.size()) {
+            Slot& slot = slots[submitted];
+            int width = 0, height = 0, channel = 0;
+            bool valid = stbi_info(paths[submitted].c_str(), &width, &height, &channel);
+            if (valid)
+                slot.bytes = size_t(width) * height * 4;
+            if (submitted > delivered && bytesInFlight + slot.bytes > maxBytesInFlight)
+                break;
+
+            bytesInFlight += slot.bytes;
+            slot.image.path = paths[submitted];
+            unsigned char* dst = nullptr;
+            size_t dstSize = stbiLoadIntoSize(width, height);
+            if (valid && destination)
+                dst = destination(slot.image.path, width, height, dstSize);
+            slot.image.external = dst != nullptr;
+            threadPool.enqueue([this, &slot, dst, dstSize] {
+                int width, height, channel;
+                unsigned char* pixels = nullptr;
+                if (dst != nullptr)
+                    pixels = stbiLoadInto(slot.image.path.c_str(), dst, dstSize, &width, &height) ? dst : nullptr;
+                else
+                    pixels = stbi_load(slot.image.path.c_str(), &width, &height, &channel, STBI_rgb_alpha);
+                std::lock_guard<std::mutex> lock(mutex);
+                slot.image.pixels = pixels;
+                slot.image.width = pixels ? width : 0;
+                slot.image.height = pixels ? height : 0;
+                slot.image.error = pixels ? nullptr : stbi_failure_reason();
+                slot.ready = true;
+                decoded.notify_all();
+            });
+            ++submitted;
+        }
+
+        // wait for the oldest image, later ones keep decoding meanwhile
+        Slot& slot = slots[delivered];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decoded.wait(lock, [&slot] { return slot.ready; });
+        }
+
+        try {
+            onDecoded(slot.image);
+        }
+        catch (...) {
+            // the queued decodes still reference the slots, let them finish before unwinding
+            std::unique_lock<std::mutex> lock(mutex);
+            for (size_t i = delivered + 1; i < submitted; ++i)
+                decoded.wait(lock, [&slots, i] { return slots[i].ready; });
+            for (size_t i = delivered; i < submitted; ++i)
+                if (!slots[i].image.external)
+                    stbi_image_free(slots[i].image.pixels);
+            throw;
+        }
+
+        if (!slot.image.external)
+            stbi_image_free(slot.image.pixels);
+        slot.image.pixels = nullptr;
+        bytesInFlight -= slot.bytes;
+    }
+}
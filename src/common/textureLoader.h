@@ -0,0 +1,48 @@
+//textureLoader.h
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+struct DecodedImage {
+	std::string path;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	unsigned char* pixels = nullptr; // RGBA8, nullptr when decoding failed
+	const char* error = nullptr;
+	bool external = false; // pixels live in memory from the destination callback instead of the loader's heap
+};
+
+// decodes images on a worker pool while the calling thread uploads the ones that are done
+class TextureLoader {
+private:
+	struct Slot {
+		DecodedImage image;
+		size_t bytes = 0; // estimated from the header before decoding
+		bool ready = false;
+	};
+
+	ThreadPool& threadPool;
+	size_t maxBytesInFlight;
+	std::mutex mutex;
+	std::condition_variable decoded;
+
+public:
+	// called on the loading thread before an image is queued, returns at least bytes of memory the decoder
+	// writes the pixels into (such as mapped staging memory) or nullptr to decode on the heap
+	using DestinationFunc = std::function<unsigned char*(const std::string& path, uint32_t width, uint32_t height, size_t bytes)>;
+
+	TextureLoader(ThreadPool& threadPool, size_t maxBytesInFlight);
+
+	// decode every path, onDecoded runs on the calling thread in submission order and heap pixels are
+	// released after it returns, decodes stop being queued once maxBytesInFlight bytes are waiting
+	void load(const std::vector<std::string>& paths, const std::function<void(const DecodedImage&)>& onDecoded,
+		const DestinationFunc& destination = nullptr);
+};
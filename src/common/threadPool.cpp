@@ -0,0 +1,94 @@
+#include "threadPool.h"
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(size_t threadCnt) {
+    threadCnt = std::max<size_t>(threadCnt, 1);
+    for (size_t i = 0; i < threadCnt; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+        notifyFinished();
+    }
+}
+
+void ThreadPool::notifyFinished() {
+    // taking the lock orders the notification after a waiter's predicate check
+    { std::lock_guard<std::mutex> lock(mutex); }
+    taskFinished.notify_all();
+}
+
+bool ThreadPool::runPendingTask() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty())
+            return false;
+        task = std::move(tasks.front());
+        tasks.pop();
+    }
+    task();
+    notifyFinished();
+    return true;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t minChunk, const std::function<void(size_t begin, size_t end)>& func) {
+    if (count == 0)
+        return;
+
+    // a few chunks per worker keeps the load balanced
+    size_t chunkSize = std::max<size_t>(minChunk, (count + workers.size() * 4 - 1) / (workers.size() * 4));
+    size_t chunkCnt = (count + chunkSize - 1) / chunkSize;
+    if (chunkCnt == 1) {
+        func(0, count);
+        return;
+    }
+
+    std::atomic<size_t> remaining{chunkCnt};
+    for (size_t i = 0; i < chunkCnt; ++i) {
+        size_t begin = i * chunkSize;
+        size_t end = std::min(begin + chunkSize, count);
+        enqueue([&func, &remaining, begin, end] {
+            func(begin, end);
+            remaining.fetch_sub(1);
+        });
+    }
+
+    // help with queued work, then wait for chunks still running on workers
+    while (remaining.load() > 0) {
+        if (runPendingTask())
+            continue;
+        std::unique_lock<std::mutex> lock(mutex);
+        taskFinished.wait(lock, [&remaining, this] { return remaining.load() == 0 || !tasks.empty(); });
+    }
+}
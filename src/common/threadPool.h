@@ -0,0 +1,45 @@
+//threadPool.h
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	std::condition_variable taskFinished;
+	bool stopping = false;
+
+	void workerLoop();
+
+	bool runPendingTask();
+
+	void notifyFinished();
+
+public:
+	explicit ThreadPool(size_t threadCnt = std::thread::hardware_concurrency());
+
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t size() const {
+		return workers.size();
+	}
+
+	// queue a task without waiting for it
+	void enqueue(std::function<void()> task);
+
+	// split [0, count) into chunks and block until all of them ran,
+	// the calling thread helps so nested calls from workers cannot deadlock
+	void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t begin, size_t end)>& func);
+};
@@ -0,0 +1,212 @@
+#include "vertexDedup.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    uint64_t read64(const uint8_t* bytes) {
+        uint64_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    uint64_t rotl(uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+    // murmur3 finalizer, every input bit reaches every output bit
+    uint64_t fmix64(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // open addressing with linear probing, the upper hash half sits next to the index so most
+    // mismatches are rejected without touching the vertex
+    struct FlatTable {
+        struct Slot {
+            uint32_t index;
+            uint32_t hashHigh;
+        };
+
+        std::vector<Slot> slots;
+        size_t mask;
+
+        // at most half full when every vertex is unique
+        explicit FlatTable(size_t vertexCnt) {
+            size_t capacity = 16;
+            while (capacity < vertexCnt * 2)
+                capacity <<= 1;
+            slots.assign(capacity, {EMPTY_SLOT, 0});
+            mask = capacity - 1;
+        }
+
+        // index of an equal vertex already in the table, or index after inserting it
+        template<typename Equal>
+        uint32_t findOrInsert(uint64_t hash, uint32_t index, const Equal& equal) {
+            uint32_t hashHigh = uint32_t(hash >> 32);
+            for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+                Slot& slot = slots[pos];
+                if (slot.index == EMPTY_SLOT) {
+                    slot = {index, hashHigh};
+                    return index;
+                }
+                if (slot.hashHigh == hashHigh && equal(slot.index))
+                    return slot.index;
+            }
+        }
+    };
+}
+
+uint64_t hashBytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ (size * 0xc2b2ae3d27d4eb4full);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        h ^= read64(bytes + i) * 0x87c37b91114253d5ull;
+        h = rotl(h, 31) * 0x4cf5ad432745937full;
+    }
+    if (i < size) {
+        uint64_t tail = 0;
+        memcpy(&tail, bytes + i, size - i);
+        h ^= tail * 0x87c37b91114253d5ull;
+        h = rotl(h, 31) * 0x4cf5ad432745937full;
+    }
+    return fmix64(h);
+}
+
+size_t dedupVertices(const void* vertices, size_t vertexCnt, size_t vertexSize, void* uniqueVertices, uint32_t* indices) {
+    const uint8_t* src = static_cast<const uint8_t*>(vertices);
+    uint8_t* dst = static_cast<uint8_t*>(uniqueVertices);
+
+    // unique vertex k is only written once vertex k has been read, so dst may alias src
+    FlatTable table(vertexCnt);
+    size_t uniqueCnt = 0;
+    for (size_t i = 0; i < vertexCnt; ++i) {
+        const uint8_t* vertex = src + i * vertexSize;
+        uint32_t index = table.findOrInsert(hashBytes(vertex, vertexSize), uint32_t(uniqueCnt), [&](uint32_t other) {
+            return memcmp(dst + other * vertexSize, vertex, vertexSize) == 0;
+        });
+        if (index == uniqueCnt) {
+            if (dst + uniqueCnt * vertexSize != vertex)
+                memcpy(dst + uniqueCnt * vertexSize, vertex, vertexSize);
+            ++uniqueCnt;
+        }
+        indices[i] = index;
+    }
+    return uniqueCnt;
+}
+
+size_t dedupVerticesParallel(const void* vertices, size_t vertexCnt, size_t vertexSize, void* uniqueVertices, uint32_t* indices,
+    ThreadPool& threadPool) {
+    if (threadPool.size() <= 1 || vertexCnt < (1u << 16))
+        return dedupVertices(vertices, vertexCnt, vertexSize, uniqueVertices, indices);
+
+    const uint8_t* src = static_cast<const uint8_t*>(vertices);
+    uint8_t* dst = static_cast<uint8_t*>(uniqueVertices);
+
+    // fixed chunks so every pass below sees the same ranges
+    size_t chunkCnt = threadPool.size() * 4;
+    size_t chunkSize = (vertexCnt + chunkCnt - 1) / chunkCnt;
+    chunkCnt = (vertexCnt + chunkSize - 1) / chunkSize;
+    auto forEachChunk = [&](const std::function<void(size_t chunk, size_t begin, size_t end)>& func) {
+        threadPool.parallelFor(chunkCnt, 1, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; ++chunk)
+                func(chunk, chunk * chunkSize, std::min(chunk * chunkSize + chunkSize, vertexCnt));
+        });
+    };
+
+    std::vector<uint64_t> hashes(vertexCnt);
+    forEachChunk([&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            hashes[i] = hashBytes(src + i * vertexSize, vertexSize);
+    });
+
+    // shard by the top hash bits, the tables index with the low ones, a stable partition
+    // keeps input order inside every shard
+    int shardBits = 0;
+    while ((size_t(1) << shardBits) < threadPool.size() * 4)
+        ++shardBits;
+    size_t shardCnt = size_t(1) << shardBits;
+    auto shardOf = [&](size_t i) {
+        return size_t(hashes[i] >> (64 - shardBits));
+    };
+
+    std::vector<size_t> offsets(chunkCnt * shardCnt, 0);
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            ++offsets[chunk * shardCnt + shardOf(i)];
+    });
+    std::vector<size_t> shardBegin(shardCnt + 1, 0);
+    size_t running = 0;
+    for (size_t shard = 0; shard < shardCnt; ++shard) {
+        shardBegin[shard] = running;
+        for (size_t chunk = 0; chunk < chunkCnt; ++chunk) {
+            size_t count = offsets[chunk * shardCnt + shard];
+            offsets[chunk * shardCnt + shard] = running;
+            running += count;
+        }
+    }
+    shardBegin[shardCnt] = running;
+
+    std::vector<uint32_t> order(vertexCnt);
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        size_t* chunkOffsets = &offsets[chunk * shardCnt];
+        for (size_t i = begin; i < end; ++i)
+            order[chunkOffsets[shardOf(i)]++] = uint32_t(i);
+    });
+
+    // equal vertices share a shard, the first one a shard sees is the first in the input
+    std::vector<uint32_t> first(vertexCnt);
+    threadPool.parallelFor(shardCnt, 1, [&](size_t firstShard, size_t lastShard) {
+        for (size_t shard = firstShard; shard < lastShard; ++shard) {
+            FlatTable table(shardBegin[shard + 1] - shardBegin[shard]);
+            for (size_t k = shardBegin[shard]; k < shardBegin[shard + 1]; ++k) {
+                uint32_t i = order[k];
+                const uint8_t* vertex = src + size_t(i) * vertexSize;
+                first[i] = table.findOrInsert(hashes[i], i, [&](uint32_t other) {
+                    return memcmp(src + size_t(other) * vertexSize, vertex, vertexSize) == 0;
+                });
+            }
+        }
+    });
+
+    // number the first occurrences in input order, then point every vertex at its first occurrence
+    std::vector<size_t> chunkUnique(chunkCnt + 1, 0);
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            chunkUnique[chunk + 1] += first[i] == i;
+    });
+    for (size_t chunk = 0; chunk < chunkCnt; ++chunk)
+        chunkUnique[chunk + 1] += chunkUnique[chunk];
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        uint32_t next = uint32_t(chunkUnique[chunk]);
+        for (size_t i = begin; i < end; ++i)
+            if (first[i] == i)
+                indices[i] = next++;
+    });
+    forEachChunk([&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            if (first[i] != i)
+                indices[i] = indices[first[i]];
+    });
+
+    // compacting in place has to run front to back, a separate output can be filled in parallel
+    bool inPlace = dst < src + vertexCnt * vertexSize && src < dst + vertexCnt * vertexSize;
+    auto compact = [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            if (first[i] == i && dst + size_t(indices[i]) * vertexSize != src + i * vertexSize)
+                memcpy(dst + size_t(indices[i]) * vertexSize, src + i * vertexSize, vertexSize);
+    };
+    if (inPlace)
+        compact(0, 0, vertexCnt);
+    else
+        forEachChunk(compact);
+    return chunkUnique[chunkCnt];
+}
@@ -0,0 +1,20 @@
+//vertexDedup.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// 64 bit hash of raw bytes, grid aligned float positions still spread over the whole table
+uint64_t hashBytes(const void* data, size_t size);
+
+// collapse identical vertices of vertexSize bytes each, returns the unique count. Unique vertices are written to
+// uniqueVertices in first occurrence order, which may be vertices itself, and indices[i] names the unique vertex of
+// vertices[i]. Vertices are compared bytewise, so the vertex type must not contain padding and 0.0 differs from -0.0
+size_t dedupVertices(const void* vertices, size_t vertexCnt, size_t vertexSize, void* uniqueVertices, uint32_t* indices);
+
+// same result as dedupVertices, vertices are sharded by hash so every worker probes its own table
+size_t dedupVerticesParallel(const void* vertices, size_t vertexCnt, size_t vertexSize, void* uniqueVertices, uint32_t* indices,
+	ThreadPool& threadPool);
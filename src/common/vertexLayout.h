@@ -0,0 +1,123 @@
+//vertexLayout.h
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// N components stored as T that the vertex fetch reads as Format, indexable like the plain array it wraps
+template<typename T, size_t N, VkFormat Format>
+struct PackedComponents {
+	T v[N];
+
+	static constexpr VkFormat format = Format;
+
+	constexpr T& operator[](size_t i) { return v[i]; }
+	constexpr const T& operator[](size_t i) const { return v[i]; }
+};
+
+namespace vertexLayoutDetail {
+	constexpr VkFormat snorm16Formats[] = {VK_FORMAT_UNDEFINED, VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16B16_SNORM, VK_FORMAT_R16G16B16A16_SNORM};
+	constexpr VkFormat unorm16Formats[] = {VK_FORMAT_UNDEFINED, VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16A16_UNORM};
+	constexpr VkFormat halfFormats[] = {VK_FORMAT_UNDEFINED, VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT};
+	constexpr VkFormat snorm8Formats[] = {VK_FORMAT_UNDEFINED, VK_FORMAT_R8_SNORM, VK_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8B8_SNORM, VK_FORMAT_R8G8B8A8_SNORM};
+	constexpr VkFormat unorm8Formats[] = {VK_FORMAT_UNDEFINED, VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_R8G8B8A8_UNORM};
+
+	template<size_t Total, size_t N>
+	constexpr void append(std::array<VkVertexInputAttributeDescription, Total>& all, size_t& cnt, const std::array<VkVertexInputAttributeDescription, N>& descs) {
+		for (size_t i = 0; i < N; ++i)
+			all[cnt++] = descs[i];
+	}
+
+	template<size_t BindingCnt, size_t AttributeCnt>
+	constexpr bool unique(const std::array<VkVertexInputBindingDescription, BindingCnt>& bindings,
+		const std::array<VkVertexInputAttributeDescription, AttributeCnt>& attributes) {
+		for (size_t i = 0; i < BindingCnt; ++i)
+			for (size_t j = i + 1; j < BindingCnt; ++j)
+				if (bindings[i].binding == bindings[j].binding)
+					return false;
+		for (size_t i = 0; i < AttributeCnt; ++i)
+			for (size_t j = i + 1; j < AttributeCnt; ++j)
+				if (attributes[i].location == attributes[j].location)
+					return false;
+		return true;
+	}
+}
+
+// the bit patterns come from vertexQuantize, half is binary16 in a uint16_t
+template<size_t N> using Snorm16 = PackedComponents<int16_t, N, vertexLayoutDetail::snorm16Formats[N]>;
+template<size_t N> using Unorm16 = PackedComponents<uint16_t, N, vertexLayoutDetail::unorm16Formats[N]>;
+template<size_t N> using Half = PackedComponents<uint16_t, N, vertexLayoutDetail::halfFormats[N]>;
+template<size_t N> using Snorm8 = PackedComponents<int8_t, N, vertexLayoutDetail::snorm8Formats[N]>;
+template<size_t N> using Unorm8 = PackedComponents<uint8_t, N, vertexLayoutDetail::unorm8Formats[N]>;
+
+// VkFormat of a vertex field type, plain floats and ints map to their 32-bit formats
+template<typename T>
+struct VertexFormat {
+	static constexpr VkFormat value = T::format;
+};
+template<> struct VertexFormat<float> { static constexpr VkFormat value = VK_FORMAT_R32_SFLOAT; };
+template<> struct VertexFormat<glm::vec2> { static constexpr VkFormat value = VK_FORMAT_R32G32_SFLOAT; };
+template<> struct VertexFormat<glm::vec3> { static constexpr VkFormat value = VK_FORMAT_R32G32B32_SFLOAT; };
+template<> struct VertexFormat<glm::vec4> { static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SFLOAT; };
+template<> struct VertexFormat<int32_t> { static constexpr VkFormat value = VK_FORMAT_R32_SINT; };
+template<> struct VertexFormat<glm::ivec2> { static constexpr VkFormat value = VK_FORMAT_R32G32_SINT; };
+template<> struct VertexFormat<glm::ivec4> { static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SINT; };
+template<> struct VertexFormat<uint32_t> { static constexpr VkFormat value = VK_FORMAT_R32_UINT; };
+template<> struct VertexFormat<glm::uvec2> { static constexpr VkFormat value = VK_FORMAT_R32G32_UINT; };
+template<> struct VertexFormat<glm::uvec4> { static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_UINT; };
+
+template<uint32_t Location, VkFormat Format, uint32_t Offset, uint32_t Size>
+struct VertexAttribute {
+	static constexpr uint32_t location = Location;
+	static constexpr VkFormat format = Format;
+	static constexpr uint32_t offset = Offset;
+	static constexpr uint32_t size = Size;
+};
+
+// a field of vertex read at a shader location, format and offset follow from its declaration
+#define VERTEX_ATTRIBUTE(vertex, member, location) \
+	VertexAttribute<location, VertexFormat<decltype(vertex::member)>::value, uint32_t(offsetof(vertex, member)), uint32_t(sizeof(vertex::member))>
+
+// one vertex buffer binding holding an array of Vertex
+template<typename Vertex, uint32_t Binding, VkVertexInputRate InputRate, typename... Attributes>
+struct VertexStream {
+	static_assert(sizeof...(Attributes) > 0, "A vertex stream needs at least one attribute.");
+	static_assert(((Attributes::offset + Attributes::size <= sizeof(Vertex)) && ...), "Vertex attribute lies outside its vertex.");
+
+	static constexpr uint32_t binding = Binding;
+	static constexpr uint32_t stride = uint32_t(sizeof(Vertex));
+	static constexpr uint32_t attributeCount = uint32_t(sizeof...(Attributes));
+
+	static constexpr VkVertexInputBindingDescription bindingDesc = {Binding, stride, InputRate};
+	static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> attributeDescs = {{
+		{Attributes::location, Binding, Attributes::format, Attributes::offset}...
+	}};
+};
+
+template<typename Vertex, typename... Attributes>
+using PerVertexStream = VertexStream<Vertex, 0, VK_VERTEX_INPUT_RATE_VERTEX, Attributes...>;
+
+// the vertex input of a pipeline, every stream is a binding of its own so positions can live apart from the rest
+template<typename... Streams>
+struct VertexLayout {
+	static constexpr uint32_t bindingCount = uint32_t(sizeof...(Streams));
+	static constexpr uint32_t attributeCount = (Streams::attributeCount + ...);
+
+	static constexpr std::array<VkVertexInputBindingDescription, sizeof...(Streams)> bindings = {{Streams::bindingDesc...}};
+	static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> attributes = [] {
+		std::array<VkVertexInputAttributeDescription, attributeCount> all{};
+		size_t cnt = 0;
+		(vertexLayoutDetail::append(all, cnt, Streams::attributeDescs), ...);
+		return all;
+	}();
+	static_assert(vertexLayoutDetail::unique(bindings, attributes), "Vertex bindings and attribute locations must be unique.");
+
+	static constexpr VkPipelineVertexInputStateCreateInfo inputState() {
+		return {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO, nullptr, 0,
+			bindingCount, bindings.data(), attributeCount, attributes.data()};
+	}
+};
@@ -0,0 +1,110 @@
+#include "vertexQuantize.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+int16_t quantizeSnorm16(float value) {
+    value = std::min(std::max(value, -1.0f), 1.0f);
+    return static_cast<int16_t>(std::lround(value * 32767.0f));
+}
+
+uint16_t quantizeUnorm16(float value) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<uint16_t>(std::lround(value * 65535.0f));
+}
+
+uint8_t quantizeUnorm8(float value) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<uint8_t>(std::lround(value * 255.0f));
+}
+
+uint16_t quantizeHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    // nan keeps a quiet payload, infinity stays infinity
+    if (exponent == 0xffu)
+        return uint16_t(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+
+    int32_t halfExponent = int32_t(exponent) - 127 + 15;
+    if (halfExponent >= 31)
+        return uint16_t(sign | 0x7c00u);
+
+    // subnormal halves, shift the implicit one in and round the bits that fall off
+    if (halfExponent <= 0) {
+        if (halfExponent < -10)
+            return uint16_t(sign);
+        mantissa |= 0x800000u;
+        uint32_t shift = uint32_t(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1u)))
+            ++half;
+        return uint16_t(sign | half);
+    }
+
+    // a carry out of the mantissa correctly bumps the exponent, up to infinity
+    uint32_t half = (uint32_t(halfExponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fffu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+        ++half;
+    return uint16_t(sign | half);
+}
+
+float dequantizeHalf(uint16_t value) {
+    uint32_t sign = uint32_t(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0x1fu) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else {
+        // subnormal or zero, exactly representable as a float
+        float magnitude = std::ldexp(float(mantissa), -24);
+        memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= sign;
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+void encodeOctahedral(const float normal[3], int16_t encoded[2]) {
+    float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    float x = length == 0.0f ? 0.0f : normal[0] / length;
+    float y = length == 0.0f ? 0.0f : normal[1] / length;
+
+    // the lower hemisphere folds over the diagonals
+    if (normal[2] < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = quantizeSnorm16(x);
+    encoded[1] = quantizeSnorm16(y);
+}
+
+void decodeOctahedral(const int16_t encoded[2], float normal[3]) {
+    float x = std::max(encoded[0] / 32767.0f, -1.0f);
+    float y = std::max(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+    // unfold, same as the shader side: xy -= sign(xy) * max(-z, 0)
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
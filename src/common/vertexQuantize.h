@@ -0,0 +1,23 @@
+//vertexQuantize.h
+
+#pragma once
+
+#include <cstdint>
+
+// round to nearest, values outside the range are clamped. The snorm mapping is the one vulkan decodes,
+// max(q / 32767, -1), so -32768 never appears
+int16_t quantizeSnorm16(float value);
+
+uint16_t quantizeUnorm16(float value);
+
+uint8_t quantizeUnorm8(float value);
+
+// IEEE 754 binary16, round to nearest even, overflow turns into infinity
+uint16_t quantizeHalf(float value);
+
+float dequantizeHalf(uint16_t value);
+
+// unit normal on the octahedron folded into [-1, 1]^2, two snorm16 instead of three floats
+void encodeOctahedral(const float normal[3], int16_t encoded[2]);
+
+void decodeOctahedral(const int16_t encoded[2], float normal[3]);
@@ -34,7 +34,7 @@ bool SpirvHelper::GLSLFileLoader(std::string path, std::string& shaderSource){
     return true;
 }
 
-bool SpirvHelper::GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader, std::vector<uint32_t> &spirv) {
+bool SpirvHelper::GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader, std::vector<uint32_t> &spirv, const char *preamble) {
     EShLanguage stage = FindLanguage(shader_type);
     glslang::TShader shader(stage);
     glslang::TProgram program;
@@ -47,6 +47,7 @@ bool SpirvHelper::GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char
 
     shaderStrings[0] = pshader;
     shader.setStrings(shaderStrings, 1);
+    shader.setPreamble(preamble);
 
     if (!shader.parse(&Resources, 100, false, messages)) {
         puts(shader.getInfoLog());
@@ -69,7 +70,7 @@ bool SpirvHelper::GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char
     return true;
 }
 
-bool SpirvHelper::createVFShader(std::string vsPath, std::string fsPath, std::vector<uint32_t>& vsSPIRV, std::vector<uint32_t>& fsSPIRV){
+bool SpirvHelper::createVFShader(std::string vsPath, std::string fsPath, std::vector<uint32_t>& vsSPIRV, std::vector<uint32_t>& fsSPIRV, const std::string& preamble){
     // load shader
     std::string vsShader = "";
     std::string fsShader = "";
@@ -77,8 +78,8 @@ bool SpirvHelper::createVFShader(std::string vsPath, std::string fsPath, std::ve
     VK_EXPECT_TRUE(GLSLFileLoader(fsPath, fsShader), "Failed to read fragment shader.");
 
     // spirv convert
-    VK_EXPECT_TRUE(GLSLtoSPV(VK_SHADER_STAGE_VERTEX_BIT, vsShader.c_str(), vsSPIRV), "Failed to convert vertex glsl code to SPIRV.");
-    VK_EXPECT_TRUE(GLSLtoSPV(VK_SHADER_STAGE_FRAGMENT_BIT, fsShader.c_str(), fsSPIRV), "Failed to convert fragment code to SPIRV.");
+    VK_EXPECT_TRUE(GLSLtoSPV(VK_SHADER_STAGE_VERTEX_BIT, vsShader.c_str(), vsSPIRV, preamble.c_str()), "Failed to convert vertex glsl code to SPIRV.");
+    VK_EXPECT_TRUE(GLSLtoSPV(VK_SHADER_STAGE_FRAGMENT_BIT, fsShader.c_str(), fsSPIRV, preamble.c_str()), "Failed to convert fragment code to SPIRV.");
 
     return true;
 }
@@ -18,14 +18,15 @@ public:
 
 	bool GLSLFileLoader(std::string path, std::string& shaderSource);
 
-	bool createVFShader(std::string vsPath, std::string fsPath, std::vector<uint32_t>& vsSPIRV, std::vector<uint32_t>& fsSPIRV);
+	// preamble is inserted after #version in both stages, e.g. "#define NAME\n" lines to pick a variant
+	bool createVFShader(std::string vsPath, std::string fsPath, std::vector<uint32_t>& vsSPIRV, std::vector<uint32_t>& fsSPIRV, const std::string& preamble = "");
 
 private:
 	void InitResources(TBuiltInResource &Resources);
 
 	EShLanguage FindLanguage(const VkShaderStageFlagBits shader_type);
 	
-	bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader, std::vector<uint32_t>& spirv);
+	bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader, std::vector<uint32_t>& spirv, const char *preamble = "");
 };
 
 class VKShader {
@@ -36,9 +37,10 @@ private:
 
 	std::string vs_path;
 	std::string fs_path;
+	std::string preamble;
 
 	bool getVFShader(std::vector<uint32_t>& vs, std::vector<uint32_t>& fs){
-		return spirvHelper.createVFShader(vs_path, fs_path, vs, fs);
+		return spirvHelper.createVFShader(vs_path, fs_path, vs, fs, preamble);
 	}
 
 public:
@@ -49,12 +51,13 @@ public:
 
 	VKShader() = delete;
 
-	VKShader(std::string vsPath, std::string fsPath){
+	VKShader(std::string vsPath, std::string fsPath, std::string shaderPreamble = ""){
 		if(objectCnt++ == 0)
 			SpirvHelper::Init();
 
 		vs_path = vsPath;
 		fs_path = fsPath;
+		preamble = shaderPreamble;
 
 		getVFShader(vs_spirv, fs_spirv);
 		vs_size = vs_spirv.size() * sizeof(uint32_t);
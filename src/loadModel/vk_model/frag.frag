@@ -2,10 +2,24 @@
 
 layout (location = 0) in vec4 color;
 layout (location = 1) in vec2 texcoord;
+layout (location = 2) flat in uint material;
 layout (location = 0) out vec4 FragColor;
 
 layout(set = 0, binding = 1) uniform sampler2D tex;
 
+const uint MATERIAL_TEXTURED = 1u; // the base color is multiplied by tex
+
+struct Material{
+    vec4 baseColor; // alpha is the dissolve
+    uint flags;
+};
+
+layout(set = 0, binding = 2, std430) readonly buffer Materials{
+    Material materials[];
+};
+
 void main(){
-    FragColor = color.bgra * texture(tex, texcoord);
-}
\ No newline at end of file
+    Material m = materials[material];
+    vec4 albedo = (m.flags & MATERIAL_TEXTURED) != 0u ? texture(tex, texcoord) : vec4(1);
+    FragColor = color.bgra * m.baseColor * albedo;
+}
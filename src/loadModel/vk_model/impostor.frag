@@ -0,0 +1,97 @@
+#version 450
+
+layout (location = 0) in vec3 position;
+layout (location = 0) out vec4 FragColor;
+
+layout (set = 0, binding = 0) uniform UBO{
+    float padding;
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 uvTransform;
+    vec4 positionScale;
+    vec4 positionOffset;
+}ubo;
+
+// frames x frames views of the model, each an orthographic square over the bounding sphere
+layout (set = 0, binding = 1) uniform sampler2D albedo; // alpha 0 where the model did not cover the frame
+layout (set = 0, binding = 2) uniform sampler2D depth; // 0 at the sphere's near side, 1 at its far side
+
+layout (push_constant) uniform Impostor{
+    vec4 center; // xyz bounding sphere center in model space, w radius
+    vec4 camera; // xyz camera in model space, w frames per atlas side
+}impostor;
+
+// the whole sphere of directions folded onto [0, 1]^2, frame (x, y) looks from the direction at (x, y) / (frames - 1)
+vec2 octahedralEncode(vec3 n){
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = n.z >= 0 ? n.xy : (1 - abs(n.yx)) * mix(vec2(-1), vec2(1), greaterThanEqual(n.xy, vec2(0)));
+    return folded * 0.5 + 0.5;
+}
+
+vec3 octahedralDecode(vec2 uv){
+    vec2 f = uv * 2 - 1;
+    vec3 n = vec3(f, 1 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0)));
+    return normalize(n);
+}
+
+// as glm::lookAt builds it from the frame's eye toward the center
+void frameBasis(vec3 direction, out vec3 right, out vec3 up){
+    vec3 forward = -direction;
+    vec3 upHint = abs(forward.z) > 0.999 ? vec3(0, 1, 0) : vec3(0, 0, 1);
+    right = normalize(cross(forward, upHint));
+    up = cross(right, forward);
+}
+
+// the frame sampled where this fragment's view ray crosses the frame's plane through the center. The offset is how far
+// in front of that plane the surface the frame saw lies
+vec4 sampleFrame(ivec2 frame, vec3 ray, out float offset){
+    float frames = impostor.camera.w, radius = impostor.center.w;
+    vec3 direction = octahedralDecode(vec2(frame) / (frames - 1)), right, up;
+    frameBasis(direction, right, up);
+    float facing = dot(ray, direction);
+    float t = dot(impostor.center.xyz - impostor.camera.xyz, direction) / (abs(facing) > 1e-4 ? facing : 1e-4);
+    vec3 local = impostor.camera.xyz + ray * t - impostor.center.xyz;
+    vec2 uv = 0.5 + vec2(dot(local, right), -dot(local, up)) / (2 * radius);
+    offset = 0;
+    if(any(lessThan(uv, vec2(0))) || any(greaterThan(uv, vec2(1))))
+        return vec4(0);
+
+    // half a texel in from the frame's edges, bilinear filtering never reaches into the neighbouring frame
+    vec2 halfTexel = 0.5 * frames / vec2(textureSize(albedo, 0));
+    vec2 atlasUv = (vec2(frame) + clamp(uv, halfTexel, 1 - halfTexel)) / frames;
+    offset = radius - 2 * radius * texture(depth, atlasUv).r;
+    return texture(albedo, atlasUv);
+}
+
+void main(){
+    // the four frames around the view direction, weighted by how close each one is to it
+    float frames = impostor.camera.w;
+    vec2 grid = octahedralEncode(normalize(impostor.camera.xyz - impostor.center.xyz)) * (frames - 1);
+    ivec2 base = ivec2(min(floor(grid), vec2(frames - 2)));
+    vec2 blend = grid - vec2(base);
+    vec3 ray = normalize(position - impostor.camera.xyz);
+
+    vec4 color = vec4(0);
+    float coverage = 0, offset = 0;
+    for(int i = 0; i < 4; ++i){
+        ivec2 corner = ivec2(i & 1, i >> 1);
+        vec2 along = mix(1 - blend, blend, vec2(corner));
+        float frameOffset;
+        vec4 frameColor = sampleFrame(base + corner, ray, frameOffset);
+        float weight = along.x * along.y * frameColor.a;
+        color += weight * frameColor;
+        coverage += weight;
+        offset += weight * frameOffset;
+    }
+    if(coverage < 0.5)
+        discard;
+    FragColor = vec4(color.rgb / coverage, 1);
+
+    // depth of the baked surface, moved toward the camera from the quad by the blended offset
+    vec3 surface = position - ray * (offset / coverage) / max(dot(-ray, normalize(impostor.camera.xyz - impostor.center.xyz)), 1e-4);
+    vec4 clip = ubo.proj * ubo.view * ubo.model * vec4(surface, 1);
+    gl_FragDepth = clip.z / clip.w;
+}
@@ -0,0 +1,32 @@
+#version 450
+
+// one quad over the model's bounding sphere, facing the camera, built in model space so the model matrix still applies
+layout (location = 0) out vec3 position;
+
+layout (set = 0, binding = 0) uniform UBO{
+    float padding;
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 uvTransform;
+    vec4 positionScale;
+    vec4 positionOffset;
+}ubo;
+
+layout (push_constant) uniform Impostor{
+    vec4 center; // xyz bounding sphere center in model space, w radius
+    vec4 camera; // xyz camera in model space, w frames per atlas side
+}impostor;
+
+void main(){
+    // the same right and up the baked frames were rendered with, see frameBasis in impostor.frag
+    vec3 forward = normalize(impostor.center.xyz - impostor.camera.xyz);
+    vec3 upHint = abs(forward.z) > 0.999 ? vec3(0, 1, 0) : vec3(0, 0, 1);
+    vec3 right = normalize(cross(forward, upHint));
+    vec3 up = cross(right, forward);
+
+    // triangle strip, two triangles
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2 - 1;
+    position = impostor.center.xyz + (right * corner.x + up * corner.y) * impostor.center.w;
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1);
+}
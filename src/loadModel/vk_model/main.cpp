@@ -1,72 +1,298 @@
 #include "common/vkShader.h"
 #include "common/util.h"
+#include "common/threadPool.h"
+#include "common/mipmap.h"
+#include "common/ktx2.h"
+#include "common/textureLoader.h"
+#include "common/textureCache.h"
+#include "common/vertexDedup.h"
+#include "common/objParser.h"
+#include "common/meshCache.h"
+#include "common/meshOptimizer.h"
+#include "common/vertexQuantize.h"
+#include "common/vertexLayout.h"
+#include "common/meshlet.h"
+#include "common/meshSimplify.h"
 #include <cstdint>
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/hash.hpp>
-#define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 #include <set>
+#include <map>
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <algorithm>
 #include <unordered_map>
+#include <deque>
+#include <functional>
+#include <fstream>
 
 #ifndef FRAMES_IN_FLIGHT
     #define FRAMES_IN_FLIGHT 2
 #endif
 
+#ifndef TEXTURE_HOST_IMAGE_COPY
+    #define TEXTURE_HOST_IMAGE_COPY 1
+#endif
+
+#ifndef TEXTURE_UPLOAD_COMPARE
+    #define TEXTURE_UPLOAD_COMPARE 0 // with host image copy, upload the texture again through it and through staging and print both times
+#endif
+
+#ifndef TEXTURE_KTX2
+    #define TEXTURE_KTX2 1
+#endif
+
+#ifndef TEXTURE_BUDGET
+    #define TEXTURE_BUDGET (256ull << 20) // device memory for textures, capped to half the device local heap
+#endif
+
+#ifndef TEXTURE_DECODE_BUDGET
+    #define TEXTURE_DECODE_BUDGET (256ull << 20) // decoded bytes waiting for upload
+#endif
+
+#ifndef TEXTURE_STREAMING
+    #define TEXTURE_STREAMING 1 // start at a small mip tail and stream finer levels as they become visible
+#endif
+
+#ifndef TEXTURE_STREAM_TAIL_SIZE
+    #define TEXTURE_STREAM_TAIL_SIZE 64 // largest level made resident at load
+#endif
+
+#ifndef TEXTURE_DYNAMIC_DEMO
+    #define TEXTURE_DYNAMIC_DEMO 0 // draw the model with a cpu generated heatmap rewritten a band at a time
+#endif
+
+#ifndef VERTEX_DEDUP_PARALLEL
+    #define VERTEX_DEDUP_PARALLEL 1 // shard vertex deduplication over the thread pool
+#endif
+
+#ifndef MODEL_FAST_OBJ
+    #define MODEL_FAST_OBJ 1 // parse the model with the mapped, chunked parser instead of tinyobj
+#endif
+
+#ifndef VERTEX_COMPACT
+    #define VERTEX_COMPACT 1 // quantize positions and uvs against the model bounds where the device supports the formats
+#endif
+
+#ifndef VERTEX_COMPACT_HALF_POSITION
+    #define VERTEX_COMPACT_HALF_POSITION 0 // half float positions instead of snorm16
+#endif
+
+#ifndef VERTEX_COMPACT_COLOR
+    #define VERTEX_COMPACT_COLOR 0 // keep an unorm8 vertex color, the model only ever has white
+#endif
+
+#ifndef VERTEX_SPLIT_STREAMS
+    #define VERTEX_SPLIT_STREAMS 1 // positions in a vertex buffer of their own, the other attributes in a second one
+#endif
+
+#ifndef DEPTH_PREPASS
+    #define DEPTH_PREPASS 0 // draw depth from positions alone first, then shade with an equal depth test
+#endif
+
+#ifndef VERTEX_PULLING
+    #define VERTEX_PULLING 0 // no vertex input state, the vertex shader reads vertices through buffer device addresses
+#endif
+
+#ifndef VERTEX_PULLING_INDICES
+    #define VERTEX_PULLING_INDICES 0 // pull indices as well and draw non-indexed, every corner is shaded on its own
+#endif
+
+#ifndef DRAW_TIMING_FRAMES
+    #define DRAW_TIMING_FRAMES 0 // print the GPU time of the model draws averaged over this many frames, 0 turns it off
+#endif
+
+#ifndef MODEL_SWITCH_LOG
+    #define MODEL_SWITCH_LOG 0 // print when the model changes level of detail or swaps with its impostor
+#endif
+
+#ifndef INDEX_16BIT
+    #define INDEX_16BIT 1 // 16-bit indices whenever the vertex count fits
+#endif
+
+#ifndef MODEL_OPTIMIZE
+    #define MODEL_OPTIMIZE 1 // reorder the model for the post-transform cache, overdraw and vertex fetch after import
+#endif
+
+#ifndef MODEL_CACHE
+    #define MODEL_CACHE 1 // keep the imported model in a binary file next to the OBJ and map it on later runs
+#endif
+
+#ifndef MODEL_CACHE_COMPRESS
+    #define MODEL_CACHE_COMPRESS 1 // store the cached vertex and index blobs encoded, decoded straight into staging memory
+#endif
+
+#ifndef MODEL_LOD_COUNT
+    #define MODEL_LOD_COUNT 4 // levels of detail including the full model, each simplified to half the triangles of the one before
+#endif
+
+#ifndef MODEL_LOD_MAX_ERROR
+    #define MODEL_LOD_MAX_ERROR 0.05f // a level stops simplifying before its surface moves further than this times the model radius
+#endif
+
+#ifndef MODEL_LOD_PIXEL_ERROR
+    #define MODEL_LOD_PIXEL_ERROR 1.0f // draw the coarsest level whose error covers at most this many pixels on screen
+#endif
+
+#ifndef MODEL_LOD_HYSTERESIS
+    #define MODEL_LOD_HYSTERESIS 0.25f // a switch needs the error this far past the threshold, so the level does not flicker on the boundary
+#endif
+
+#ifndef MESHLET_CULLING
+    #define MESHLET_CULLING 1 // draw only the meshlets in the frustum that do not face away, culled on the CPU every frame
+#endif
+
+#ifndef MESHLET_MAX_VERTICES
+    #define MESHLET_MAX_VERTICES 64
+#endif
+
+#ifndef MESHLET_MAX_TRIANGLES
+    #define MESHLET_MAX_TRIANGLES 124
+#endif
+
+#ifndef IMPOSTORS
+    #define IMPOSTORS 1 // bake views of the model into an octahedral atlas and draw one quad instead once it is far away
+#endif
+
+#ifndef IMPOSTOR_DISTANCE
+    #define IMPOSTOR_DISTANCE 10.0f // in model radii, from the camera to the model's center, where the model is about a frame's size on screen
+#endif
+
+#ifndef CAMERA_ZOOM_STEP
+    #define CAMERA_ZOOM_STEP 1.1f // camera distance factor per mouse wheel notch
+#endif
+
+#ifndef IMPOSTOR_FRAMES
+    #define IMPOSTOR_FRAMES 8 // views per atlas side, spread over the whole sphere of directions
+#endif
+
+#ifndef IMPOSTOR_FRAME_SIZE
+    #define IMPOSTOR_FRAME_SIZE 128 // texels per view side
+#endif
+
+#ifndef MODEL_STREAMING
+    #define MODEL_STREAMING 0 // read the model a block at a time and upload deduplicated batches as they are parsed
+#endif
+
+#ifndef MODEL_STREAM_BATCH
+    #define MODEL_STREAM_BATCH 65535 // corners per uploaded batch, whole triangles
+#endif
+
 struct Vertex{
     glm::vec3 pos;
     glm::vec3 col;
     glm::vec2 texcoord;
 
-    static std::vector<VkVertexInputBindingDescription> getVertexInputBindingDesc(){
-        std::vector<VkVertexInputBindingDescription> desc{{}};
-        desc[0].binding = 0;
-        desc[0].stride = sizeof(Vertex);
-        desc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return desc;
-    }
-    static std::vector<VkVertexInputAttributeDescription> getVertexInputAttribDesc(){
-        std::vector<VkVertexInputAttributeDescription> desc{3};
-        desc[0].binding = 0;
-        desc[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        desc[0].location = 0;
-        desc[0].offset = offsetof(Vertex, pos);
-        desc[1].binding = 0;
-        desc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        desc[1].location = 1;
-        desc[1].offset = offsetof(Vertex, col);
-        desc[2].binding = 0;
-        desc[2].format = VK_FORMAT_R32G32_SFLOAT;
-        desc[2].location = 2;
-        desc[2].offset = offsetof(Vertex, texcoord);
-        return  desc;
-    }
-
     bool operator==(const Vertex& other) const{
         return pos == other.pos && col == other.col && texcoord == other.texcoord;
     }
 };
 
-namespace std{
-    template<> struct hash<Vertex>{
-        size_t operator()(Vertex const& vertex) const{
-            return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.col) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texcoord) << 1);
-        }
-    };
-}
+// deduplication compares vertices bytewise
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must not contain padding.");
+
+using VertexInput = VertexLayout<PerVertexStream<Vertex,
+    VERTEX_ATTRIBUTE(Vertex, pos, 0),
+    VERTEX_ATTRIBUTE(Vertex, col, 1),
+    VERTEX_ATTRIBUTE(Vertex, texcoord, 2)>>;
+
+// Vertex quantized against the model bounds, the uniform buffer scales positions and uvs back
+struct CompactVertex{
+    #if VERTEX_COMPACT_HALF_POSITION
+    Half<4> pos; // in [-1, 1], w is 1
+    #else
+    Snorm16<4> pos;
+    #endif
+    Unorm16<2> texcoord; // in [0, 1]
+    #if VERTEX_COMPACT_COLOR
+    Unorm8<4> col;
+    #endif
+};
+
+static_assert(sizeof(CompactVertex) == 12 + 4 * VERTEX_COMPACT_COLOR, "CompactVertex must not contain padding.");
+
+#if VERTEX_COMPACT_COLOR
+using CompactVertexInput = VertexLayout<PerVertexStream<CompactVertex,
+    VERTEX_ATTRIBUTE(CompactVertex, pos, 0),
+    VERTEX_ATTRIBUTE(CompactVertex, col, 1),
+    VERTEX_ATTRIBUTE(CompactVertex, texcoord, 2)>>;
+#else
+using CompactVertexInput = VertexLayout<PerVertexStream<CompactVertex,
+    VERTEX_ATTRIBUTE(CompactVertex, pos, 0),
+    VERTEX_ATTRIBUTE(CompactVertex, texcoord, 2)>>;
+#endif
+
+// the position stream is the first bytes of each interleaved vertex, the attribute stream the rest in the same order
+struct VertexPosition{
+    glm::vec3 pos;
+};
+
+struct VertexAttributes{
+    glm::vec3 col;
+    glm::vec2 texcoord;
+};
+
+static_assert(sizeof(VertexPosition) == offsetof(Vertex, col) && sizeof(VertexAttributes) == sizeof(Vertex) - sizeof(VertexPosition) &&
+    offsetof(VertexAttributes, texcoord) == offsetof(Vertex, texcoord) - sizeof(VertexPosition), "Split streams must slice Vertex.");
+
+using SplitVertexInput = VertexLayout<
+    VertexStream<VertexPosition, 0, VK_VERTEX_INPUT_RATE_VERTEX, VERTEX_ATTRIBUTE(VertexPosition, pos, 0)>,
+    VertexStream<VertexAttributes, 1, VK_VERTEX_INPUT_RATE_VERTEX, VERTEX_ATTRIBUTE(VertexAttributes, col, 1), VERTEX_ATTRIBUTE(VertexAttributes, texcoord, 2)>>;
+
+struct CompactVertexPosition{
+    decltype(CompactVertex::pos) pos;
+};
+
+struct CompactVertexAttributes{
+    Unorm16<2> texcoord;
+    #if VERTEX_COMPACT_COLOR
+    Unorm8<4> col;
+    #endif
+};
+
+static_assert(sizeof(CompactVertexPosition) == offsetof(CompactVertex, texcoord) &&
+    sizeof(CompactVertexAttributes) == sizeof(CompactVertex) - sizeof(CompactVertexPosition), "Split streams must slice CompactVertex.");
+
+#if VERTEX_COMPACT_COLOR
+using SplitCompactVertexInput = VertexLayout<
+    VertexStream<CompactVertexPosition, 0, VK_VERTEX_INPUT_RATE_VERTEX, VERTEX_ATTRIBUTE(CompactVertexPosition, pos, 0)>,
+    VertexStream<CompactVertexAttributes, 1, VK_VERTEX_INPUT_RATE_VERTEX, VERTEX_ATTRIBUTE(CompactVertexAttributes, col, 1),
+        VERTEX_ATTRIBUTE(CompactVertexAttributes, texcoord, 2)>>;
+#else
+using SplitCompactVertexInput = VertexLayout<
+    VertexStream<CompactVertexPosition, 0, VK_VERTEX_INPUT_RATE_VERTEX, VERTEX_ATTRIBUTE(CompactVertexPosition, pos, 0)>,
+    VertexStream<CompactVertexAttributes, 1, VK_VERTEX_INPUT_RATE_VERTEX, VERTEX_ATTRIBUTE(CompactVertexAttributes, texcoord, 2)>>;
+#endif
+
+// what the depth prepass reads, either the position stream or the position of each interleaved vertex
+template<typename T>
+using PositionInput = VertexLayout<PerVertexStream<T, VERTEX_ATTRIBUTE(T, pos, 0)>>;
 
 class App{
 private:
     GLFWwindow* window;
-    VKShader shader{CURRENT_FILE_DIR"/vert.vert", CURRENT_FILE_DIR"/frag.frag"};
+    VKShader shader{CURRENT_FILE_DIR"/vert.vert", CURRENT_FILE_DIR"/frag.frag", "#define VERTEX_COLOR\n"};
+    #if VERTEX_COMPACT
+    VKShader compactShader{CURRENT_FILE_DIR"/vert.vert", CURRENT_FILE_DIR"/frag.frag", VERTEX_COMPACT_COLOR ? "#define VERTEX_COLOR\n" : ""};
+    #endif
+    #if DEPTH_PREPASS
+    VKShader prepassShader{CURRENT_FILE_DIR"/vert.vert", CURRENT_FILE_DIR"/frag.frag", "#define DEPTH_ONLY\n"};
+    #endif
+    #if VERTEX_PULLING
+    VKShader pullingShader{CURRENT_FILE_DIR"/vert.vert", CURRENT_FILE_DIR"/frag.frag", "#define VERTEX_PULLING\n"};
+        #if DEPTH_PREPASS
+    VKShader pullingPrepassShader{CURRENT_FILE_DIR"/vert.vert", CURRENT_FILE_DIR"/frag.frag", "#define VERTEX_PULLING\n#define DEPTH_ONLY\n"};
+        #endif
+    #endif
+    #if IMPOSTORS
+    VKShader impostorShader{CURRENT_FILE_DIR"/impostor.vert", CURRENT_FILE_DIR"/impostor.frag"};
+    #endif
 
     VkExtent2D windowSize{800u, 600u};
     VkViewport viewport{0.0, 0.0, (float)windowSize.width, (float)windowSize.height, 0.0, 1.0};
@@ -80,14 +306,34 @@ private:
 
     std::vector<Vertex> vertexData;
     std::vector<uint32_t> vertexIndices;
+    uint32_t modelIndexCount = 0;
+    MeshView modelMesh; // what gets uploaded, points into the vectors here or into modelCacheFile
+    MappedFile modelCacheFile;
+
+    bool compactVertices = false; // CompactVertex instead of Vertex, known once the device is picked
+    std::vector<CompactVertex> compactVertexData;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    std::vector<uint16_t> shortIndices;
+    glm::vec4 positionScale{1.0f};
+    glm::vec4 positionOffset{0.0f};
+    glm::vec4 uvDequant{1.0f, 1.0f, 0.0f, 0.0f}; // xy scale, zw offset from unorm16 back to the model's uv range
 
     struct Uniform{
         alignas(4) float padding;
         alignas(16) glm::mat4 model;
         alignas(16) glm::mat4 view;
         alignas(16) glm::mat4 proj;
+        alignas(16) glm::vec4 uvTransform; // xy scale, zw offset from the vertex uvs to texture uvs, uvDequant
+        alignas(16) glm::vec4 positionScale; // xyz, from quantized positions back to model space
+        alignas(16) glm::vec4 positionOffset;
     };
 
+    glm::vec3 cameraPosition{2.0f, 2.0f, 2.0f};
+    float cameraFovY = glm::radians(45.0f);
+    glm::mat4 modelTransform = glm::identity<glm::mat4>();
+    glm::vec3 modelCenter{0.0f};
+    float modelRadius = 0.0f;
+
 public:
     void run(){
         // drawcall
@@ -112,8 +358,23 @@ public:
             // reset fence to signal
             VK_CHECK(vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]));
 
+            // this frame slot's draws have finished, so have its timestamps
+            readDrawTimestamps(currentFrame);
+
             // update uniform buffer
             updateUniformData(currentFrame);
+
+            // impostor or level of detail, then the ranges this frame draws
+            selectImpostor();
+            selectModelLod();
+            buildModelDraws(currentFrame);
+
+            // keep the textures drawn this frame at the back of the eviction order
+            textureCache.nextFrame();
+            textureCache.touch(modelTextureKey);
+
+            // finish, start and retire mip uploads, this frame's descriptor set is idle now
+            updateTextureStreaming(currentFrame);
             
             // record command buffer
             VK_CHECK(vkResetCommandBuffer(commandBuffers[currentFrame], 0));
@@ -121,6 +382,14 @@ public:
             // begin command buffer
             VkCommandBufferBeginInfo commandBufferBeginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
             VK_CHECK(vkBeginCommandBuffer(commandBuffers[currentFrame], &commandBufferBeginInfo));
+            if(timestampPool != VK_NULL_HANDLE)
+                vkCmdResetQueryPool(commandBuffers[currentFrame], timestampPool, currentFrame * 2, 2);
+
+        #if TEXTURE_DYNAMIC_DEMO
+            // copies the regions written since this frame's slot was last used, outside the render pass
+            updateDynamicTextureDemo();
+            recordDynamicTextureUpload(commandBuffers[currentFrame], dynamicTexture, currentFrame);
+        #endif
 
             // render pass begin info
             VkRenderPassBeginInfo renderPassBeginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
@@ -136,13 +405,16 @@ public:
 
             // do render pass
             vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
             vkCmdSetViewport(commandBuffers[currentFrame], 0, 1, &viewport);
             vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
-            vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, &vertexBuffer, &offsets);
-            vkCmdBindIndexBuffer(commandBuffers[currentFrame], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-            vkCmdBindDescriptorSets(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-            vkCmdDrawIndexed(commandBuffers[currentFrame], vertexIndices.size(), 1, 0, 0, 0);
+            if(timestampPool != VK_NULL_HANDLE)
+                vkCmdWriteTimestamp(commandBuffers[currentFrame], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, currentFrame * 2);
+            if(impostorVisible)
+                drawImpostor(commandBuffers[currentFrame], currentFrame);
+            else
+                recordModel(commandBuffers[currentFrame], descriptorSets[currentFrame], [&]{ drawModel(commandBuffers[currentFrame], currentFrame); });
+            if(timestampPool != VK_NULL_HANDLE)
+                vkCmdWriteTimestamp(commandBuffers[currentFrame], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, currentFrame * 2 + 1);
             vkCmdEndRenderPass(commandBuffers[currentFrame]);
 
             // end command buffer
@@ -197,6 +469,7 @@ public:
         // resize callback
         glfwSetWindowUserPointer(window, this);
         glfwSetWindowSizeCallback(window, resizeCallback);
+        glfwSetScrollCallback(window, scrollCallback);
 
         // instance
         createInstance();
@@ -245,6 +518,13 @@ public:
         // command pool
         createCommandPool();
 
+    #if MODEL_STREAMING
+        // load model, vertex buffer and vertex index in batches
+        streamModel();
+
+        // indirect draws of the model
+        createModelDraws();
+    #else
         // load model
         loadModel();
 
@@ -254,14 +534,28 @@ public:
         // vertex index
         allocateVertexIndex();
 
+        // buffer addresses for vertex pulling
+        setPullConstants();
+
+        // indirect draws of the submeshes or the visible meshlets
+        createModelDraws();
+
+        // the uploaded blobs may point into the mapped cache file
+        modelCacheFile.close();
+    #endif
+
         // uniform buffer
         allocateUniformBuffer();
 
-        // texture image
-        createTextureImage();
+        // material parameters, indexed by every draw's first instance
+        allocateMaterialBuffer();
 
-        // texture sampler
-        createTextureSampler();
+        // texture image and sampler, shared through the cache
+        modelTexture = textureCache.acquire(modelTextureKey);
+        textureCache.printStats(std::cout);
+    #if TEXTURE_DYNAMIC_DEMO
+        createDynamicTexture(256, 256, VK_FORMAT_R8G8B8A8_SRGB, dynamicTexture);
+    #endif
 
         // descriptor pool
         createDescriptorPool();
@@ -274,6 +568,12 @@ public:
 
         // synchronization
         createSyncObjects();
+
+        // draw timing
+        createTimestampPool();
+
+        // impostor atlas, baked with the pipelines and descriptor sets above
+        createImpostor();
     }
 
     ~App(){
@@ -291,6 +591,13 @@ private:
     VkSurfaceKHR surface;
 
     VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceMemoryProperties memoryProps;
+    bool directUpload = false; // device local memory is host visible (UMA, ReBAR), skip staging
+    bool unifiedMemory = false; // integrated and every device local heap is host visible, linear textures are sampled in place
+    bool hostImageCopy = false; // VK_EXT_host_image_copy, copy textures from host memory without command buffers
+    VkImageLayout hostImageCopyLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    PFN_vkCopyMemoryToImageEXT vkCopyMemoryToImage = nullptr;
+    PFN_vkTransitionImageLayoutEXT vkTransitionImageLayout = nullptr;
     std::vector<uint32_t> queueFamilyIndices{UINT32_MAX, UINT32_MAX, UINT32_MAX}; // [0]: graphics, [1]: present, [2]: transfer
     
     std::vector<VkDeviceQueueCreateInfo> queueInfo;
@@ -308,12 +615,14 @@ private:
     VkRenderPassCreateInfo renderPassInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
     VkRenderPass renderPass;
     
+    ThreadPool threadPool;
+
     VkShaderModuleCreateInfo vsShaderModuleInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
     VkShaderModuleCreateInfo fsShaderModuleInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
     VkShaderModule vsShaderModule;
     VkShaderModule fsShaderModule;
 
-    std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings{2};
+    std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings{3};
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
     VkDescriptorSetLayout descriptorSetLayout;
 
@@ -323,12 +632,14 @@ private:
     VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
     std::vector<VkDescriptorSet> descriptorSets{FRAMES_IN_FLIGHT};
 
-    std::vector<VkDescriptorPoolSize> descriptorPoolSizes{2};
+    std::vector<VkDescriptorPoolSize> descriptorPoolSizes{3};
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
     VkPipelineLayout pipelineLayout;
     
     VkGraphicsPipelineCreateInfo graphicsPipelineInfo = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
     VkPipeline graphicsPipeline;
+    VkShaderModule prepassShaderModule = VK_NULL_HANDLE;
+    VkPipeline prepassPipeline = VK_NULL_HANDLE;
 
     std::vector<VkFramebuffer> framebuffers;
     
@@ -344,10 +655,91 @@ private:
     std::vector<VkSemaphore> renderFinishedSemaphores{FRAMES_IN_FLIGHT};
     std::vector<VkFence> inFlightFences{FRAMES_IN_FLIGHT};
 
-    VkBuffer vertexBuffer;
+    VkBuffer vertexBuffer; // every attribute, or all but the position with split streams
     VkBuffer indexBuffer;
     VkDeviceMemory vertexMemory;
     VkDeviceMemory indexMemory;
+    bool splitStreams = false;
+    VkBuffer positionBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory positionMemory = VK_NULL_HANDLE;
+
+    // vertex pulling, matches the push constant block of vert.vert
+    struct PullConstants{
+        VkDeviceAddress vertices;
+        VkDeviceAddress indices;
+        uint32_t stride; // in 4 byte words
+        uint32_t flags;
+    };
+    enum PullFlags : uint32_t{
+        PULL_COMPACT = 1,
+        PULL_HALF_POSITION = 2,
+        PULL_COLOR = 4,
+        PULL_INDICES = 8,
+        PULL_SHORT_INDICES = 16
+    };
+    bool vertexPulling = false;
+    bool pullIndices = false;
+    PullConstants pullConstants = {};
+    PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddress = nullptr;
+
+    uint32_t modelLod = 0; // level of detail drawn, meshlet culling only applies to level 0
+
+    // materials, one per entry of modelMesh.materials, matches the Material struct of frag.frag
+    struct MaterialData{
+        alignas(16) glm::vec4 baseColor;
+        alignas(4) uint32_t flags;
+    };
+    VkBuffer materialBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory materialMemory = VK_NULL_HANDLE;
+
+    // every frame lists the index ranges it draws, each with its material as the first instance, and writes them to its
+    // own indirect buffer. Without drawIndirectFirstInstance they are recorded as direct draws instead
+    bool multiDrawIndirect = false;
+    bool indirectFirstInstance = false;
+    std::vector<std::vector<VkDrawIndexedIndirectCommand>> modelDraws{FRAMES_IN_FLIGHT};
+    std::vector<VkBuffer> indirectBuffer{FRAMES_IN_FLIGHT};
+    std::vector<VkDeviceMemory> indirectMemory{FRAMES_IN_FLIGHT};
+    std::vector<void*> indirectData{FRAMES_IN_FLIGHT};
+
+    // meshlet culling, the visible meshlets of level 0 replace its submeshes in the frame's draws
+    bool meshletCulling = false;
+    MeshletCullData meshletCullData;
+    std::vector<uint32_t> visibleMeshlets;
+    std::vector<uint32_t> meshletMaterials; // of the submesh each meshlet lies in
+    uint64_t visibleMeshletSum = 0; // over the frames the draw time is averaged for
+    uint32_t cullFrameCnt = 0;
+    glm::mat4 viewProjection = glm::identity<glm::mat4>();
+
+    // impostor, albedo and depth of the model seen from IMPOSTOR_FRAMES^2 directions, one atlas tile each
+    struct ImpostorConstants{ // matches the push constant block of impostor.vert and impostor.frag
+        glm::vec4 center; // xyz bounding sphere center in model space, w radius
+        glm::vec4 camera; // xyz camera in model space, w frames per atlas side
+    };
+    bool impostorReady = false;
+    bool impostorVisible = false;
+    VkImage impostorAlbedo = VK_NULL_HANDLE;
+    VkDeviceMemory impostorAlbedoMemory = VK_NULL_HANDLE;
+    VkImageView impostorAlbedoView = VK_NULL_HANDLE;
+    VkImage impostorDepth = VK_NULL_HANDLE;
+    VkDeviceMemory impostorDepthMemory = VK_NULL_HANDLE;
+    VkImageView impostorDepthView = VK_NULL_HANDLE;
+    VkSampler impostorSampler = VK_NULL_HANDLE;
+    VkSampler impostorDepthSampler = VK_NULL_HANDLE; // nearest, depth formats need not support filtering
+    VkDescriptorSetLayout impostorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool impostorDescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> impostorSets{FRAMES_IN_FLIGHT};
+    VkPipelineLayout impostorPipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule impostorVsModule = VK_NULL_HANDLE;
+    VkShaderModule impostorFsModule = VK_NULL_HANDLE;
+    VkPipeline impostorPipeline = VK_NULL_HANDLE;
+
+    // GPU time of the model draws, two timestamps per frame in flight
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    float timestampPeriod = 0.0f; // nanoseconds per tick
+    uint64_t timestampMask = 0;
+    std::vector<uint8_t> timestampsWritten = std::vector<uint8_t>(FRAMES_IN_FLIGHT, 0);
+    double drawTimeSum = 0.0;
+    uint32_t drawTimeCnt = 0;
 
     std::vector<VkBuffer> uniformBuffer{FRAMES_IN_FLIGHT};
     std::vector<VkDeviceMemory> uniformMemory{FRAMES_IN_FLIGHT};
@@ -356,7 +748,67 @@ private:
     VkImage image;
     VkDeviceMemory imageMemory;
     VkImageView imageView;
-    VkSampler sampler;
+    VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    VkExtent2D textureExtent = {0, 0};
+    uint32_t mipLevels = 1;
+    uint32_t textureBaseLevel = 0;
+
+    TextureCache textureCache{{
+        [this](const TextureKey& key){ return createCachedTexture(key); },
+        [this](const TextureKey& key, Texture& texture){ destroyTexture(key, texture); },
+        [this](const TextureKey& key, Texture& texture, uint32_t dropCount){ return dropTextureMips(key, texture, dropCount); }
+    }, TEXTURE_BUDGET};
+    TextureKey modelTextureKey{ASSET_SOURCE_DIR"/viking/viking_room.png"};
+    const Texture* modelTexture = nullptr;
+
+    // every level of a streamed texture stays in system memory, at most one upload per texture is in flight
+    struct StreamedTexture{
+        std::vector<uint8_t> data;
+        std::vector<MipLevel> levels;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t requestedLevel = 0; // finest level the last frame asked for
+
+        uint32_t baseLevel = 0; // of the image being filled
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        std::chrono::high_resolution_clock::time_point start;
+    };
+    std::unordered_map<TextureKey, StreamedTexture, TextureKeyHash> streamedTextures;
+
+    // images replaced by a stream, destroyed once no frame in flight can sample them
+    struct RetiredTexture{
+        VkImage image;
+        VkDeviceMemory memory;
+        VkImageView view;
+        uint64_t frame;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE; // the copy out of the image, when it was not waited for
+    };
+    std::vector<RetiredTexture> retiredTextures;
+    std::vector<bool> textureDescriptorsDirty = std::vector<bool>(FRAMES_IN_FLIGHT, false);
+    uint64_t frameIndex = 0;
+
+    // content rewritten from the cpu while frames are in flight, every frame in flight owns a staging slice and an image,
+    // so updates only touch resources whose last use the frame fence has already waited for
+    struct DynamicTexture{
+        uint32_t width = 0;
+        uint32_t height = 0;
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB; // 4 bytes per texel
+        std::vector<uint8_t> pixels; // latest content, the slots catch up from here
+        VkBuffer stagingBuffer = VK_NULL_HANDLE; // one slice of width * height texels per frame in flight, mapped while alive
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+        uint8_t* staging = nullptr;
+        std::vector<VkImage> images{FRAMES_IN_FLIGHT};
+        std::vector<VkDeviceMemory> memories{FRAMES_IN_FLIGHT};
+        std::vector<VkImageView> views{FRAMES_IN_FLIGHT};
+        VkSampler sampler = VK_NULL_HANDLE;
+        std::vector<std::vector<VkRect2D>> pendingRegions{FRAMES_IN_FLIGHT}; // written since each slot was last uploaded
+    };
+    DynamicTexture dynamicTexture;
 
     VkImage depthImage;
     VkDeviceMemory depthMemory;
@@ -368,7 +820,7 @@ private:
         appInfo.pEngineName = "No Engine";
         appInfo.pApplicationName = "VKModel";
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_1;
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
         // fill instance info
         uint32_t extensionCnt = 0;
@@ -425,6 +877,63 @@ private:
             if(((queueFamilyProps[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamilyProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) && queueFamilyIndices[2] == UINT32_MAX)
                 queueFamilyIndices[2] = i;
         }
+
+        // check whether the whole device local heap is host visible
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProps);
+        VkDeviceSize deviceLocalHeapSize = 0, hostVisibleHeapSize = 0;
+        VkMemoryPropertyFlags directProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        for(uint32_t i = 0; i < memoryProps.memoryTypeCount; ++i){
+            VkDeviceSize heapSize = memoryProps.memoryHeaps[memoryProps.memoryTypes[i].heapIndex].size;
+            if(memoryProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+                deviceLocalHeapSize = std::max(deviceLocalHeapSize, heapSize);
+            if((memoryProps.memoryTypes[i].propertyFlags & directProps) == directProps)
+                hostVisibleHeapSize = std::max(hostVisibleHeapSize, heapSize);
+        }
+        // a small BAR window (256MB on discrete cards without ReBAR) keeps the staging path
+        directUpload = hostVisibleHeapSize > 0 && hostVisibleHeapSize >= deviceLocalHeapSize;
+
+        // ReBAR maps a discrete card's VRAM as well, but linear tiling samples far slower than optimal there, so only
+        // UMA keeps its textures linear
+        unifiedMemory = prop[deviceIndex].deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
+            prop[deviceIndex].deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+        for(uint32_t heap = 0; unifiedMemory && heap < memoryProps.memoryHeapCount; ++heap){
+            if(!(memoryProps.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+                continue;
+            bool hostVisible = false;
+            for(uint32_t i = 0; i < memoryProps.memoryTypeCount; ++i)
+                hostVisible = hostVisible || (memoryProps.memoryTypes[i].heapIndex == heap && (memoryProps.memoryTypes[i].propertyFlags & directProps) == directProps);
+            unifiedMemory = hostVisible;
+        }
+        std::cout << "Upload path: " << (directUpload ? "direct (device local | host visible)" : "staging")
+            << (unifiedMemory ? ", linear textures" : ", optimal textures") << std::endl;
+
+        // leave the other half of device local memory to buffers and attachments on small VRAM parts
+        textureCache.setBudget(std::min<VkDeviceSize>(TEXTURE_BUDGET, deviceLocalHeapSize / 2));
+
+    #if VERTEX_PULLING && !MODEL_STREAMING
+        vertexPulling = queryBufferDeviceAddress();
+        pullIndices = vertexPulling && VERTEX_PULLING_INDICES;
+    #endif
+        std::cout << "Vertex pulling: " << (vertexPulling ? (pullIndices ? "vertices and indices" : "vertices") : "off") << std::endl;
+
+    #if VERTEX_COMPACT && !MODEL_STREAMING
+        // every compact format has to be usable as a vertex attribute unless the shader decodes it, otherwise keep float vertices
+        compactVertices = true;
+        for(const auto& desc : CompactVertexInput::attributes){
+            if(vertexPulling)
+                break;
+            VkFormatProperties formatProps;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, desc.format, &formatProps);
+            if(!(formatProps.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT))
+                compactVertices = false;
+        }
+    #endif
+        // the streaming path uploads interleaved batches as they are parsed
+        splitStreams = VERTEX_SPLIT_STREAMS && !MODEL_STREAMING && !vertexPulling;
+        std::cout << "Vertex format: " << (compactVertices ? "compact, " : "float, ") << vertexStride() << " bytes";
+        if(splitStreams)
+            std::cout << ", " << positionStride() << " of them in the position stream";
+        std::cout << std::endl;
     }
 
     void createLogicalDevice(){
@@ -442,15 +951,125 @@ private:
         
         // fill logical device info
         static VkPhysicalDeviceFeatures deviceFeatures = {};
-        static const std::vector<const char *> deviceExtensions = {
+        static std::vector<const char *> deviceExtensions = {
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
         };
+
+        // block compressed textures
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
+        // all of a frame's ranges in one indirect draw, each reading its material through the first instance
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        indirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
+        // host image copy
+        static VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT};
+    #if TEXTURE_HOST_IMAGE_COPY
+        hostImageCopy = queryHostImageCopy();
+    #endif
+        if(hostImageCopy){
+            deviceExtensions.push_back(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+            deviceExtensions.push_back(VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME);
+            deviceExtensions.push_back(VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME);
+            hostImageCopyFeatures.hostImageCopy = VK_TRUE;
+            logicalDeviceInfo.pNext = &hostImageCopyFeatures;
+        }
+
+        // buffer device address for vertex pulling
+        static VkPhysicalDeviceBufferDeviceAddressFeaturesKHR bufferDeviceAddressFeatures = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR};
+        if(vertexPulling){
+            deviceExtensions.push_back(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+            bufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
+            bufferDeviceAddressFeatures.pNext = const_cast<void*>(logicalDeviceInfo.pNext);
+            logicalDeviceInfo.pNext = &bufferDeviceAddressFeatures;
+        }
         logicalDeviceInfo.queueCreateInfoCount = queueInfo.size();
         logicalDeviceInfo.pQueueCreateInfos = queueInfo.data();
         logicalDeviceInfo.enabledExtensionCount = deviceExtensions.size();
         logicalDeviceInfo.ppEnabledExtensionNames = deviceExtensions.data();
         logicalDeviceInfo.pEnabledFeatures = &deviceFeatures;
         VK_CHECK(vkCreateDevice(physicalDevice, &logicalDeviceInfo, nullptr, &logicalDevice));
+
+        if(hostImageCopy){
+            vkCopyMemoryToImage = reinterpret_cast<PFN_vkCopyMemoryToImageEXT>(vkGetDeviceProcAddr(logicalDevice, "vkCopyMemoryToImageEXT"));
+            vkTransitionImageLayout = reinterpret_cast<PFN_vkTransitionImageLayoutEXT>(vkGetDeviceProcAddr(logicalDevice, "vkTransitionImageLayoutEXT"));
+            hostImageCopy = vkCopyMemoryToImage != nullptr && vkTransitionImageLayout != nullptr;
+        }
+        std::cout << "Host image copy: " << (hostImageCopy ? "enabled" : "unavailable") << std::endl;
+
+        if(vertexPulling){
+            vkGetBufferDeviceAddress = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetBufferDeviceAddressKHR"));
+            VK_EXPECT_TRUE((vkGetBufferDeviceAddress != nullptr), "Failed to load vkGetBufferDeviceAddressKHR.");
+        }
+    }
+
+    std::set<std::string> getDeviceExtensionNames(){
+        uint32_t extensionCnt = 0;
+        VK_CHECK(vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCnt, nullptr));
+        std::vector<VkExtensionProperties> extensions(extensionCnt);
+        VK_CHECK(vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCnt, extensions.data()));
+        std::set<std::string> extensionNames;
+        for(const auto& extension : extensions)
+            extensionNames.insert(extension.extensionName);
+        return extensionNames;
+    }
+
+    bool queryBufferDeviceAddress(){
+        // features2 queries need a vulkan 1.1 device
+        VkPhysicalDeviceProperties deviceProps;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+        if(deviceProps.apiVersion < VK_API_VERSION_1_1 || !getDeviceExtensionNames().count(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME))
+            return false;
+
+        VkPhysicalDeviceBufferDeviceAddressFeaturesKHR bufferDeviceAddressFeatures = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR};
+        VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        features.pNext = &bufferDeviceAddressFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        return bufferDeviceAddressFeatures.bufferDeviceAddress == VK_TRUE;
+    }
+
+    bool queryHostImageCopy(){
+        // features2 and properties2 queries need a vulkan 1.1 device
+        VkPhysicalDeviceProperties deviceProps;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+        if(deviceProps.apiVersion < VK_API_VERSION_1_1)
+            return false;
+
+        // check extension and its dependencies
+        std::set<std::string> extensionNames = getDeviceExtensionNames();
+        if(!extensionNames.count(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME) || !extensionNames.count(VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME) ||
+            !extensionNames.count(VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME))
+            return false;
+
+        // check feature
+        VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT};
+        VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        features.pNext = &hostImageCopyFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        if(!hostImageCopyFeatures.hostImageCopy)
+            return false;
+
+        // pick a layout that both the host copy and the fragment shader accept
+        VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProps = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT};
+        VkPhysicalDeviceProperties2 props = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+        props.pNext = &hostImageCopyProps;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+        // only memory to image copies are done, the source layouts are left as a count
+        std::vector<VkImageLayout> copyDstLayouts(hostImageCopyProps.copyDstLayoutCount);
+        hostImageCopyProps.pCopyDstLayouts = copyDstLayouts.data();
+        vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+        for(auto layout : {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL}){
+            if(std::find(copyDstLayouts.begin(), copyDstLayouts.end(), layout) != copyDstLayouts.end()){
+                hostImageCopyLayout = layout;
+                return true;
+            }
+        }
+        return false;
     }
 
     void createSwapchain(){
@@ -508,23 +1127,30 @@ private:
     }
 
     void createRenderPass(){
+        createRenderPass(swapchainInfo.imageFormat, false, renderPass);
+    }
+
+    // one color and one depth attachment. An offscreen pass keeps both in their attachment layouts and stores depth too,
+    // it differs from the window's pass only in what render passes may differ in, so the window's pipelines draw in it
+    // as long as the color format is the same
+    void createRenderPass(VkFormat colorFormat, bool offscreen, VkRenderPass& pass){
         // attachment description
         static std::vector<VkAttachmentDescription> attachmentDescs{2};
-        attachmentDescs[0].format = swapchainInfo.imageFormat;
+        attachmentDescs[0].format = colorFormat;
         attachmentDescs[0].samples = VK_SAMPLE_COUNT_1_BIT;
         attachmentDescs[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         attachmentDescs[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         attachmentDescs[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         attachmentDescs[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        attachmentDescs[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        attachmentDescs[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        attachmentDescs[0].initialLayout = offscreen ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        attachmentDescs[0].finalLayout = offscreen ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
         attachmentDescs[1].format = VK_FORMAT_D32_SFLOAT;
         attachmentDescs[1].samples = VK_SAMPLE_COUNT_1_BIT;
         attachmentDescs[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        attachmentDescs[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachmentDescs[1].storeOp = offscreen ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         attachmentDescs[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         attachmentDescs[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        attachmentDescs[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachmentDescs[1].initialLayout = offscreen ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         attachmentDescs[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         // attachment reference
@@ -557,17 +1183,37 @@ private:
         renderPassInfo.pAttachments = attachmentDescs.data();
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &subpassDependency;
-        VK_CHECK(vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &renderPass));
+        VK_CHECK(vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &pass));
     }
 
     void createShaderModule(){
         // fill shader module info
-        vsShaderModuleInfo.codeSize = shader.vs_size;
-        vsShaderModuleInfo.pCode = shader.vs_spirv.data();
-        fsShaderModuleInfo.codeSize = shader.fs_size;
-        fsShaderModuleInfo.pCode = shader.fs_spirv.data();
+        const VKShader* vertexShader = &shader;
+    #if VERTEX_COMPACT
+        if(compactVertices)
+            vertexShader = &compactShader;
+    #endif
+    #if VERTEX_PULLING
+        if(vertexPulling)
+            vertexShader = &pullingShader;
+    #endif
+        vsShaderModuleInfo.codeSize = vertexShader->vs_size;
+        vsShaderModuleInfo.pCode = vertexShader->vs_spirv.data();
+        fsShaderModuleInfo.codeSize = vertexShader->fs_size;
+        fsShaderModuleInfo.pCode = vertexShader->fs_spirv.data();
         VK_CHECK(vkCreateShaderModule(logicalDevice, &vsShaderModuleInfo, nullptr, &vsShaderModule));
         VK_CHECK(vkCreateShaderModule(logicalDevice, &fsShaderModuleInfo, nullptr, &fsShaderModule));
+    #if DEPTH_PREPASS
+        const VKShader* depthShader = &prepassShader;
+        #if VERTEX_PULLING
+        if(vertexPulling)
+            depthShader = &pullingPrepassShader;
+        #endif
+        VkShaderModuleCreateInfo prepassShaderModuleInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        prepassShaderModuleInfo.codeSize = depthShader->vs_size;
+        prepassShaderModuleInfo.pCode = depthShader->vs_spirv.data();
+        VK_CHECK(vkCreateShaderModule(logicalDevice, &prepassShaderModuleInfo, nullptr, &prepassShaderModule));
+    #endif
     }
 
     void createDescriptorSetLayout(){
@@ -580,6 +1226,10 @@ private:
         descriptorSetLayoutBindings[1].descriptorCount = 1;
         descriptorSetLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         descriptorSetLayoutBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        descriptorSetLayoutBindings[2].binding = 2;
+        descriptorSetLayoutBindings[2].descriptorCount = 1;
+        descriptorSetLayoutBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorSetLayoutBindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
         // create descriptor set layout
         descriptorSetLayoutInfo.bindingCount = descriptorSetLayoutBindings.size();
@@ -591,6 +1241,11 @@ private:
         // fill pipeline layout info
         pipelineLayoutInfo.setLayoutCount = 1;
         pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        static VkPushConstantRange pullConstantRange = {VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PullConstants)};
+        if(vertexPulling){
+            pipelineLayoutInfo.pushConstantRangeCount = 1;
+            pipelineLayoutInfo.pPushConstantRanges = &pullConstantRange;
+        }
         VK_CHECK(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
     }
 
@@ -608,13 +1263,7 @@ private:
         pipelineShaderStageInfo[1].pName = "main";
 
         // pipeline vertex input stage info
-        static VkPipelineVertexInputStateCreateInfo pipelineVertexInputStageInfo = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-        static auto vertexBindingDesc = Vertex::getVertexInputBindingDesc();
-        static auto vertexAttribDesc = Vertex::getVertexInputAttribDesc();
-        pipelineVertexInputStageInfo.vertexBindingDescriptionCount = vertexBindingDesc.size();
-        pipelineVertexInputStageInfo.vertexAttributeDescriptionCount = vertexAttribDesc.size();
-        pipelineVertexInputStageInfo.pVertexBindingDescriptions = vertexBindingDesc.data();
-        pipelineVertexInputStageInfo.pVertexAttributeDescriptions = vertexAttribDesc.data();
+        static VkPipelineVertexInputStateCreateInfo pipelineVertexInputStageInfo = vertexInputState();
 
         // pipeline input assembly state info
         static VkPipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateInfo = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
@@ -670,8 +1319,14 @@ private:
         // pipeline depth stencil state info
         static VkPipelineDepthStencilStateCreateInfo pipelineDepthStencilStateInfo = {VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
         pipelineDepthStencilStateInfo.depthTestEnable = VK_TRUE;
+    #if DEPTH_PREPASS
+        // depth is already final, only the nearest fragment of every pixel passes
+        pipelineDepthStencilStateInfo.depthWriteEnable = VK_FALSE;
+        pipelineDepthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    #else
         pipelineDepthStencilStateInfo.depthWriteEnable = VK_TRUE;
         pipelineDepthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+    #endif
         pipelineDepthStencilStateInfo.depthBoundsTestEnable = VK_FALSE;
         pipelineDepthStencilStateInfo.stencilTestEnable = VK_FALSE;
 
@@ -690,6 +1345,35 @@ private:
         graphicsPipelineInfo.pDepthStencilState = &pipelineDepthStencilStateInfo;
         graphicsPipelineInfo.layout = pipelineLayout;
         VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &graphicsPipeline));
+
+    #if DEPTH_PREPASS
+        // depth prepass, no fragment shader and no color writes, same state otherwise
+        static VkPipelineShaderStageCreateInfo prepassShaderStageInfo = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
+        prepassShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        prepassShaderStageInfo.module = prepassShaderModule;
+        prepassShaderStageInfo.pName = "main";
+        static VkPipelineVertexInputStateCreateInfo prepassVertexInputStageInfo = positionInputState();
+        static VkPipelineColorBlendAttachmentState prepassColorBlendAttachmentState = {};
+        static VkPipelineColorBlendStateCreateInfo prepassColorBlendStateInfo = {VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+        prepassColorBlendStateInfo.attachmentCount = 1;
+        prepassColorBlendStateInfo.pAttachments = &prepassColorBlendAttachmentState;
+        static VkPipelineDepthStencilStateCreateInfo prepassDepthStencilStateInfo = {VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+        prepassDepthStencilStateInfo.depthTestEnable = VK_TRUE;
+        prepassDepthStencilStateInfo.depthWriteEnable = VK_TRUE;
+        prepassDepthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+
+        VkGraphicsPipelineCreateInfo prepassPipelineInfo = graphicsPipelineInfo;
+        prepassPipelineInfo.stageCount = 1;
+        prepassPipelineInfo.pStages = &prepassShaderStageInfo;
+        prepassPipelineInfo.pVertexInputState = &prepassVertexInputStageInfo;
+        prepassPipelineInfo.pColorBlendState = &prepassColorBlendStateInfo;
+        prepassPipelineInfo.pDepthStencilState = &prepassDepthStencilStateInfo;
+        VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &prepassPipelineInfo, nullptr, &prepassPipeline));
+    #endif
+
+        // rebuilt against the new render pass once the impostor exists
+        if(impostorPipelineLayout != VK_NULL_HANDLE)
+            createImpostorPipeline();
     }
 
     void createFramebuffer(){
@@ -721,141 +1405,1333 @@ private:
     }
     
     void loadModel(){
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
-
-        if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, ASSET_SOURCE_DIR"/viking/viking_room.obj")){
-            throw std::runtime_error(warn + err);
+        const char* modelPath = ASSET_SOURCE_DIR"/viking/viking_room.obj";
+        auto parseStart = std::chrono::high_resolution_clock::now();
+
+    #if MODEL_CACHE
+        // a cache written from the same OBJ skips parsing and deduplication, its blobs go to the upload as they are
+        std::string modelStem = std::string(modelPath).substr(0, std::string(modelPath).find_last_of('.'));
+        std::string cachePath = modelStem + ".mesh";
+        uint64_t sourceHash = 0;
+        bool hashed = hashFile(modelPath, sourceHash);
+        // so is the material library in the usual place next to it, and import options that change the buffers
+        uint64_t materialHash = 0;
+        hashFile((modelStem + ".mtl").c_str(), materialHash);
+        uint64_t cacheKey[] = {sourceHash, materialHash, MODEL_OPTIMIZE, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, MODEL_LOD_COUNT,
+            uint64_t(MODEL_LOD_MAX_ERROR * 1e6f)};
+        sourceHash = hashBytes(cacheKey, sizeof(cacheKey));
+        if(hashed && loadMeshCache(cachePath, sourceHash, getMeshAttributes(), vertexStride(), modelCacheFile, modelMesh)){
+            modelIndexCount = modelMesh.lods.empty() ? uint32_t(modelMesh.indexCount) : modelMesh.lods[0].indexCount;
+            indexType = modelMesh.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+            modelCenter = glm::vec3(modelMesh.bounds.center[0], modelMesh.bounds.center[1], modelMesh.bounds.center[2]);
+            modelRadius = modelMesh.bounds.radius;
+            setDequantization(modelMesh.bounds);
+            auto cacheEnd = std::chrono::high_resolution_clock::now();
+            std::cout << "Model load: cache " << std::chrono::duration<float, std::chrono::milliseconds::period>(cacheEnd - parseStart).count()
+                << " ms, " << modelMesh.vertexCount << " vertices, " << modelMesh.indexCount << " indices";
+            if(modelMesh.encoding != 0){
+                uint64_t rawBytes = modelMesh.vertexCount * modelMesh.vertexStride + modelMesh.indexCount * modelMesh.indexSize;
+                std::cout << ", encoded " << (modelMesh.vertexBytes + modelMesh.indexBytes) / 1024 << " KB ("
+                    << double(rawBytes) / double(modelMesh.vertexBytes + modelMesh.indexBytes) << "x)";
+            }
+            std::cout << std::endl;
+            return;
         }
-
-        std::unordered_map<Vertex, uint32_t> uniqueVertices;
-        for(const auto &shape : shapes){
-            for(const auto &index : shape.mesh.indices){
-                Vertex vertex = {};
-
-                vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
-                };
-                vertex.texcoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1.0 - attrib.texcoords[2 * index.texcoord_index + 1]
-                };
-                vertex.col = {1.0f, 1.0f, 1.0f};
-
-                if(uniqueVertices.count(vertex) == 0){
-                    uniqueVertices[vertex] = vertexData.size();
-                    vertexData.push_back(vertex);
-                }
-                vertexIndices.push_back(uniqueVertices[vertex]);
+    #endif
+
+        ObjMesh mesh;
+        std::vector<tinyobj::material_t> objMaterials;
+    #if MODEL_FAST_OBJ
+        std::string objError;
+        if(loadObj(modelPath, mesh, threadPool, objError)){
+            loadMaterialLibraries(modelPath, mesh.materialLibraries, objMaterials);
+        }
+        else{
+            std::cout << "Fast OBJ parser: " << objError << ", falling back to tinyobj" << std::endl;
+            loadObjTinyobj(modelPath, mesh, objMaterials);
+        }
+    #else
+        loadObjTinyobj(modelPath, mesh, objMaterials);
+    #endif
+        auto parseEnd = std::chrono::high_resolution_clock::now();
+
+        // one vertex per corner first, sized up front and grouped by material, the triangles of each in file order.
+        // Every material used gets a submesh, shapes sharing one are drawn as one range
+        modelMesh.materials = resolveMaterials(mesh, objMaterials);
+        size_t cornerCnt = mesh.indices.size();
+        auto forEachMaterialRange = [&](const std::function<void(size_t first, size_t last, uint32_t material)>& func){
+            size_t first = 0;
+            uint32_t material = 0;
+            for(const auto& range : mesh.materialRanges){
+                func(first, range.firstCorner, material);
+                first = range.firstCorner;
+                material = uint32_t(range.material + 1);
             }
+            func(first, cornerCnt, material);
+        };
+        std::vector<size_t> materialCorners(modelMesh.materials.size() + 1, 0);
+        forEachMaterialRange([&](size_t first, size_t last, uint32_t material){
+            materialCorners[material + 1] += last - first;
+        });
+        for(size_t i = 1; i < materialCorners.size(); ++i)
+            materialCorners[i] += materialCorners[i - 1];
+        modelMesh.submeshes.clear();
+        for(uint32_t material = 0; material < modelMesh.materials.size(); ++material){
+            uint32_t indexCount = uint32_t(materialCorners[material + 1] - materialCorners[material]);
+            if(indexCount != 0)
+                modelMesh.submeshes.push_back({uint32_t(materialCorners[material]), indexCount, material});
+        }
+        vertexData.resize(cornerCnt);
+        forEachMaterialRange([&](size_t first, size_t last, uint32_t material){
+            for(size_t i = first; i < last; ++i)
+                vertexData[materialCorners[material]++] = objVertex(mesh, mesh.indices[i]);
+        });
+        std::cout << "Model materials: " << modelMesh.submeshes.size() << " used of " << modelMesh.materials.size() << ", "
+            << objMaterials.size() << " defined in " << mesh.materialLibraries.size() << " libraries" << std::endl;
+        mesh = ObjMesh();
+
+        // then collapse identical corners in place, indices keep first occurrence order
+        vertexIndices.resize(cornerCnt);
+    #if VERTEX_DEDUP_PARALLEL
+        size_t uniqueCnt = dedupVerticesParallel(vertexData.data(), cornerCnt, sizeof(Vertex), vertexData.data(), vertexIndices.data(), threadPool);
+    #else
+        size_t uniqueCnt = dedupVertices(vertexData.data(), cornerCnt, sizeof(Vertex), vertexData.data(), vertexIndices.data());
+    #endif
+        vertexData.resize(uniqueCnt);
+        vertexData.shrink_to_fit();
+        modelIndexCount = vertexIndices.size();
+        auto dedupEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "Model load: parse " << std::chrono::duration<float, std::chrono::milliseconds::period>(parseEnd - parseStart).count()
+            << " ms, dedup " << std::chrono::duration<float, std::chrono::milliseconds::period>(dedupEnd - parseEnd).count() << " ms, "
+            << uniqueCnt << " unique of " << cornerCnt << " vertices" << std::endl;
+    #if MODEL_OPTIMIZE
+        optimizeModel();
+    #endif
+
+        // bounding sphere, texture streaming picks mip levels from its size on screen. No vertices, zero bounds
+        Vertex first = vertexData.empty() ? Vertex{} : vertexData[0];
+        glm::vec3 minPos = first.pos, maxPos = first.pos;
+        glm::vec2 minUv = first.texcoord, maxUv = first.texcoord;
+        for(const auto& vertex : vertexData){
+            minPos = glm::min(minPos, vertex.pos);
+            maxPos = glm::max(maxPos, vertex.pos);
+            minUv = glm::min(minUv, vertex.texcoord);
+            maxUv = glm::max(maxUv, vertex.texcoord);
+        }
+        modelCenter = (minPos + maxPos) * 0.5f;
+        modelRadius = 0.0f;
+        for(const auto& vertex : vertexData)
+            modelRadius = std::max(modelRadius, glm::length(vertex.pos - modelCenter));
+
+        modelMesh.attributes = getMeshAttributes();
+        modelMesh.vertexStride = vertexStride();
+        modelMesh.bounds = {{minPos.x, minPos.y, minPos.z}, {maxPos.x, maxPos.y, maxPos.z}, {modelCenter.x, modelCenter.y, modelCenter.z}, modelRadius,
+            {minUv.x, minUv.y}, {maxUv.x, maxUv.y}};
+        setDequantization(modelMesh.bounds);
+        buildModelLods();
+        packModel();
+
+        // clusters of the full model's triangle order, each one culled on its own every frame. Built per submesh, so a
+        // meshlet is drawn with one material. An empty model has none
+        modelMesh.meshlets.clear();
+        for(uint32_t i = 0; i < modelMesh.lods[0].submeshCount && !vertexData.empty(); ++i){
+            const Submesh& submesh = modelMesh.submeshes[modelMesh.lods[0].firstSubmesh + i];
+            std::vector<Meshlet> meshlets = buildMeshlets(vertexIndices.data() + submesh.firstIndex, submesh.indexCount,
+                reinterpret_cast<const float*>(vertexData.data()), vertexData.size(), sizeof(Vertex), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+            for(auto& meshlet : meshlets)
+                meshlet.firstIndex += submesh.firstIndex;
+            modelMesh.meshlets.insert(modelMesh.meshlets.end(), meshlets.begin(), meshlets.end());
         }
+        std::cout << "Model meshlets: " << modelMesh.meshlets.size() << ", " << float(modelIndexCount / 3) / modelMesh.meshlets.size()
+            << " triangles each" << std::endl;
+
+    #if MODEL_CACHE
+        if(hashed && !writeMeshCache(cachePath, sourceHash, modelMesh, MODEL_CACHE_COMPRESS))
+            std::cout << "Model load: failed to write " << cachePath << std::endl;
+    #endif
     }
 
-    void allocateVertexBuffer(){
-        VkDeviceSize size = sizeof(vertexData[0]) * vertexData.size();
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingMemory;
-        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), stagingBuffer, stagingMemory);
-        
-        // map memory
-        void* data;
-        vkMapMemory(logicalDevice, stagingMemory, offsets, size, 0, &data);
-        memcpy(data, vertexData.data(), size);
-        vkUnmapMemory(logicalDevice, stagingMemory);
-        
-        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VkMemoryPropertyFlagBits(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), vertexBuffer, vertexMemory);
-        
-        copyBuffer(stagingBuffer, vertexBuffer, size);
+    // triangles in Tipsify order for the post-transform cache, clusters of them sorted against overdraw, then vertices
+    // renumbered in first use order so fetches walk the vertex buffer forward. Triangles only move within their
+    // submesh, the submeshes are sorted on the pool
+    void optimizeModel(){
+        if(vertexData.empty())
+            return;
+        auto optimizeStart = std::chrono::high_resolution_clock::now();
+        VertexCacheStats before = analyzeVertexCache(vertexIndices.data(), vertexIndices.size(), vertexData.size());
+
+        std::vector<uint32_t> cacheOrder(vertexIndices.size());
+        threadPool.parallelFor(modelMesh.submeshes.size(), 1, [&](size_t first, size_t last){
+            for(size_t i = first; i < last; ++i){
+                const Submesh& submesh = modelMesh.submeshes[i];
+                uint32_t* indices = vertexIndices.data() + submesh.firstIndex;
+                uint32_t* ordered = cacheOrder.data() + submesh.firstIndex;
+                optimizeVertexCache(ordered, indices, submesh.indexCount, vertexData.size());
+                optimizeOverdraw(indices, ordered, submesh.indexCount, reinterpret_cast<const float*>(vertexData.data()), vertexData.size(), sizeof(Vertex));
+            }
+        });
 
-        // clean
-        vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-        vkFreeMemory(logicalDevice, stagingMemory, nullptr);
+        std::vector<Vertex> fetchOrder(vertexData.size());
+        size_t usedCnt = optimizeVertexFetch(fetchOrder.data(), vertexIndices.data(), vertexIndices.size(), vertexData.data(), vertexData.size(), sizeof(Vertex));
+        fetchOrder.resize(usedCnt);
+        vertexData.swap(fetchOrder);
+
+        VertexCacheStats after = analyzeVertexCache(vertexIndices.data(), vertexIndices.size(), vertexData.size());
+        auto optimizeEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "Model optimize: " << std::chrono::duration<float, std::chrono::milliseconds::period>(optimizeEnd - optimizeStart).count()
+            << " ms, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
     }
 
-    void allocateVertexIndex(){
-        VkDeviceSize size = sizeof(vertexIndices[0]) * vertexIndices.size();
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingMemory;
-        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), stagingBuffer, stagingMemory);
-        
-        // map memory
-        void* data;
-        vkMapMemory(logicalDevice, stagingMemory, offsets, size, 0, &data);
-        memcpy(data, vertexIndices.data(), size);
-        vkUnmapMemory(logicalDevice, stagingMemory);
-        
-        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VkMemoryPropertyFlagBits(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), indexBuffer, indexMemory);
-        
-        copyBuffer(stagingBuffer, indexBuffer, size);
+    // coarser index ranges behind the full model in the same index buffer. Each level is simplified from the one before,
+    // so its error is the sum of the errors on the way there. Submeshes are simplified on their own, on the pool, so no
+    // triangle changes material, and the edges between them are open borders that stay where they are
+    void buildModelLods(){
+        uint32_t submeshCnt = uint32_t(modelMesh.submeshes.size());
+        modelMesh.lods = {{0, modelIndexCount, 0.0f, 0, submeshCnt}};
+        if(vertexData.empty())
+            return;
+        auto lodStart = std::chrono::high_resolution_clock::now();
+        std::vector<std::vector<uint32_t>> lods(submeshCnt);
+        std::vector<float> errors(submeshCnt, 0.0f);
+        for(uint32_t i = 0; i < submeshCnt; ++i){
+            const Submesh& submesh = modelMesh.submeshes[i];
+            lods[i].assign(vertexIndices.begin() + submesh.firstIndex, vertexIndices.begin() + submesh.firstIndex + submesh.indexCount);
+        }
+        size_t lodIndexCnt = modelIndexCount;
+        for(uint32_t level = 1; level < MODEL_LOD_COUNT; ++level){
+            std::vector<std::vector<uint32_t>> simplified(submeshCnt);
+            std::vector<float> simplifiedErrors(submeshCnt);
+            threadPool.parallelFor(submeshCnt, 1, [&](size_t first, size_t last){
+                for(size_t i = first; i < last; ++i){
+                    float submeshError = 0.0f;
+                    simplified[i].resize(lods[i].size());
+                    simplified[i].resize(simplifyMesh(simplified[i].data(), lods[i].data(), lods[i].size(), reinterpret_cast<const float*>(vertexData.data()),
+                        vertexData.size(), sizeof(Vertex), lods[i].size() / 6 * 3, modelRadius * MODEL_LOD_MAX_ERROR, &submeshError));
+                #if MODEL_OPTIMIZE
+                    std::vector<uint32_t> cacheOrder(simplified[i].size());
+                    optimizeVertexCache(cacheOrder.data(), simplified[i].data(), cacheOrder.size(), vertexData.size());
+                    simplified[i].swap(cacheOrder);
+                #endif
+                    simplifiedErrors[i] = errors[i] + submeshError;
+                }
+            });
+            size_t indexCnt = 0;
+            for(const auto& indices : simplified)
+                indexCnt += indices.size();
+            // locked borders and seams can stall it, a level that saves little is not worth switching to
+            if(indexCnt == 0 || indexCnt > lodIndexCnt * 9 / 10)
+                break;
 
-        // clean
-        vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-        vkFreeMemory(logicalDevice, stagingMemory, nullptr);
+            // a level's error is its worst submesh's
+            MeshLod lod = {uint32_t(vertexIndices.size()), uint32_t(indexCnt), 0.0f, uint32_t(modelMesh.submeshes.size()), submeshCnt};
+            for(uint32_t i = 0; i < submeshCnt; ++i){
+                lod.error = std::max(lod.error, simplifiedErrors[i]);
+                modelMesh.submeshes.push_back({uint32_t(vertexIndices.size()), uint32_t(simplified[i].size()), modelMesh.submeshes[i].material});
+                vertexIndices.insert(vertexIndices.end(), simplified[i].begin(), simplified[i].end());
+            }
+            modelMesh.lods.push_back(lod);
+            lods.swap(simplified);
+            errors.swap(simplifiedErrors);
+            lodIndexCnt = indexCnt;
+        }
+
+        auto lodEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "Model LODs: " << std::chrono::duration<float, std::chrono::milliseconds::period>(lodEnd - lodStart).count() << " ms";
+        for(const auto& level : modelMesh.lods)
+            std::cout << ", " << level.indexCount / 3 << " triangles (error " << level.error << ")";
+        std::cout << std::endl;
     }
 
-    void allocateUniformBuffer(){
-        VkDeviceSize size = sizeof(Uniform);
+    // interleaved, as the model is built and cached
+    VkPipelineVertexInputStateCreateInfo interleavedInputState(){
+        return compactVertices ? CompactVertexInput::inputState() : VertexInput::inputState();
+    }
 
-        for(auto i = 0; i < FRAMES_IN_FLIGHT; ++i){
-            createBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VkMemoryPropertyFlagBits(
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
-                uniformBuffer[i], uniformMemory[i]);
+    // as the color pass reads it
+    VkPipelineVertexInputStateCreateInfo vertexInputState(){
+        if(vertexPulling)
+            return {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+        if(splitStreams)
+            return compactVertices ? SplitCompactVertexInput::inputState() : SplitVertexInput::inputState();
+        return interleavedInputState();
+    }
 
-            vkMapMemory(logicalDevice, uniformMemory[i], offsets, size, 0, &uniformData[i]);
+    // as the depth prepass reads it
+    VkPipelineVertexInputStateCreateInfo positionInputState(){
+        if(vertexPulling)
+            return {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+        if(splitStreams)
+            return compactVertices ? PositionInput<CompactVertexPosition>::inputState() : PositionInput<VertexPosition>::inputState();
+        return compactVertices ? PositionInput<CompactVertex>::inputState() : PositionInput<Vertex>::inputState();
+    }
+
+    uint32_t positionStride(){
+        return compactVertices ? sizeof(CompactVertexPosition) : sizeof(VertexPosition);
+    }
+
+    std::vector<MeshAttribute> getMeshAttributes(){
+        std::vector<MeshAttribute> attributes;
+        VkPipelineVertexInputStateCreateInfo inputState = interleavedInputState();
+        for(uint32_t i = 0; i < inputState.vertexAttributeDescriptionCount; ++i){
+            const VkVertexInputAttributeDescription& desc = inputState.pVertexAttributeDescriptions[i];
+            attributes.push_back({desc.location, uint32_t(desc.format), desc.offset});
         }
+        return attributes;
     }
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlagBits props, VkBuffer& buffer, VkDeviceMemory& memory){
-        VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-        bufferInfo.usage = usage;
-        bufferInfo.size = size;
-        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-        std::vector<uint32_t> indices = {queueFamilyIndices[0], queueFamilyIndices[2]};
-        bufferInfo.queueFamilyIndexCount = 2;
-        bufferInfo.pQueueFamilyIndices = indices.data();
-        
-        // create vertex buffer
-        VK_CHECK(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer));
+    uint32_t vertexStride(){
+        return compactVertices ? CompactVertexInput::bindings[0].stride : VertexInput::bindings[0].stride;
+    }
 
-        // get memory properties
-        VkPhysicalDeviceMemoryProperties memoryProps;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProps);
+    // quantization boxes from the bounds, a flat axis keeps scale 1 so it does not divide by zero
+    void setDequantization(const MeshBounds& bounds){
+        if(!compactVertices)
+            return;
+        for(int i = 0; i < 3; ++i){
+            float halfExtent = (bounds.max[i] - bounds.min[i]) * 0.5f;
+            positionScale[i] = halfExtent > 0.0f ? halfExtent : 1.0f;
+            positionOffset[i] = (bounds.max[i] + bounds.min[i]) * 0.5f;
+        }
+        for(int i = 0; i < 2; ++i){
+            float range = bounds.uvMax[i] - bounds.uvMin[i];
+            uvDequant[i] = range > 0.0f ? range : 1.0f;
+            uvDequant[i + 2] = bounds.uvMin[i];
+        }
+    }
 
-        // get memory requirements
-        VkMemoryRequirements memoryRequirements;
-        vkGetBufferMemoryRequirements(logicalDevice, buffer, &memoryRequirements);
-        
-        // get memory type index
-        uint32_t memoryTypeIndex = 0;
-        for(auto i = 0; i < memoryProps.memoryTypeCount; ++i){
-            if((memoryRequirements.memoryTypeBits & (1 << i)) && (memoryProps.memoryTypes[i].propertyFlags & props) == props){
-                memoryTypeIndex = i;
-                break;
+    // vertexData into CompactVertex and indices into 16 bits where enabled, modelMesh points at whatever is uploaded
+    void packModel(){
+        modelMesh.vertices = vertexData.data();
+        modelMesh.vertexCount = vertexData.size();
+        if(compactVertices){
+            compactVertexData.resize(vertexData.size());
+            for(size_t i = 0; i < vertexData.size(); ++i){
+                const Vertex& vertex = vertexData[i];
+                CompactVertex& compact = compactVertexData[i];
+                for(int k = 0; k < 3; ++k){
+                    float normalized = (vertex.pos[k] - positionOffset[k]) / positionScale[k];
+                #if VERTEX_COMPACT_HALF_POSITION
+                    compact.pos[k] = quantizeHalf(normalized);
+                #else
+                    compact.pos[k] = quantizeSnorm16(normalized);
+                #endif
+                }
+            #if VERTEX_COMPACT_HALF_POSITION
+                compact.pos[3] = quantizeHalf(1.0f);
+            #else
+                compact.pos[3] = quantizeSnorm16(1.0f);
+            #endif
+                for(int k = 0; k < 2; ++k)
+                    compact.texcoord[k] = quantizeUnorm16((vertex.texcoord[k] - uvDequant[k + 2]) / uvDequant[k]);
+            #if VERTEX_COMPACT_COLOR
+                for(int k = 0; k < 3; ++k)
+                    compact.col[k] = quantizeUnorm8(vertex.col[k]);
+                compact.col[3] = 255;
+            #endif
             }
-        }    
+            modelMesh.vertices = compactVertexData.data();
+        }
 
-        // fill memory allocate info
-        VkMemoryAllocateInfo memoryAllocateInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        memoryAllocateInfo.allocationSize = memoryRequirements.size;
-        memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+        modelMesh.indexSize = sizeof(uint32_t);
+        modelMesh.indices = vertexIndices.data();
+        modelMesh.indexCount = vertexIndices.size();
+        indexType = VK_INDEX_TYPE_UINT32;
+    #if INDEX_16BIT
+        if(vertexData.size() <= UINT16_MAX){
+            shortIndices.assign(vertexIndices.begin(), vertexIndices.end());
+            modelMesh.indexSize = sizeof(uint16_t);
+            modelMesh.indices = shortIndices.data();
+            indexType = VK_INDEX_TYPE_UINT16;
+        }
+    #endif
+        std::cout << "Model pack: " << modelMesh.vertexCount * modelMesh.vertexStride / 1024 << " KB vertices, "
+            << modelMesh.indexCount * modelMesh.indexSize / 1024 << " KB indices, was " << vertexData.size() * sizeof(Vertex) / 1024
+            << " KB and " << vertexIndices.size() * sizeof(uint32_t) / 1024 << " KB" << std::endl;
+    }
 
-        // allocate memory
-        VK_CHECK(vkAllocateMemory(logicalDevice, &memoryAllocateInfo, nullptr, &memory));
+    static Vertex objVertex(const ObjMesh& mesh, const ObjIndex& index){
+        Vertex vertex = {};
 
-        // bind vertex buffer
-        VK_CHECK(vkBindBufferMemory(logicalDevice, buffer, memory, offsets));
+        vertex.pos = {
+            mesh.positions[3 * index.position + 0],
+            mesh.positions[3 * index.position + 1],
+            mesh.positions[3 * index.position + 2]
+        };
+        vertex.texcoord = {0.0f, 1.0f};
+        if(index.texcoord >= 0){
+            vertex.texcoord = {
+                mesh.texcoords[2 * index.texcoord + 0],
+                1.0f - mesh.texcoords[2 * index.texcoord + 1]
+            };
+        }
+        vertex.col = {1.0f, 1.0f, 1.0f};
+        return vertex;
     }
 
-    void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size){
-        // begin
+    // loadModel, allocateVertexBuffer and allocateVertexIndex without holding the model in memory. ObjStream reads
+    // the file once, a block at a time, spilling attributes to temporary files and handing back only the ones the
+    // block's faces use. Each block is expanded and deduplicated a batch of corners at a time straight into a staging
+    // slot and copied behind the previous batch into device buffers that grow as needed. Duplicates are only found
+    // within a batch, so a few vertices on batch seams are stored twice
+    void streamModel(){
+        const char* modelPath = ASSET_SOURCE_DIR"/viking/viking_room.obj";
+        auto streamStart = std::chrono::high_resolution_clock::now();
+
+        ObjStream stream(threadPool);
+        std::string error;
+        if(!stream.open(modelPath, error))
+            throw std::runtime_error(error);
+
+        // the model size is only known once it is read, the device buffers start at a few batches, double when a
+        // batch does not fit and are compacted to what was written at the end
+        VkBufferUsageFlags vertexUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        VkBufferUsageFlags indexUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+        size_t vertexCapacity = size_t(MODEL_STREAM_BATCH) * 4, indexCapacity = size_t(MODEL_STREAM_BATCH) * 4;
+        createBuffer(vertexCapacity * sizeof(Vertex), vertexUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexMemory);
+        createBuffer(indexCapacity * sizeof(uint32_t), indexUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexMemory);
+
+        // two staging slots, a batch is deduplicated into one while the other one copies
+        const uint32_t slotCnt = 2;
+        const VkDeviceSize slotSize = MODEL_STREAM_BATCH * (sizeof(Vertex) + sizeof(uint32_t));
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingMemory;
+        createBuffer(slotSize * slotCnt, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), stagingBuffer, stagingMemory);
+        void* stagingData;
+        VK_CHECK(vkMapMemory(logicalDevice, stagingMemory, 0, slotSize * slotCnt, 0, &stagingData));
+
+        VkCommandBufferAllocateInfo slotCommandBufferInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        slotCommandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        slotCommandBufferInfo.commandPool = commandPools[1];
+        slotCommandBufferInfo.commandBufferCount = slotCnt;
+        VkCommandBuffer slotCommandBuffers[slotCnt];
+        VK_CHECK(vkAllocateCommandBuffers(logicalDevice, &slotCommandBufferInfo, slotCommandBuffers));
+        VkFence slotFences[slotCnt];
+        for(uint32_t i = 0; i < slotCnt; ++i)
+            VK_CHECK(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &slotFences[i]));
+
+        std::vector<Vertex> corners(MODEL_STREAM_BATCH);
+        size_t vertexCnt = 0, indexCnt = 0, batchCnt = 0, blockBytes = 0, growCnt = 0;
+        glm::vec3 minPos(0.0f), maxPos(0.0f);
+        while(!stream.done()){
+            if(!stream.read(error))
+                throw std::runtime_error(error);
+
+            // the block only holds the attributes its triangles use, so the bounds grow a block at a time
+            const ObjMesh& mesh = stream.mesh();
+            blockBytes = std::max(blockBytes, (mesh.positions.size() + mesh.texcoords.size()) * sizeof(float) + mesh.indices.size() * sizeof(ObjIndex));
+            for(size_t i = 0; i < mesh.positions.size(); i += 3){
+                glm::vec3 position(mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2]);
+                bool seed = indexCnt == 0 && i == 0;
+                minPos = seed ? position : glm::min(minPos, position);
+                maxPos = seed ? position : glm::max(maxPos, position);
+            }
+
+            for(size_t first = 0; first < mesh.indices.size(); first += MODEL_STREAM_BATCH){
+                size_t count = std::min(size_t(MODEL_STREAM_BATCH), mesh.indices.size() - first);
+                VK_EXPECT_TRUE((indexCnt + count <= UINT32_MAX), "Model has too many triangles to index.");
+                for(size_t i = 0; i < count; ++i)
+                    corners[i] = objVertex(mesh, mesh.indices[first + i]);
+
+                // the fence is reset right before the submit, growing below may wait on every slot
+                uint32_t slot = batchCnt % slotCnt;
+                VK_CHECK(vkWaitForFences(logicalDevice, 1, &slotFences[slot], VK_TRUE, UINT64_MAX));
+
+                // unique vertices at the front of the slot, indices behind them rebased to the whole buffer
+                uint8_t* slotData = static_cast<uint8_t*>(stagingData) + slot * slotSize;
+                Vertex* slotVertices = reinterpret_cast<Vertex*>(slotData);
+                uint32_t* slotIndices = reinterpret_cast<uint32_t*>(slotData + MODEL_STREAM_BATCH * sizeof(Vertex));
+            #if VERTEX_DEDUP_PARALLEL
+                size_t uniqueCnt = dedupVerticesParallel(corners.data(), count, sizeof(Vertex), slotVertices, slotIndices, threadPool);
+            #else
+                size_t uniqueCnt = dedupVertices(corners.data(), count, sizeof(Vertex), slotVertices, slotIndices);
+            #endif
+                for(size_t i = 0; i < count; ++i)
+                    slotIndices[i] += uint32_t(vertexCnt);
+
+                if(vertexCnt + uniqueCnt > vertexCapacity || indexCnt + count > indexCapacity){
+                    // the batches still copying write into the old buffers
+                    VK_CHECK(vkWaitForFences(logicalDevice, slotCnt, slotFences, VK_TRUE, UINT64_MAX));
+                    if(vertexCnt + uniqueCnt > vertexCapacity){
+                        vertexCapacity = std::max(vertexCapacity * 2, vertexCnt + uniqueCnt);
+                        resizeBuffer(vertexBuffer, vertexMemory, vertexCnt * sizeof(Vertex), vertexCapacity * sizeof(Vertex), vertexUsage);
+                    }
+                    if(indexCnt + count > indexCapacity){
+                        indexCapacity = std::max(indexCapacity * 2, indexCnt + count);
+                        resizeBuffer(indexBuffer, indexMemory, indexCnt * sizeof(uint32_t), indexCapacity * sizeof(uint32_t), indexUsage);
+                    }
+                    ++growCnt;
+                }
+                VK_CHECK(vkResetFences(logicalDevice, 1, &slotFences[slot]));
+
+                VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                VK_CHECK(vkBeginCommandBuffer(slotCommandBuffers[slot], &beginInfo));
+                VkBufferCopy vertexCopy = {slot * slotSize, vertexCnt * sizeof(Vertex), uniqueCnt * sizeof(Vertex)};
+                vkCmdCopyBuffer(slotCommandBuffers[slot], stagingBuffer, vertexBuffer, 1, &vertexCopy);
+                VkBufferCopy indexCopy = {slot * slotSize + MODEL_STREAM_BATCH * sizeof(Vertex), indexCnt * sizeof(uint32_t), count * sizeof(uint32_t)};
+                vkCmdCopyBuffer(slotCommandBuffers[slot], stagingBuffer, indexBuffer, 1, &indexCopy);
+                VK_CHECK(vkEndCommandBuffer(slotCommandBuffers[slot]));
+
+                VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+                submitInfo.commandBufferCount = 1;
+                submitInfo.pCommandBuffers = &slotCommandBuffers[slot];
+                VK_CHECK(vkQueueSubmit(queues[2], 1, &submitInfo, slotFences[slot]));
+
+                vertexCnt += uniqueCnt;
+                indexCnt += count;
+                ++batchCnt;
+            }
+        }
+        VK_CHECK(vkWaitForFences(logicalDevice, slotCnt, slotFences, VK_TRUE, UINT64_MAX));
+        VK_EXPECT_TRUE((indexCnt > 0), "Model has no triangles.");
+
+        // compact to what was written
+        if(vertexCnt < vertexCapacity)
+            resizeBuffer(vertexBuffer, vertexMemory, vertexCnt * sizeof(Vertex), vertexCnt * sizeof(Vertex),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        if(indexCnt < indexCapacity)
+            resizeBuffer(indexBuffer, indexMemory, indexCnt * sizeof(uint32_t), indexCnt * sizeof(uint32_t),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        modelIndexCount = uint32_t(indexCnt);
+        // usemtl is not followed here, the whole model is one submesh with the default material
+        modelMesh.materials = {defaultMaterial()};
+        modelMesh.submeshes = {{0, modelIndexCount, 0}};
+
+        // texture streaming picks mip levels from the size on screen, the positions are gone by now so this is the
+        // sphere around the bounding box rather than the tightest one around the center
+        modelCenter = (minPos + maxPos) * 0.5f;
+        modelRadius = glm::length(maxPos - minPos) * 0.5f;
+
+        // clean
+        for(uint32_t i = 0; i < slotCnt; ++i)
+            vkDestroyFence(logicalDevice, slotFences[i], nullptr);
+        vkFreeCommandBuffers(logicalDevice, commandPools[1], slotCnt, slotCommandBuffers);
+        vkUnmapMemory(logicalDevice, stagingMemory);
+        vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+        vkFreeMemory(logicalDevice, stagingMemory, nullptr);
+
+        auto streamEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "Model stream: " << std::chrono::duration<float, std::chrono::milliseconds::period>(streamEnd - streamStart).count()
+            << " ms, " << batchCnt << " batches, " << vertexCnt << " vertices of " << indexCnt << " corners, " << growCnt
+            << " buffer grows, host memory " << (blockBytes >> 10) << " KB largest block + "
+            << ((corners.size() * sizeof(Vertex) + slotSize * slotCnt) >> 10) << " KB batches" << std::endl;
+    }
+
+    // moves the first usedSize bytes of buffer into a new one of size bytes, nothing may be writing to it
+    void resizeBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize usedSize, VkDeviceSize size, VkBufferUsageFlags usage){
+        VkBuffer resizedBuffer;
+        VkDeviceMemory resizedMemory;
+        createBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, resizedBuffer, resizedMemory);
+        if(usedSize > 0)
+            copyBuffer(buffer, resizedBuffer, usedSize);
+        vkDestroyBuffer(logicalDevice, buffer, nullptr);
+        vkFreeMemory(logicalDevice, memory, nullptr);
+        buffer = resizedBuffer;
+        memory = resizedMemory;
+    }
+
+    // the reference path, also taken for files the fast parser does not handle. Material names are tinyobj's material
+    // list, so every material id of a face is its index into materials
+    void loadObjTinyobj(const char* path, ObjMesh& mesh, std::vector<tinyobj::material_t>& materials){
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::string warn, err;
+
+        std::string directory = std::string(path).substr(0, std::string(path).find_last_of('/') + 1);
+        if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path, directory.c_str())){
+            throw std::runtime_error(warn + err);
+        }
+
+        mesh = ObjMesh();
+        mesh.positions = std::move(attrib.vertices);
+        mesh.texcoords = std::move(attrib.texcoords);
+        for(const auto& material : materials)
+            mesh.materialNames.push_back(material.name);
+        for(const auto &shape : shapes){
+            // triangulated, three indices per face
+            for(size_t face = 0; face < shape.mesh.material_ids.size(); ++face){
+                int32_t material = shape.mesh.material_ids[face];
+                if(mesh.materialRanges.empty() ? material != -1 : mesh.materialRanges.back().material != material)
+                    mesh.materialRanges.push_back({mesh.indices.size(), material});
+                for(size_t k = 0; k < 3; ++k){
+                    const auto& index = shape.mesh.indices[face * 3 + k];
+                    mesh.indices.push_back({index.vertex_index, index.texcoord_index});
+                }
+            }
+        }
+    }
+
+    // the libraries the fast parser found mtllib lines for, next to the OBJ. A missing one leaves its materials at the default
+    void loadMaterialLibraries(const char* path, const std::vector<std::string>& libraries, std::vector<tinyobj::material_t>& materials){
+        std::string directory = std::string(path).substr(0, std::string(path).find_last_of('/') + 1);
+        std::map<std::string, int> materialMap;
+        for(const auto& library : libraries){
+            std::ifstream file(directory + library);
+            if(!file.is_open()){
+                std::cout << "Model materials: cannot open " << directory + library << std::endl;
+                continue;
+            }
+            std::string warn, err;
+            tinyobj::LoadMtl(&materialMap, &materials, &file, &warn, &err);
+        }
+    }
+
+    // white and textured, how the model was shaded before it had materials
+    static MeshMaterial defaultMaterial(){
+        return {{1.0f, 1.0f, 1.0f, 1.0f}, MESH_MATERIAL_TEXTURED};
+    }
+
+    // entry 0 is for triangles without a material, entry i + 1 for usemtl name i. A name no library defines gets the
+    // default. Every material samples the model's one texture when it names a diffuse map, whichever map it names
+    static std::vector<MeshMaterial> resolveMaterials(const ObjMesh& mesh, const std::vector<tinyobj::material_t>& objMaterials){
+        std::vector<MeshMaterial> materials(mesh.materialNames.size() + 1, defaultMaterial());
+        for(size_t i = 0; i < mesh.materialNames.size(); ++i){
+            auto objMaterial = std::find_if(objMaterials.begin(), objMaterials.end(), [&](const tinyobj::material_t& material){
+                return material.name == mesh.materialNames[i];
+            });
+            if(objMaterial == objMaterials.end())
+                continue;
+            materials[i + 1] = {{float(objMaterial->diffuse[0]), float(objMaterial->diffuse[1]), float(objMaterial->diffuse[2]),
+                float(objMaterial->dissolve)}, objMaterial->diffuse_texname.empty() ? 0u : MESH_MATERIAL_TEXTURED};
+        }
+        return materials;
+    }
+
+    // the cached blobs may be encoded, they decode straight into the mapped staging or device memory
+    void allocateVertexBuffer(){
+        VkDeviceSize size = modelMesh.vertexStride * modelMesh.vertexCount;
+        if(!splitStreams){
+            createDeviceBuffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | pulledBufferUsage(), vertexBuffer, vertexMemory, [&](void* dst){
+                VK_EXPECT_TRUE(readMeshVertices(modelMesh, dst), "Model cache vertices are corrupt.");
+            });
+            return;
+        }
+
+        // slice every interleaved vertex into the position stream and the attribute stream
+        size_t positionSize = positionStride(), attributeSize = modelMesh.vertexStride - positionSize;
+        std::vector<uint8_t> positions(positionSize * modelMesh.vertexCount), attributes(attributeSize * modelMesh.vertexCount);
+        std::vector<uint8_t> decoded;
+        const uint8_t* src = static_cast<const uint8_t*>(modelMesh.vertices);
+        if(modelMesh.encoding & MESH_ENCODING_VERTICES){
+            decoded.resize(size);
+            VK_EXPECT_TRUE(readMeshVertices(modelMesh, decoded.data()), "Model cache vertices are corrupt.");
+            src = decoded.data();
+        }
+        for(size_t i = 0; i < modelMesh.vertexCount; ++i, src += modelMesh.vertexStride){
+            memcpy(&positions[i * positionSize], src, positionSize);
+            memcpy(&attributes[i * attributeSize], src + positionSize, attributeSize);
+        }
+        createDeviceBuffer(positions.data(), positions.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, positionBuffer, positionMemory);
+        createDeviceBuffer(attributes.data(), attributes.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer, vertexMemory);
+    }
+
+    void allocateVertexIndex(){
+        VkDeviceSize size = modelMesh.indexSize * modelMesh.indexCount;
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | pulledBufferUsage();
+        // the shader reads whole words, pad the last 16-bit index
+        VkDeviceSize padding = pullIndices && size % 4 != 0 ? 2 : 0;
+        createDeviceBuffer(size + padding, usage, indexBuffer, indexMemory, [&](void* dst){
+            VK_EXPECT_TRUE(readMeshIndices(modelMesh, dst), "Model cache indices are corrupt.");
+            memset(static_cast<uint8_t*>(dst) + size, 0, padding);
+        });
+    }
+
+    VkBufferUsageFlags pulledBufferUsage(){
+        return vertexPulling ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR : 0;
+    }
+
+    void setPullConstants(){
+        if(!vertexPulling)
+            return;
+        VkBufferDeviceAddressInfoKHR addressInfo = {VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR};
+        addressInfo.buffer = vertexBuffer;
+        pullConstants.vertices = vkGetBufferDeviceAddress(logicalDevice, &addressInfo);
+        addressInfo.buffer = indexBuffer;
+        pullConstants.indices = vkGetBufferDeviceAddress(logicalDevice, &addressInfo);
+        pullConstants.stride = modelMesh.vertexStride / 4;
+        pullConstants.flags = 0;
+        if(compactVertices)
+            pullConstants.flags |= PULL_COMPACT | (VERTEX_COMPACT_HALF_POSITION ? uint32_t(PULL_HALF_POSITION) : 0u) |
+                (VERTEX_COMPACT_COLOR ? uint32_t(PULL_COLOR) : 0u);
+        if(pullIndices)
+            pullConstants.flags |= PULL_INDICES | (indexType == VK_INDEX_TYPE_UINT16 ? uint32_t(PULL_SHORT_INDICES) : 0u);
+    }
+
+    // binds what the model's pipelines read and records draw for the depth prepass, if there is one, and the color pass
+    void recordModel(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, const std::function<void()>& draw){
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        if(vertexPulling)
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PullConstants), &pullConstants);
+    #if DEPTH_PREPASS
+        // depth from positions alone, the color pass then shades only the fragments that end up visible
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, prepassPipeline);
+        if(!vertexPulling)
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, splitStreams ? &positionBuffer : &vertexBuffer, &offsets);
+        draw();
+    #endif
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        if(splitStreams){
+            VkBuffer streams[] = {positionBuffer, vertexBuffer};
+            VkDeviceSize streamOffsets[] = {0, 0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 2, streams, streamOffsets);
+        }
+        else if(!vertexPulling){
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offsets);
+        }
+        draw();
+    }
+
+    // every pass draws this frame's ranges, all in one indirect call, one indirect call per range when multiDrawIndirect
+    // is missing, or recorded one by one when indirect draws can not set the first instance
+    void drawModel(VkCommandBuffer commandBuffer, uint32_t currentFrame){
+        if(!indirectFirstInstance){
+            recordDraws(commandBuffer, modelDraws[currentFrame]);
+            return;
+        }
+        uint32_t drawCnt = uint32_t(modelDraws[currentFrame].size());
+        uint32_t callCnt = multiDrawIndirect ? std::min(drawCnt, 1u) : drawCnt, callDrawCnt = multiDrawIndirect ? drawCnt : 1;
+        uint32_t stride = pullIndices ? sizeof(VkDrawIndirectCommand) : sizeof(VkDrawIndexedIndirectCommand);
+        for(uint32_t i = 0; i < callCnt; ++i){
+            if(pullIndices)
+                vkCmdDrawIndirect(commandBuffer, indirectBuffer[currentFrame], i * stride, callDrawCnt, stride);
+            else
+                vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer[currentFrame], i * stride, callDrawCnt, stride);
+        }
+    }
+
+    // indexed unless the shader pulls the indices itself, a direct draw takes any first instance
+    void recordDraws(VkCommandBuffer commandBuffer, const std::vector<VkDrawIndexedIndirectCommand>& draws){
+        for(const auto& draw : draws){
+            if(pullIndices)
+                vkCmdDraw(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.firstInstance);
+            else
+                vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+        }
+    }
+
+    // one draw per submesh of the level, all of them when the model has no levels
+    void appendLevelDraws(uint32_t level, std::vector<VkDrawIndexedIndirectCommand>& draws){
+        uint32_t firstSubmesh = 0, submeshCnt = uint32_t(modelMesh.submeshes.size());
+        if(level < modelMesh.lods.size()){
+            firstSubmesh = modelMesh.lods[level].firstSubmesh;
+            submeshCnt = modelMesh.lods[level].submeshCount;
+        }
+        for(uint32_t i = firstSubmesh; i < firstSubmesh + submeshCnt; ++i){
+            const Submesh& submesh = modelMesh.submeshes[i];
+            if(submesh.indexCount != 0)
+                draws.push_back({submesh.indexCount, 1, submesh.firstIndex, 0, submesh.material});
+        }
+    }
+
+    void createModelDraws(){
+        size_t maxDrawCnt = modelMesh.submeshes.size();
+    #if MESHLET_CULLING
+        // meshlets never straddle the submeshes of level 0 and both are in index order
+        uint32_t submesh = modelMesh.lods.empty() ? 0 : modelMesh.lods[0].firstSubmesh;
+        uint32_t lastSubmesh = modelMesh.lods.empty() ? uint32_t(modelMesh.submeshes.size()) : submesh + modelMesh.lods[0].submeshCount;
+        if(!modelMesh.meshlets.empty() && submesh < lastSubmesh){
+            meshletCullData = prepareMeshletCulling(modelMesh.meshlets);
+            visibleMeshlets.resize(modelMesh.meshlets.size());
+            meshletMaterials.resize(modelMesh.meshlets.size());
+            for(size_t i = 0; i < modelMesh.meshlets.size(); ++i){
+                while(submesh + 1 < lastSubmesh &&
+                    modelMesh.submeshes[submesh].firstIndex + modelMesh.submeshes[submesh].indexCount <= modelMesh.meshlets[i].firstIndex)
+                    ++submesh;
+                meshletMaterials[i] = modelMesh.submeshes[submesh].material;
+            }
+            maxDrawCnt = std::max(maxDrawCnt, modelMesh.meshlets.size());
+            meshletCulling = true;
+            std::cout << "Meshlet culling: " << modelMesh.meshlets.size() << " meshlets, " << meshletCullIsa() << std::endl;
+        }
+    #endif
+        for(auto& draws : modelDraws)
+            draws.reserve(maxDrawCnt);
+
+        // room for every meshlet or every submesh as a draw of its own, in the larger of the two command layouts
+        if(indirectFirstInstance){
+            VkDeviceSize size = std::max<size_t>(maxDrawCnt, 1) * sizeof(VkDrawIndexedIndirectCommand);
+            for(uint32_t i = 0; i < FRAMES_IN_FLIGHT; ++i){
+                createBuffer(size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VkMemoryPropertyFlagBits(
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), indirectBuffer[i], indirectMemory[i]);
+                VK_CHECK(vkMapMemory(logicalDevice, indirectMemory[i], 0, size, 0, &indirectData[i]));
+            }
+        }
+        std::cout << "Model draws: " << modelMesh.materials.size() << " materials, "
+            << (!indirectFirstInstance ? "direct draws" : multiDrawIndirect ? "multi draw indirect" : "one indirect draw per range") << std::endl;
+    }
+
+    // the coarsest level whose error projects to at most MODEL_LOD_PIXEL_ERROR pixels at the model's nearest point. Going
+    // coarser needs the error clearly below the threshold and going finer clearly above, so a level holds near the boundary
+    void selectModelLod(){
+        if(modelMesh.lods.size() < 2)
+            return;
+        glm::vec3 center = glm::vec3(modelTransform * glm::vec4(modelCenter, 1.0f));
+        float distance = std::max(glm::length(cameraPosition - center) - modelRadius, 0.1f);
+        float pixelsPerUnit = swapchainInfo.imageExtent.height / (2.0f * std::tan(cameraFovY * 0.5f) * distance);
+        auto pixelError = [&](uint32_t level){
+            return modelMesh.lods[level].error * pixelsPerUnit;
+        };
+
+        uint32_t level = modelLod;
+        while(level > 0 && pixelError(level) > MODEL_LOD_PIXEL_ERROR * (1.0f + MODEL_LOD_HYSTERESIS))
+            --level;
+        while(level + 1 < modelMesh.lods.size() && pixelError(level + 1) < MODEL_LOD_PIXEL_ERROR * (1.0f - MODEL_LOD_HYSTERESIS))
+            ++level;
+    #if MODEL_SWITCH_LOG
+        if(level != modelLod)
+            std::cout << "Model LOD: " << level << ", " << modelMesh.lods[level].indexCount / 3 << " triangles" << std::endl;
+    #endif
+        modelLod = level;
+    }
+
+    // this frame's ranges: none under the impostor, the meshlets culling left of level 0, otherwise the level's
+    // submeshes. They go to the frame's indirect buffer in the layout the draw call reads
+    void buildModelDraws(uint32_t currentFrame){
+        std::vector<VkDrawIndexedIndirectCommand>& draws = modelDraws[currentFrame];
+        draws.clear();
+        if(impostorVisible)
+            return;
+        if(meshletCulling && modelLod == 0)
+            cullModel(draws);
+        else
+            appendLevelDraws(modelLod, draws);
+        if(!indirectFirstInstance)
+            return;
+        if(pullIndices){
+            VkDrawIndirectCommand* commands = static_cast<VkDrawIndirectCommand*>(indirectData[currentFrame]);
+            for(size_t i = 0; i < draws.size(); ++i)
+                commands[i] = {draws[i].indexCount, 1, draws[i].firstIndex, draws[i].firstInstance};
+        }
+        else{
+            memcpy(indirectData[currentFrame], draws.data(), draws.size() * sizeof(VkDrawIndexedIndirectCommand));
+        }
+    }
+
+    // frustum and cone tests in model space, the surviving meshlets are merged into ranges wherever they are adjacent
+    // and share a material
+    void cullModel(std::vector<VkDrawIndexedIndirectCommand>& draws){
+        glm::mat4 clipFromModel = viewProjection * modelTransform;
+        float planes[6][4];
+        extractFrustumPlanes(&clipFromModel[0][0], planes);
+        glm::vec3 camera = glm::vec3(glm::inverse(modelTransform) * glm::vec4(cameraPosition, 1.0f));
+        size_t visibleCnt = cullMeshlets(meshletCullData, planes, &camera.x, visibleMeshlets.data());
+
+        VkDrawIndexedIndirectCommand draw = {};
+        for(size_t i = 0; i < visibleCnt; ++i){
+            const Meshlet& meshlet = modelMesh.meshlets[visibleMeshlets[i]];
+            uint32_t material = meshletMaterials[visibleMeshlets[i]];
+            if(draw.indexCount != 0 && draw.firstIndex + draw.indexCount == meshlet.firstIndex && draw.firstInstance == material){
+                draw.indexCount += meshlet.indexCount;
+                continue;
+            }
+            if(draw.indexCount != 0)
+                draws.push_back(draw);
+            draw = {meshlet.indexCount, 1, meshlet.firstIndex, 0, material};
+        }
+        if(draw.indexCount != 0)
+            draws.push_back(draw);
+    #if DRAW_TIMING_FRAMES
+        visibleMeshletSum += visibleCnt;
+        ++cullFrameCnt;
+    #endif
+    }
+
+    // the direction frame (x, y) of the atlas looks from, toward the model's center. The frames sit on an even grid over
+    // the octahedron folded onto a square, the same mapping impostor.frag picks the frames around the view direction with
+    glm::vec3 impostorFrameDirection(uint32_t x, uint32_t y){
+        glm::vec2 f = glm::vec2(x, y) / float(IMPOSTOR_FRAMES - 1) * 2.0f - 1.0f;
+        glm::vec3 n(f.x, f.y, 1.0f - std::abs(f.x) - std::abs(f.y));
+        float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    // every frame is the model drawn by its own pipelines, orthographic over the bounding sphere, into one tile of an
+    // albedo and a depth atlas. The tiles are separate passes over one framebuffer, so the uniform buffer can be updated
+    // between them and frame 0's descriptor set, idle until the first frame, serves the bake
+    void createImpostor(){
+    #if IMPOSTORS && !TEXTURE_DYNAMIC_DEMO // the demo rewrites the texture every frame, a baked atlas would be stale
+        static_assert(IMPOSTOR_FRAMES >= 2, "Impostors need at least two frames per atlas side.");
+        VkFormat albedoFormat = swapchainInfo.imageFormat, depthFormat = VK_FORMAT_D32_SFLOAT;
+        VkFormatProperties formatProps;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, depthFormat, &formatProps);
+        if(!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)){
+            std::cout << "Impostor: depth attachments can not be sampled" << std::endl;
+            return;
+        }
+        auto bakeStart = std::chrono::high_resolution_clock::now();
+
+        // the tiles are far smaller than the screen, but a streamed texture holds only its tail at this point and the
+        // atlas keeps whatever it is baked with
+        makeModelTextureResident();
+
+        // atlas and the offscreen pass drawing into it
+        uint32_t atlasSize = IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE;
+        createImage2D(atlasSize, atlasSize, 1, albedoFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            impostorAlbedo, impostorAlbedoMemory);
+        createImageView(impostorAlbedo, albedoFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1, impostorAlbedoView);
+        createImage2D(atlasSize, atlasSize, 1, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            impostorDepth, impostorDepthMemory);
+        createImageView(impostorDepth, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1, impostorDepthView);
+
+        VkRenderPass bakePass;
+        createRenderPass(albedoFormat, true, bakePass);
+        std::vector<VkImageView> attachs = {impostorAlbedoView, impostorDepthView};
+        VkFramebufferCreateInfo framebufferInfo = {VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+        framebufferInfo.renderPass = bakePass;
+        framebufferInfo.attachmentCount = attachs.size();
+        framebufferInfo.pAttachments = attachs.data();
+        framebufferInfo.width = atlasSize;
+        framebufferInfo.height = atlasSize;
+        framebufferInfo.layers = 1;
+        VkFramebuffer bakeFramebuffer;
+        VK_CHECK(vkCreateFramebuffer(logicalDevice, &framebufferInfo, nullptr, &bakeFramebuffer));
+
+        // into attachment layouts once, every tile's pass leaves them there
+        VkCommandBuffer commandBuffer = beginOneTimeCommands(commandPools[0]);
+        std::vector<VkImageMemoryBarrier> imageMemoryBarriers(2, {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER});
+        imageMemoryBarriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageMemoryBarriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        imageMemoryBarriers[0].srcAccessMask = 0;
+        imageMemoryBarriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        imageMemoryBarriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarriers[0].image = impostorAlbedo;
+        imageMemoryBarriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        imageMemoryBarriers[1] = imageMemoryBarriers[0];
+        imageMemoryBarriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        imageMemoryBarriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        imageMemoryBarriers[1].image = impostorDepth;
+        imageMemoryBarriers[1].subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+            0, 0, nullptr, 0, nullptr, imageMemoryBarriers.size(), imageMemoryBarriers.data()
+        );
+
+        Uniform uniform = {};
+        uniform.model = glm::identity<glm::mat4>();
+        uniform.uvTransform = uvDequant;
+        uniform.positionScale = positionScale;
+        uniform.positionOffset = positionOffset;
+        uniform.proj = glm::ortho(-modelRadius, modelRadius, -modelRadius, modelRadius, modelRadius, 3.0f * modelRadius);
+        uniform.proj[1][1] *= -1;
+        std::vector<VkClearValue> clearValues{{{0.0f, 0.0f, 0.0f, 0.0f}}, {1.0f, 0.0f}};
+        std::vector<VkDrawIndexedIndirectCommand> bakeDraws; // the full model, one draw per material
+        appendLevelDraws(0, bakeDraws);
+        for(uint32_t y = 0; y < IMPOSTOR_FRAMES; ++y){
+            for(uint32_t x = 0; x < IMPOSTOR_FRAMES; ++x){
+                // right and up as impostor.vert and impostor.frag rebuild them
+                glm::vec3 direction = impostorFrameDirection(x, y);
+                glm::vec3 upHint = std::abs(direction.z) > 0.999f ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, 1);
+                uniform.view = glm::lookAt(modelCenter + direction * 2.0f * modelRadius, modelCenter, upHint);
+
+                // the previous tile is done reading the uniform buffer and writing its part of the attachments
+                if(x != 0 || y != 0){
+                    VkMemoryBarrier memoryBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                    memoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                    vkCmdPipelineBarrier(commandBuffer,
+                        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr
+                    );
+                }
+                vkCmdUpdateBuffer(commandBuffer, uniformBuffer[0], 0, sizeof(uniform), &uniform);
+                VkMemoryBarrier uniformBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                uniformBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                uniformBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                    0, 1, &uniformBarrier, 0, nullptr, 0, nullptr
+                );
+
+                // the pass clears and draws only its tile
+                VkRect2D tile = {{int32_t(x * IMPOSTOR_FRAME_SIZE), int32_t(y * IMPOSTOR_FRAME_SIZE)}, {IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE}};
+                VkViewport tileViewport = {float(tile.offset.x), float(tile.offset.y), float(IMPOSTOR_FRAME_SIZE), float(IMPOSTOR_FRAME_SIZE), 0.0f, 1.0f};
+                VkRenderPassBeginInfo renderPassBeginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+                renderPassBeginInfo.renderPass = bakePass;
+                renderPassBeginInfo.framebuffer = bakeFramebuffer;
+                renderPassBeginInfo.renderArea = tile;
+                renderPassBeginInfo.clearValueCount = clearValues.size();
+                renderPassBeginInfo.pClearValues = clearValues.data();
+                vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+                vkCmdSetViewport(commandBuffer, 0, 1, &tileViewport);
+                vkCmdSetScissor(commandBuffer, 0, 1, &tile);
+                recordModel(commandBuffer, descriptorSets[0], [&]{ recordDraws(commandBuffer, bakeDraws); });
+                vkCmdEndRenderPass(commandBuffer);
+            }
+        }
+
+        // sampled from here on
+        imageMemoryBarriers[0].oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        imageMemoryBarriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageMemoryBarriers[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        imageMemoryBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageMemoryBarriers[1].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        imageMemoryBarriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageMemoryBarriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        imageMemoryBarriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, imageMemoryBarriers.size(), imageMemoryBarriers.data()
+        );
+        endOneTimeCommands(commandBuffer, commandPools[0], queues[0]);
+        vkDestroyFramebuffer(logicalDevice, bakeFramebuffer, nullptr);
+        vkDestroyRenderPass(logicalDevice, bakePass, nullptr);
+
+        // albedo filtered, depth read as it was written
+        impostorSampler = createTextureSampler(TextureKey{});
+        TextureKey depthKey;
+        depthKey.filter = VK_FILTER_NEAREST;
+        impostorDepthSampler = createTextureSampler(depthKey);
+
+        createImpostorDescriptorSets();
+
+        // own layout and push constants, drawn in the window's render pass
+        VkShaderModuleCreateInfo shaderModuleInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        shaderModuleInfo.codeSize = impostorShader.vs_size;
+        shaderModuleInfo.pCode = impostorShader.vs_spirv.data();
+        VK_CHECK(vkCreateShaderModule(logicalDevice, &shaderModuleInfo, nullptr, &impostorVsModule));
+        shaderModuleInfo.codeSize = impostorShader.fs_size;
+        shaderModuleInfo.pCode = impostorShader.fs_spirv.data();
+        VK_CHECK(vkCreateShaderModule(logicalDevice, &shaderModuleInfo, nullptr, &impostorFsModule));
+        VkPushConstantRange impostorConstantRange = {VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ImpostorConstants)};
+        VkPipelineLayoutCreateInfo impostorPipelineLayoutInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+        impostorPipelineLayoutInfo.setLayoutCount = 1;
+        impostorPipelineLayoutInfo.pSetLayouts = &impostorSetLayout;
+        impostorPipelineLayoutInfo.pushConstantRangeCount = 1;
+        impostorPipelineLayoutInfo.pPushConstantRanges = &impostorConstantRange;
+        VK_CHECK(vkCreatePipelineLayout(logicalDevice, &impostorPipelineLayoutInfo, nullptr, &impostorPipelineLayout));
+        createImpostorPipeline();
+        impostorReady = true;
+
+        auto bakeEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "Impostor: " << IMPOSTOR_FRAMES << "x" << IMPOSTOR_FRAMES << " frames of " << IMPOSTOR_FRAME_SIZE << " texels, bake "
+            << std::chrono::duration<float, std::chrono::milliseconds::period>(bakeEnd - bakeStart).count() << " ms, drawn beyond "
+            << IMPOSTOR_DISTANCE * modelRadius << std::endl;
+    #endif
+    }
+
+    // every frame in flight reads its own uniform buffer next to the two atlases
+    void createImpostorDescriptorSets(){
+        std::vector<VkDescriptorSetLayoutBinding> bindings(3);
+        bindings[0] = {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
+        bindings[1] = {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
+        bindings[2] = {2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
+        VkDescriptorSetLayoutCreateInfo setLayoutInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+        setLayoutInfo.bindingCount = bindings.size();
+        setLayoutInfo.pBindings = bindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(logicalDevice, &setLayoutInfo, nullptr, &impostorSetLayout));
+
+        std::vector<VkDescriptorPoolSize> poolSizes = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, FRAMES_IN_FLIGHT},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * FRAMES_IN_FLIGHT}
+        };
+        VkDescriptorPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolInfo.poolSizeCount = poolSizes.size();
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = FRAMES_IN_FLIGHT;
+        VK_CHECK(vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &impostorDescriptorPool));
+
+        std::vector<VkDescriptorSetLayout> setLayouts(FRAMES_IN_FLIGHT, impostorSetLayout);
+        VkDescriptorSetAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        allocateInfo.descriptorPool = impostorDescriptorPool;
+        allocateInfo.descriptorSetCount = FRAMES_IN_FLIGHT;
+        allocateInfo.pSetLayouts = setLayouts.data();
+        VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &allocateInfo, impostorSets.data()));
+
+        for(auto i = 0; i < FRAMES_IN_FLIGHT; ++i){
+            VkDescriptorBufferInfo descriptorBufferInfo = {uniformBuffer[i], 0, sizeof(Uniform)};
+            VkDescriptorImageInfo descriptorImageInfos[] = {
+                {impostorSampler, impostorAlbedoView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+                {impostorDepthSampler, impostorDepthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}
+            };
+            std::vector<VkWriteDescriptorSet> writeDescriptorSets(3, {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET});
+            for(uint32_t binding = 0; binding < 3; ++binding){
+                writeDescriptorSets[binding].dstSet = impostorSets[i];
+                writeDescriptorSets[binding].dstBinding = binding;
+                writeDescriptorSets[binding].descriptorCount = 1;
+                writeDescriptorSets[binding].descriptorType = bindings[binding].descriptorType;
+            }
+            writeDescriptorSets[0].pBufferInfo = &descriptorBufferInfo;
+            writeDescriptorSets[1].pImageInfo = &descriptorImageInfos[0];
+            writeDescriptorSets[2].pImageInfo = &descriptorImageInfos[1];
+            vkUpdateDescriptorSets(logicalDevice, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, nullptr);
+        }
+    }
+
+    // the model pipeline's fixed state, with no vertex input, a strip of two triangles, no culling and a plain depth test
+    // even behind a depth prepass, the impostor is not part of it
+    void createImpostorPipeline(){
+        std::vector<VkPipelineShaderStageCreateInfo> stages(2, {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO});
+        stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stages[0].module = impostorVsModule;
+        stages[0].pName = "main";
+        stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stages[1].module = impostorFsModule;
+        stages[1].pName = "main";
+        VkPipelineVertexInputStateCreateInfo vertexInputState = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+        VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+        inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+        VkPipelineRasterizationStateCreateInfo rasterizationState = *graphicsPipelineInfo.pRasterizationState;
+        rasterizationState.cullMode = VK_CULL_MODE_NONE;
+        VkPipelineDepthStencilStateCreateInfo depthStencilState = {VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+        depthStencilState.depthTestEnable = VK_TRUE;
+        depthStencilState.depthWriteEnable = VK_TRUE;
+        depthStencilState.depthCompareOp = VK_COMPARE_OP_LESS;
+
+        VkGraphicsPipelineCreateInfo impostorPipelineInfo = graphicsPipelineInfo;
+        impostorPipelineInfo.stageCount = stages.size();
+        impostorPipelineInfo.pStages = stages.data();
+        impostorPipelineInfo.pVertexInputState = &vertexInputState;
+        impostorPipelineInfo.pInputAssemblyState = &inputAssemblyState;
+        impostorPipelineInfo.pRasterizationState = &rasterizationState;
+        impostorPipelineInfo.pDepthStencilState = &depthStencilState;
+        impostorPipelineInfo.layout = impostorPipelineLayout;
+        VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &impostorPipelineInfo, nullptr, &impostorPipeline));
+    }
+
+    // beyond IMPOSTOR_DISTANCE model radii from the camera to the model's center
+    void selectImpostor(){
+        if(!impostorReady)
+            return;
+        glm::vec3 center = glm::vec3(modelTransform * glm::vec4(modelCenter, 1.0f));
+        bool visible = glm::length(cameraPosition - center) > IMPOSTOR_DISTANCE * modelRadius;
+    #if MODEL_SWITCH_LOG
+        if(visible != impostorVisible)
+            std::cout << "Impostor: " << (visible ? "drawn instead of the model" : "model drawn again") << std::endl;
+    #endif
+        impostorVisible = visible;
+    }
+
+    void drawImpostor(VkCommandBuffer commandBuffer, uint32_t currentFrame){
+        ImpostorConstants constants;
+        constants.center = glm::vec4(modelCenter, modelRadius);
+        constants.camera = glm::vec4(glm::vec3(glm::inverse(modelTransform) * glm::vec4(cameraPosition, 1.0f)), float(IMPOSTOR_FRAMES));
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, impostorPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, impostorPipelineLayout, 0, 1, &impostorSets[currentFrame], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, impostorPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+            sizeof(ImpostorConstants), &constants);
+        vkCmdDraw(commandBuffer, 4, 1, 0, 0);
+    }
+
+    void destroyImpostor(){
+        vkDestroyPipelineLayout(logicalDevice, impostorPipelineLayout, nullptr);
+        vkDestroyShaderModule(logicalDevice, impostorVsModule, nullptr);
+        vkDestroyShaderModule(logicalDevice, impostorFsModule, nullptr);
+        vkDestroyDescriptorPool(logicalDevice, impostorDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(logicalDevice, impostorSetLayout, nullptr);
+        vkDestroySampler(logicalDevice, impostorSampler, nullptr);
+        vkDestroySampler(logicalDevice, impostorDepthSampler, nullptr);
+        vkDestroyImageView(logicalDevice, impostorAlbedoView, nullptr);
+        vkDestroyImage(logicalDevice, impostorAlbedo, nullptr);
+        vkFreeMemory(logicalDevice, impostorAlbedoMemory, nullptr);
+        vkDestroyImageView(logicalDevice, impostorDepthView, nullptr);
+        vkDestroyImage(logicalDevice, impostorDepth, nullptr);
+        vkFreeMemory(logicalDevice, impostorDepthMemory, nullptr);
+    }
+
+    void createTimestampPool(){
+    #if DRAW_TIMING_FRAMES
+        VkPhysicalDeviceProperties deviceProps;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+        uint32_t queueFamilyCnt = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCnt, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilyProps(queueFamilyCnt);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCnt, queueFamilyProps.data());
+        uint32_t validBits = queueFamilyProps[queueFamilyIndices[0]].timestampValidBits;
+        if(validBits == 0 || deviceProps.limits.timestampPeriod == 0.0f){
+            std::cout << "Draw timing: timestamps unsupported" << std::endl;
+            return;
+        }
+        timestampPeriod = deviceProps.limits.timestampPeriod;
+        timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+        VkQueryPoolCreateInfo queryPoolInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = FRAMES_IN_FLIGHT * 2;
+        VK_CHECK(vkCreateQueryPool(logicalDevice, &queryPoolInfo, nullptr, &timestampPool));
+    #endif
+    }
+
+    void readDrawTimestamps(uint32_t currentFrame){
+        if(timestampPool == VK_NULL_HANDLE)
+            return;
+        if(timestampsWritten[currentFrame]){
+            uint64_t ticks[2];
+            VkResult result = vkGetQueryPoolResults(logicalDevice, timestampPool, currentFrame * 2, 2, sizeof(ticks), ticks, sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT);
+            if(result == VK_SUCCESS){
+                drawTimeSum += double((ticks[1] - ticks[0]) & timestampMask) * timestampPeriod * 1e-6;
+                ++drawTimeCnt;
+            }
+        }
+        timestampsWritten[currentFrame] = 1; // recorded again this frame
+
+        if(drawTimeCnt == DRAW_TIMING_FRAMES){
+            std::cout << "Draw time: " << drawTimeSum / drawTimeCnt << " ms (" << (vertexPulling ? "vertex pulling" : "vertex input")
+                << (DEPTH_PREPASS ? ", depth prepass" : "") << ")";
+            if(meshletCulling && cullFrameCnt != 0){
+                std::cout << ", " << 100.0 * visibleMeshletSum / (double(cullFrameCnt) * modelMesh.meshlets.size()) << "% of meshlets drawn";
+                visibleMeshletSum = 0;
+                cullFrameCnt = 0;
+            }
+            std::cout << std::endl;
+            drawTimeSum = 0.0;
+            drawTimeCnt = 0;
+        }
+    }
+
+    void createDeviceBuffer(const void* src, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory){
+        createDeviceBuffer(size, usage, buffer, memory, [&](void* dst){
+            memcpy(dst, src, size);
+        });
+    }
+
+    // fill writes the size bytes of the buffer into mapped memory, so they can be produced in place instead of copied
+    void createDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory,
+        const std::function<void(void*)>& fill){
+        // write straight into the final buffer when device local memory is mappable
+        if(directUpload){
+            createBuffer(size, usage, VkMemoryPropertyFlagBits(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), buffer, memory);
+
+            void* data;
+            VK_CHECK(vkMapMemory(logicalDevice, memory, 0, size, 0, &data));
+            fill(data);
+            vkUnmapMemory(logicalDevice, memory);
+            return;
+        }
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingMemory;
+        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), stagingBuffer, stagingMemory);
+        
+        // map memory
+        void* data;
+        vkMapMemory(logicalDevice, stagingMemory, offsets, size, 0, &data);
+        fill(data);
+        vkUnmapMemory(logicalDevice, stagingMemory);
+        
+        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+            VkMemoryPropertyFlagBits(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), buffer, memory);
+        
+        copyBuffer(stagingBuffer, buffer, size);
+
+        // clean
+        vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+        vkFreeMemory(logicalDevice, stagingMemory, nullptr);
+    }
+
+    void allocateUniformBuffer(){
+        VkDeviceSize size = sizeof(Uniform);
+
+        for(auto i = 0; i < FRAMES_IN_FLIGHT; ++i){
+            // transfer dst for the impostor bake, which updates it between tiles
+            createBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VkMemoryPropertyFlagBits(
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+                uniformBuffer[i], uniformMemory[i]);
+
+            vkMapMemory(logicalDevice, uniformMemory[i], offsets, size, 0, &uniformData[i]);
+        }
+    }
+
+    // never written again, a cache without materials gets the default one
+    void allocateMaterialBuffer(){
+        if(modelMesh.materials.empty())
+            modelMesh.materials = {defaultMaterial()};
+        std::vector<MaterialData> materials(modelMesh.materials.size());
+        for(size_t i = 0; i < materials.size(); ++i){
+            const MeshMaterial& material = modelMesh.materials[i];
+            materials[i].baseColor = glm::vec4(material.baseColor[0], material.baseColor[1], material.baseColor[2], material.baseColor[3]);
+            materials[i].flags = material.flags;
+        }
+        createDeviceBuffer(materials.data(), materials.size() * sizeof(MaterialData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, materialBuffer, materialMemory);
+    }
+
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlagBits props, VkBuffer& buffer, VkDeviceMemory& memory){
+        VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        bufferInfo.usage = usage;
+        bufferInfo.size = size;
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        std::vector<uint32_t> indices = {queueFamilyIndices[0], queueFamilyIndices[2]};
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = indices.data();
+        
+        // create vertex buffer
+        VK_CHECK(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer));
+
+        // get memory requirements
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(logicalDevice, buffer, &memoryRequirements);
+        
+        // get memory type index
+        uint32_t memoryTypeIndex = 0;
+        VK_EXPECT_TRUE(findMemoryType(memoryRequirements.memoryTypeBits, props, memoryTypeIndex), "Failed to find buffer memory type.");
+
+        // fill memory allocate info
+        VkMemoryAllocateInfo memoryAllocateInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        memoryAllocateInfo.allocationSize = memoryRequirements.size;
+        memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+        // buffers the shader reads through an address need memory that has one
+        VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO};
+        memoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
+        if(usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR)
+            memoryAllocateInfo.pNext = &memoryAllocateFlagsInfo;
+
+        // allocate memory
+        VK_CHECK(vkAllocateMemory(logicalDevice, &memoryAllocateInfo, nullptr, &memory));
+
+        // bind vertex buffer
+        VK_CHECK(vkBindBufferMemory(logicalDevice, buffer, memory, offsets));
+    }
+
+    bool findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags props, uint32_t &memoryTypeIndex){
+        for(uint32_t i = 0; i < memoryProps.memoryTypeCount; ++i){
+            if((typeBits & (1 << i)) && (memoryProps.memoryTypes[i].propertyFlags & props) == props){
+                memoryTypeIndex = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    VkCommandBuffer beginOneTimeCommands(VkCommandPool commandPool){
+        VkCommandBufferAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandPool = commandPool;
+        allocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VK_CHECK(vkAllocateCommandBuffers(logicalDevice, &allocateInfo, &commandBuffer));
+
+        VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+        return commandBuffer;
+    }
+
+    void endOneTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool, VkQueue queue){
+        VK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+        VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        VK_CHECK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+        vkQueueWaitIdle(queue);
+
+        vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+    }
+
+    void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size){
+        // begin
         VkCommandBufferAllocateInfo copyBufferAllocateInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
         copyBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         copyBufferAllocateInfo.commandPool = commandPools[1];
@@ -888,13 +2764,771 @@ private:
         vkFreeCommandBuffers(logicalDevice, commandPools[1], 1, &copyCommandBuffer);
     }
 
-    void createTextureImage(){
-        // load image
-        int textureWidth, textureHeight, textureChannel;
-        unsigned char* img = stbi_load(ASSET_SOURCE_DIR"/viking/viking_room.png", &textureWidth, &textureHeight, &textureChannel, STBI_rgb_alpha);
-        
+    Texture createCachedTexture(const TextureKey& key){
+        bool streamed = false;
+    #if TEXTURE_STREAMING
+        streamed = createStreamedTextureImage(key);
+    #endif
+        if(!streamed)
+            createTextureImage(key.path, key.format);
+
+        // the upload path leaves its results in the scratch members
+        Texture texture;
+        texture.image = image;
+        texture.memory = imageMemory;
+        texture.view = imageView;
+        texture.sampler = createTextureSampler(key);
+        texture.layout = imageLayout;
+        texture.format = textureFormat;
+        texture.width = textureExtent.width;
+        texture.height = textureExtent.height;
+        texture.mipLevels = mipLevels;
+        texture.baseLevel = textureBaseLevel;
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements(logicalDevice, image, &memoryRequirements);
+        texture.size = memoryRequirements.size;
+        return texture;
+    }
+
+    void destroyTexture(const TextureKey& key, Texture& texture){
+        auto streamed = streamedTextures.find(key);
+        if(streamed != streamedTextures.end()){
+            cancelTextureStream(streamed->second);
+            streamedTextures.erase(streamed);
+        }
+        vkDestroySampler(logicalDevice, texture.sampler, nullptr);
+        vkDestroyImageView(logicalDevice, texture.view, nullptr);
+        vkDestroyImage(logicalDevice, texture.image, nullptr);
+        vkFreeMemory(logicalDevice, texture.memory, nullptr);
+    }
+
+    bool dropTextureMips(const TextureKey& key, Texture& texture, uint32_t dropCount){
+        if(dropCount >= texture.mipLevels)
+            return false;
+
+        // a stream still copying from the old image would swap the dropped levels back in
+        auto streamed = streamedTextures.find(key);
+        if(streamed != streamedTextures.end())
+            cancelTextureStream(streamed->second);
+
+        // smaller image holding the remaining levels
+        uint32_t levels = texture.mipLevels - dropCount;
+        uint32_t width = std::max(texture.width >> dropCount, 1u);
+        uint32_t height = std::max(texture.height >> dropCount, 1u);
+        VkImage newImage;
+        VkDeviceMemory newMemory;
+        createImage2D(width, height, levels, texture.format,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, newImage, newMemory);
+
+        // copy level i + dropCount of the old image to level i of the new one
+        VkCommandBuffer commandBuffer = beginOneTimeCommands(commandPools[0]);
+        std::vector<VkImageMemoryBarrier> imageMemoryBarriers(2, {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER});
+        imageMemoryBarriers[0].oldLayout = texture.layout;
+        imageMemoryBarriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageMemoryBarriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageMemoryBarriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        imageMemoryBarriers[0].image = texture.image;
+        imageMemoryBarriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, dropCount, levels, 0, 1};
+        imageMemoryBarriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageMemoryBarriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarriers[1].srcAccessMask = 0;
+        imageMemoryBarriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageMemoryBarriers[1].image = newImage;
+        imageMemoryBarriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+        for(auto& imageMemoryBarrier : imageMemoryBarriers){
+            imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        }
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, imageMemoryBarriers.size(), imageMemoryBarriers.data()
+        );
+
+        std::vector<VkImageCopy> imageCopies(levels);
+        for(uint32_t i = 0; i < levels; ++i){
+            imageCopies[i].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i + dropCount, 0, 1};
+            imageCopies[i].srcOffset = {0, 0, 0};
+            imageCopies[i].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+            imageCopies[i].dstOffset = {0, 0, 0};
+            imageCopies[i].extent = {std::max(width >> i, 1u), std::max(height >> i, 1u), 1};
+        }
+        vkCmdCopyImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            imageCopies.size(), imageCopies.data());
+
+        imageMemoryBarriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageMemoryBarriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageMemoryBarriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarriers[1]
+        );
+        VK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+        // same queue as the frames, so submission order covers the reads of frames already in flight and the draws after it
+        // see the copied levels. The old image and the copy's command buffer are retired instead of waited for, like a
+        // finished stream's image
+        VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        VK_CHECK(vkQueueSubmit(queues[0], 1, &submitInfo, VK_NULL_HANDLE));
+        retiredTextures.push_back({texture.image, texture.memory, texture.view, frameIndex, commandBuffer});
+
+        // swap in the new image, the sampler does not depend on the level count
+        texture.image = newImage;
+        texture.memory = newMemory;
+        createImageView(newImage, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, levels, texture.view);
+        texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        texture.width = width;
+        texture.height = height;
+        texture.mipLevels = levels;
+        texture.baseLevel += dropCount;
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements(logicalDevice, newImage, &memoryRequirements);
+        texture.size = memoryRequirements.size;
+
+        // every frame's descriptor set picks up the new view once its previous submission is done
+        if(&texture == modelTexture)
+            std::fill(textureDescriptorsDirty.begin(), textureDescriptorsDirty.end(), true);
+        return true;
+    }
+
+    void createTextureImage(const std::string& path, VkFormat format){
+        imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        textureFormat = format;
+        textureBaseLevel = 0;
+
+        // prefer pre-baked compressed levels, decode the png only when they are missing or unsupported
+    #if TEXTURE_KTX2
+        std::string compressedPath = path.substr(0, path.find_last_of('.')) + ".ktx2";
+        if(createCompressedTextureImage(compressedPath.c_str()))
+            return;
+    #endif
+
+        // images headed for the blit path are decoded straight into mapped staging memory,
+        // the loader delivers in submission order so the buffers are consumed first in first out
+        std::deque<std::pair<VkBuffer, VkDeviceMemory>> stagingBuffers;
+        auto decodeDestination = [&](const std::string&, uint32_t width, uint32_t height, size_t bytes) -> unsigned char*{
+            if(!usesBlitStaging(width, height))
+                return nullptr;
+            VkBuffer stagingBuffer;
+            VkDeviceMemory stagingMemory;
+            createBuffer(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                ), stagingBuffer, stagingMemory);
+            void* data;
+            VK_CHECK(vkMapMemory(logicalDevice, stagingMemory, 0, bytes, 0, &data));
+            stagingBuffers.push_back({stagingBuffer, stagingMemory});
+            return static_cast<unsigned char*>(data);
+        };
+
+        // decode on the worker pool, each image is uploaded here as soon as it is ready
+        TextureLoader textureLoader(threadPool, TEXTURE_DECODE_BUDGET);
+        auto decodeStart = std::chrono::high_resolution_clock::now();
+        textureLoader.load({path}, [&](const DecodedImage& decodedImage){
+            VkBuffer stagingBuffer = VK_NULL_HANDLE;
+            VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+            if(decodedImage.external){
+                stagingBuffer = stagingBuffers.front().first;
+                stagingMemory = stagingBuffers.front().second;
+                stagingBuffers.pop_front();
+                vkUnmapMemory(logicalDevice, stagingMemory);
+            }
+
+            if(decodedImage.pixels != nullptr){
+                std::cout << "Texture decode: " << decodedImage.path << (decodedImage.external ? " (into staging)" : "") << ", "
+                    << std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - decodeStart).count() << " ms" << std::endl;
+                uploadTextureImage(decodedImage.pixels, decodedImage.width, decodedImage.height, stagingBuffer);
+            }
+
+            if(stagingBuffer != VK_NULL_HANDLE){
+                vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+                vkFreeMemory(logicalDevice, stagingMemory, nullptr);
+            }
+            VK_EXPECT_TRUE((decodedImage.pixels != nullptr), "Failed to load texture image.");
+        }, decodeDestination);
+    }
+
+    bool createStreamedTextureImage(const TextureKey& key){
+        // keep every level in system memory, from the baked ktx2 or a chain built on the cpu
+        auto loadStart = std::chrono::high_resolution_clock::now();
+        StreamedTexture streamed;
+        streamed.format = key.format;
+    #if TEXTURE_KTX2
+        std::string compressedPath = key.path.substr(0, key.path.find_last_of('.')) + ".ktx2";
+        Ktx2Texture compressed;
+        if(loadKtx2(compressedPath.c_str(), compressed) && supportsCompressedTexture(compressed.format)){
+            streamed.format = compressed.format;
+            streamed.data = std::move(compressed.data);
+            streamed.levels = std::move(compressed.levels);
+        }
+    #endif
+        if(streamed.levels.empty()){
+            TextureLoader textureLoader(threadPool, TEXTURE_DECODE_BUDGET);
+            textureLoader.load({key.path}, [&](const DecodedImage& decodedImage){
+                if(decodedImage.pixels == nullptr)
+                    return;
+                MipChain chain = generateMipChain(decodedImage.pixels, decodedImage.width, decodedImage.height, isSrgbFormat(key.format), threadPool);
+                streamed.data = std::move(chain.data);
+                streamed.levels = std::move(chain.levels);
+            });
+            if(streamed.levels.empty())
+                return false;
+        }
+
+        // only the tail is uploaded now, updateTextureStreaming brings in finer levels once they are visible
+        uint32_t tailLevel = mipTailLevel(streamed.levels, TEXTURE_STREAM_TAIL_SIZE);
+        std::vector<MipLevel> tailLevels = mipLevelRange(streamed.levels, tailLevel);
+        const unsigned char* tail = streamed.data.data() + streamed.levels[tailLevel].offset;
+        imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        textureFormat = streamed.format;
+        textureExtent = {tailLevels[0].width, tailLevels[0].height};
+        mipLevels = tailLevels.size();
+        textureBaseLevel = tailLevel;
+        const char* uploadPath = "staging";
+        if(hostImageCopy && supportsHostImageCopy(textureFormat)){
+            uploadTextureHostCopy(tail, tailLevels, textureFormat);
+            uploadPath = "host image copy";
+        }
+        else
+            uploadTextureStaging(tail, tailLevels, textureFormat);
+        createImageView(image, textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, imageView);
+
+        std::cout << "Texture stream: " << key.path << " starts at level " << tailLevel << " of " << streamed.levels.size() << " ("
+            << uploadPath << ", " << (streamed.data.size() - streamed.levels[tailLevel].offset) / 1024 << " of " << streamed.data.size() / 1024 << " KB), "
+            << std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - loadStart).count() << " ms" << std::endl;
+
+        if(tailLevel > 0){
+            streamed.requestedLevel = tailLevel;
+            streamedTextures.emplace(key, std::move(streamed));
+        }
+        return true;
+    }
+
+    void updateTextureStreaming(uint32_t currentFrame){
+        // images swapped out FRAMES_IN_FLIGHT frames ago are no longer referenced by any descriptor set in flight, and the
+        // frame fence waited for has also covered any copy submitted before it
+        for(auto it = retiredTextures.begin(); it != retiredTextures.end();){
+            if(frameIndex < it->frame + FRAMES_IN_FLIGHT){
+                ++it;
+                continue;
+            }
+            if(it->commandBuffer != VK_NULL_HANDLE)
+                vkFreeCommandBuffers(logicalDevice, commandPools[0], 1, &it->commandBuffer);
+            vkDestroyImageView(logicalDevice, it->view, nullptr);
+            vkDestroyImage(logicalDevice, it->image, nullptr);
+            vkFreeMemory(logicalDevice, it->memory, nullptr);
+            it = retiredTextures.erase(it);
+        }
+
+        // the model is the only thing drawn, the texel density over its nearest surface decides the level it needs
+        auto modelStream = streamedTextures.find(modelTextureKey);
+        if(modelStream != streamedTextures.end()){
+            const auto& levels = modelStream->second.levels;
+            glm::vec3 center = glm::vec3(modelTransform * glm::vec4(modelCenter, 1.0f));
+            float distance = std::max(glm::length(cameraPosition - center) - modelRadius, 0.1f);
+            modelStream->second.requestedLevel = screenSpaceMipLevel(std::max(levels[0].width, levels[0].height), 2.0f * modelRadius,
+                distance, cameraFovY, swapchainInfo.imageExtent.height, levels.size());
+        }
+
+        // finishing a stream updates the cache, which may evict other streamed textures, so look each one up again
+        std::vector<TextureKey> keys;
+        for(const auto& entry : streamedTextures)
+            keys.push_back(entry.first);
+        for(const auto& key : keys){
+            auto it = streamedTextures.find(key);
+            const Texture* texture = textureCache.find(key);
+            if(it == streamedTextures.end() || texture == nullptr)
+                continue;
+
+            StreamedTexture& streamed = it->second;
+            if(streamed.fence != VK_NULL_HANDLE){
+                VkResult status = vkGetFenceStatus(logicalDevice, streamed.fence);
+                if(status == VK_NOT_READY)
+                    continue;
+                VK_CHECK(status);
+                finishTextureStream(key, streamed);
+                continue;
+            }
+
+            uint32_t baseLevel = streamedBaseLevel(streamed, *texture);
+            if(baseLevel != texture->baseLevel)
+                startTextureStream(streamed, *texture, baseLevel);
+        }
+
+        if(textureDescriptorsDirty[currentFrame]){
+            updateTextureDescriptors(currentFrame, 1);
+            textureDescriptorsDirty[currentFrame] = false;
+        }
+        ++frameIndex;
+    }
+
+    uint32_t streamedBaseLevel(const StreamedTexture& streamed, const Texture& texture){
+        // one level of slack before giving memory back, so a texture near a level boundary does not ping-pong
+        uint32_t level = streamed.requestedLevel;
+        if(level == texture.baseLevel + 1)
+            return texture.baseLevel;
+
+        // grow only as far as the cache budget has room for
+        if(level < texture.baseLevel){
+            VkDeviceSize used = textureCache.stats().residentBytes - texture.size;
+            VkDeviceSize budget = textureCache.getBudget();
+            VkDeviceSize end = streamed.levels.back().offset + streamed.levels.back().size;
+            while(level < texture.baseLevel && used + end - streamed.levels[level].offset > budget)
+                ++level;
+        }
+        return level;
+    }
+
+    void startTextureStream(StreamedTexture& streamed, const Texture& texture, uint32_t baseLevel){
+        const auto& levels = streamed.levels;
+        uint32_t levelCount = levels.size() - baseLevel;
+        streamed.baseLevel = baseLevel;
+        streamed.start = std::chrono::high_resolution_clock::now();
+        createImage2D(levels[baseLevel].width, levels[baseLevel].height, levelCount, streamed.format,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, streamed.image, streamed.memory);
+
+        // levels finer than the resident ones come from system memory, the rest is copied on the gpu
+        uint32_t keptLevel = std::max(baseLevel, texture.baseLevel);
+        std::vector<VkBufferImageCopy> bufferCopies;
+        if(baseLevel < texture.baseLevel){
+            VkDeviceSize size = levels[texture.baseLevel].offset - levels[baseLevel].offset;
+            createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                ), streamed.stagingBuffer, streamed.stagingMemory);
+            void* data;
+            VK_CHECK(vkMapMemory(logicalDevice, streamed.stagingMemory, 0, size, 0, &data));
+            memcpy(data, streamed.data.data() + levels[baseLevel].offset, size);
+            vkUnmapMemory(logicalDevice, streamed.stagingMemory);
+
+            for(uint32_t i = baseLevel; i < texture.baseLevel; ++i){
+                VkBufferImageCopy bufferCopy = {};
+                bufferCopy.bufferOffset = levels[i].offset - levels[baseLevel].offset;
+                bufferCopy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - baseLevel, 0, 1};
+                bufferCopy.imageExtent = {levels[i].width, levels[i].height, 1};
+                bufferCopies.push_back(bufferCopy);
+            }
+        }
+        std::vector<VkImageCopy> imageCopies;
+        for(uint32_t i = keptLevel; i < levels.size(); ++i){
+            VkImageCopy imageCopy = {};
+            imageCopy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - texture.baseLevel, 0, 1};
+            imageCopy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - baseLevel, 0, 1};
+            imageCopy.extent = {levels[i].width, levels[i].height, 1};
+            imageCopies.push_back(imageCopy);
+        }
+
+        // recorded like beginOneTimeCommands, but polled through a fence instead of waiting for the queue
+        VkCommandBufferAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandPool = commandPools[0];
+        allocateInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(logicalDevice, &allocateInfo, &streamed.commandBuffer));
+        VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(streamed.commandBuffer, &beginInfo));
+
+        // frames submitted after this one keep sampling the old image, so it returns to its layout afterwards
+        std::vector<VkImageMemoryBarrier> imageMemoryBarriers(2, {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER});
+        imageMemoryBarriers[0].oldLayout = texture.layout;
+        imageMemoryBarriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageMemoryBarriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageMemoryBarriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        imageMemoryBarriers[0].image = texture.image;
+        imageMemoryBarriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, keptLevel - texture.baseLevel, static_cast<uint32_t>(imageCopies.size()), 0, 1};
+        imageMemoryBarriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageMemoryBarriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarriers[1].srcAccessMask = 0;
+        imageMemoryBarriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageMemoryBarriers[1].image = streamed.image;
+        imageMemoryBarriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+        for(auto& imageMemoryBarrier : imageMemoryBarriers){
+            imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        }
+        vkCmdPipelineBarrier(streamed.commandBuffer,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, imageMemoryBarriers.size(), imageMemoryBarriers.data()
+        );
+
+        if(!bufferCopies.empty())
+            vkCmdCopyBufferToImage(streamed.commandBuffer, streamed.stagingBuffer, streamed.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                bufferCopies.size(), bufferCopies.data());
+        vkCmdCopyImage(streamed.commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, streamed.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            imageCopies.size(), imageCopies.data());
+
+        imageMemoryBarriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageMemoryBarriers[0].newLayout = texture.layout;
+        imageMemoryBarriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        imageMemoryBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageMemoryBarriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageMemoryBarriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageMemoryBarriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(streamed.commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, imageMemoryBarriers.size(), imageMemoryBarriers.data()
+        );
+        VK_CHECK(vkEndCommandBuffer(streamed.commandBuffer));
+
+        // same queue as the frames, so submission order covers the reads of frames already in flight
+        VkFenceCreateInfo streamFenceInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        VK_CHECK(vkCreateFence(logicalDevice, &streamFenceInfo, nullptr, &streamed.fence));
+        VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &streamed.commandBuffer;
+        VK_CHECK(vkQueueSubmit(queues[0], 1, &submitInfo, streamed.fence));
+    }
+
+    void finishTextureStream(const TextureKey& key, StreamedTexture& streamed){
+        const Texture* current = textureCache.find(key);
+        Texture texture = *current;
+        retiredTextures.push_back({texture.image, texture.memory, texture.view, frameIndex});
+
+        const MipLevel& base = streamed.levels[streamed.baseLevel];
+        texture.image = streamed.image;
+        texture.memory = streamed.memory;
+        createImageView(texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, streamed.levels.size() - streamed.baseLevel, texture.view);
+        texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        texture.width = base.width;
+        texture.height = base.height;
+        texture.mipLevels = streamed.levels.size() - streamed.baseLevel;
+        texture.baseLevel = streamed.baseLevel;
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements(logicalDevice, texture.image, &memoryRequirements);
+        texture.size = memoryRequirements.size;
+
+        endTextureStream(streamed);
+        streamed.image = VK_NULL_HANDLE;
+        streamed.memory = VK_NULL_HANDLE;
+        std::cout << "Texture stream: " << key.path << " now starts at level " << texture.baseLevel << " (" << texture.width << "x" << texture.height
+            << ", " << texture.size / 1024 << " KB), " << std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - streamed.start).count() << " ms" << std::endl;
+
+        // every frame's descriptor set picks up the new view once its previous submission is done
+        if(current == modelTexture)
+            std::fill(textureDescriptorsDirty.begin(), textureDescriptorsDirty.end(), true);
+
+        // last, the budget check may evict this very texture and its stream state with it
+        textureCache.replace(key, texture);
+    }
+
+    void endTextureStream(StreamedTexture& streamed){
+        if(streamed.fence == VK_NULL_HANDLE)
+            return;
+        VK_CHECK(vkWaitForFences(logicalDevice, 1, &streamed.fence, VK_TRUE, UINT64_MAX));
+        vkDestroyFence(logicalDevice, streamed.fence, nullptr);
+        vkFreeCommandBuffers(logicalDevice, commandPools[0], 1, &streamed.commandBuffer);
+        if(streamed.stagingBuffer != VK_NULL_HANDLE){
+            vkDestroyBuffer(logicalDevice, streamed.stagingBuffer, nullptr);
+            vkFreeMemory(logicalDevice, streamed.stagingMemory, nullptr);
+        }
+        streamed.fence = VK_NULL_HANDLE;
+        streamed.commandBuffer = VK_NULL_HANDLE;
+        streamed.stagingBuffer = VK_NULL_HANDLE;
+        streamed.stagingMemory = VK_NULL_HANDLE;
+    }
+
+    // every level of the streamed model texture on the gpu, waiting for the upload. The streaming update drops the finer
+    // levels again once they are not visible
+    void makeModelTextureResident(){
+        auto streamed = streamedTextures.find(modelTextureKey);
+        if(streamed == streamedTextures.end())
+            return;
+        if(streamed->second.fence != VK_NULL_HANDLE)
+            finishTextureStream(modelTextureKey, streamed->second);
+
+        // finishing may have evicted the stream state
+        streamed = streamedTextures.find(modelTextureKey);
+        const Texture* texture = textureCache.find(modelTextureKey);
+        if(streamed == streamedTextures.end() || texture == nullptr || texture->baseLevel == 0)
+            return;
+        startTextureStream(streamed->second, *texture, 0);
+        finishTextureStream(modelTextureKey, streamed->second);
+
+        // nothing is in flight yet, every frame's set can point at the new view right away
+        updateTextureDescriptors();
+        std::fill(textureDescriptorsDirty.begin(), textureDescriptorsDirty.end(), false);
+    }
+
+    void cancelTextureStream(StreamedTexture& streamed){
+        if(streamed.fence == VK_NULL_HANDLE)
+            return;
+        endTextureStream(streamed);
+        vkDestroyImage(logicalDevice, streamed.image, nullptr);
+        vkFreeMemory(logicalDevice, streamed.memory, nullptr);
+        streamed.image = VK_NULL_HANDLE;
+        streamed.memory = VK_NULL_HANDLE;
+    }
+
+    void createDynamicTexture(uint32_t width, uint32_t height, VkFormat format, DynamicTexture& texture){
+        texture.width = width;
+        texture.height = height;
+        texture.format = format;
+        texture.pixels.assign(size_t(width) * height * 4, 0);
+
+        VkDeviceSize sliceSize = VkDeviceSize(width) * height * 4;
+        createBuffer(sliceSize * FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            ), texture.stagingBuffer, texture.stagingMemory);
+        void* data;
+        VK_CHECK(vkMapMemory(logicalDevice, texture.stagingMemory, 0, VK_WHOLE_SIZE, 0, &data));
+        texture.staging = static_cast<uint8_t*>(data);
+
+        // images start readable, the first frame of every slot uploads the whole content
+        VkCommandBuffer commandBuffer = beginOneTimeCommands(commandPools[0]);
+        for(auto i = 0; i < FRAMES_IN_FLIGHT; ++i){
+            createImage2D(width, height, 1, format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, texture.images[i], texture.memories[i]);
+            createImageView(texture.images[i], format, VK_IMAGE_ASPECT_COLOR_BIT, 1, texture.views[i]);
+
+            VkImageMemoryBarrier imageMemoryBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageMemoryBarrier.srcAccessMask = 0;
+            imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageMemoryBarrier.image = texture.images[i];
+            imageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier
+            );
+            texture.pendingRegions[i] = {{{0, 0}, {width, height}}};
+        }
+        endOneTimeCommands(commandBuffer, commandPools[0], queues[0]);
+
+        texture.sampler = createTextureSampler(TextureKey{});
+    }
+
+    void updateDynamicTexture(DynamicTexture& texture, VkRect2D region, const uint8_t* pixels, size_t rowPitch){
+        // only system memory is written here, so this never waits for the gpu
+        region.extent.width = std::min<uint32_t>(region.extent.width, texture.width - std::min<uint32_t>(region.offset.x, texture.width));
+        region.extent.height = std::min<uint32_t>(region.extent.height, texture.height - std::min<uint32_t>(region.offset.y, texture.height));
+        if(region.extent.width == 0 || region.extent.height == 0)
+            return;
+        for(uint32_t y = 0; y < region.extent.height; ++y)
+            memcpy(texture.pixels.data() + ((size_t(region.offset.y) + y) * texture.width + region.offset.x) * 4,
+                pixels + y * rowPitch, size_t(region.extent.width) * 4);
+
+        // a slot whose regions would no longer fit its slice uploads the whole texture instead
+        uint64_t textureArea = uint64_t(texture.width) * texture.height;
+        for(auto& regions : texture.pendingRegions){
+            uint64_t area = uint64_t(region.extent.width) * region.extent.height;
+            for(const auto& pending : regions)
+                area += uint64_t(pending.extent.width) * pending.extent.height;
+            if(area >= textureArea)
+                regions = {{{0, 0}, {texture.width, texture.height}}};
+            else
+                regions.push_back(region);
+        }
+    }
+
+    void recordDynamicTextureUpload(VkCommandBuffer commandBuffer, DynamicTexture& texture, uint32_t currentFrame){
+        auto& regions = texture.pendingRegions[currentFrame];
+        if(regions.empty())
+            return;
+
+        // pack the regions tightly into this frame's slice, the frame that last read it has completed
+        VkDeviceSize offset = VkDeviceSize(texture.width) * texture.height * 4 * currentFrame;
+        std::vector<VkBufferImageCopy> bufferCopies(regions.size());
+        for(size_t i = 0; i < regions.size(); ++i){
+            const VkRect2D& region = regions[i];
+            size_t rowSize = size_t(region.extent.width) * 4;
+            for(uint32_t y = 0; y < region.extent.height; ++y)
+                memcpy(texture.staging + offset + y * rowSize,
+                    texture.pixels.data() + ((size_t(region.offset.y) + y) * texture.width + region.offset.x) * 4, rowSize);
+
+            bufferCopies[i] = {};
+            bufferCopies[i].bufferOffset = offset;
+            bufferCopies[i].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            bufferCopies[i].imageOffset = {region.offset.x, region.offset.y, 0};
+            bufferCopies[i].imageExtent = {region.extent.width, region.extent.height, 1};
+            offset += rowSize * region.extent.height;
+        }
+        regions.clear();
+
+        VkImageMemoryBarrier imageMemoryBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.image = texture.images[currentFrame];
+        imageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier
+        );
+
+        vkCmdCopyBufferToImage(commandBuffer, texture.stagingBuffer, texture.images[currentFrame], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            bufferCopies.size(), bufferCopies.data());
+
+        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier
+        );
+    }
+
+    void destroyDynamicTexture(DynamicTexture& texture){
+        vkDestroySampler(logicalDevice, texture.sampler, nullptr);
+        for(auto i = 0; i < FRAMES_IN_FLIGHT; ++i){
+            vkDestroyImageView(logicalDevice, texture.views[i], nullptr);
+            vkDestroyImage(logicalDevice, texture.images[i], nullptr);
+            vkFreeMemory(logicalDevice, texture.memories[i], nullptr);
+        }
+        vkUnmapMemory(logicalDevice, texture.stagingMemory);
+        vkDestroyBuffer(logicalDevice, texture.stagingBuffer, nullptr);
+        vkFreeMemory(logicalDevice, texture.stagingMemory, nullptr);
+    }
+
+    void updateDynamicTextureDemo(){
+        // a scrolling heatmap, one 16 row band is regenerated per frame
+        static uint32_t band = 0;
+        static auto start = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+        const uint32_t bandHeight = 16;
+        VkRect2D region = {{0, int32_t(band * bandHeight % dynamicTexture.height)}, {dynamicTexture.width, bandHeight}};
+        std::vector<uint8_t> pixels(size_t(region.extent.width) * region.extent.height * 4);
+        for(uint32_t y = 0; y < region.extent.height; ++y){
+            for(uint32_t x = 0; x < region.extent.width; ++x){
+                float u = x / float(dynamicTexture.width), v = (region.offset.y + y) / float(dynamicTexture.height);
+                float heat = 0.5f + 0.5f * std::sin(10.0f * u + time) * std::cos(10.0f * v - time * 0.7f);
+                uint8_t* texel = &pixels[(size_t(y) * region.extent.width + x) * 4];
+                texel[0] = uint8_t(255.0f * heat);
+                texel[1] = uint8_t(255.0f * (1.0f - std::abs(2.0f * heat - 1.0f)));
+                texel[2] = uint8_t(255.0f * (1.0f - heat));
+                texel[3] = 255;
+            }
+        }
+        updateDynamicTexture(dynamicTexture, region, pixels.data(), size_t(region.extent.width) * 4);
+        ++band;
+    }
+
+    bool usesBlitStaging(uint32_t width, uint32_t height){
+        // same order as the branches in uploadTextureImage
+        if(hostImageCopy && supportsHostImageCopy(textureFormat))
+            return false;
+        if(unifiedMemory && supportsLinearTexture(textureFormat, width, height, mipLevelCount(width, height)))
+            return false;
+        return supportsLinearBlit(textureFormat);
+    }
+
+    void uploadTextureImage(const unsigned char* img, uint32_t textureWidth, uint32_t textureHeight, VkBuffer stagingBuffer = VK_NULL_HANDLE){
+        mipLevels = mipLevelCount(textureWidth, textureHeight);
+        textureExtent = {textureWidth, textureHeight};
+
+        // upload, preferring paths without staging copies
+        auto uploadStart = std::chrono::high_resolution_clock::now();
+        const char* uploadPath = "staging";
+        const char* mipPath = "blit";
+        if(hostImageCopy && supportsHostImageCopy(textureFormat)){
+            // no command buffers on this path, so the chain is built on the cpu
+            MipChain chain = generateMipChain(img, textureWidth, textureHeight, isSrgbFormat(textureFormat), threadPool);
+            uploadTextureHostCopy(chain.data.data(), chain.levels, textureFormat);
+            uploadPath = "host image copy";
+            mipPath = "cpu";
+        }
+        else if(unifiedMemory && supportsLinearTexture(textureFormat, textureWidth, textureHeight, mipLevels)){
+            MipChain chain = generateMipChain(img, textureWidth, textureHeight, isSrgbFormat(textureFormat), threadPool);
+            uploadTextureLinear(chain.data.data(), chain.levels, textureFormat);
+            uploadPath = "direct (linear tiling)";
+            mipPath = "cpu";
+        }
+        else if(supportsLinearBlit(textureFormat)){
+            // the decoder may already have written the pixels into a staging buffer
+            std::vector<MipLevel> baseLevel = {{textureWidth, textureHeight, 0, size_t(textureWidth) * textureHeight * 4}};
+            if(stagingBuffer != VK_NULL_HANDLE){
+                uploadTextureFromStaging(stagingBuffer, baseLevel, textureFormat);
+                uploadPath = "staging (decoded in place)";
+            }
+            else
+                uploadTextureStaging(img, baseLevel, textureFormat);
+        }
+        else{
+            MipChain chain = generateMipChain(img, textureWidth, textureHeight, isSrgbFormat(textureFormat), threadPool);
+            uploadTextureStaging(chain.data.data(), chain.levels, textureFormat);
+            mipPath = "cpu";
+        }
+        auto uploadEnd = std::chrono::high_resolution_clock::now();
+
+        // image view
+        createImageView(image, textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, imageView);
+
+        std::cout << "Texture upload: " << uploadPath << ", " << mipLevels << " mip levels (" << mipPath << "), "
+            << std::chrono::duration<float, std::chrono::milliseconds::period>(uploadEnd - uploadStart).count() << " ms" << std::endl;
+    #if TEXTURE_UPLOAD_COMPARE
+        if(hostImageCopy && supportsHostImageCopy(textureFormat))
+            compareTextureUploads(img, textureWidth, textureHeight);
+    #endif
+    }
+
+    // the same mip chain into throwaway images, once with host image copy and once through a staging buffer, so the
+    // times only differ by the copy
+    void compareTextureUploads(const unsigned char* img, uint32_t textureWidth, uint32_t textureHeight){
+        MipChain chain = generateMipChain(img, textureWidth, textureHeight, isSrgbFormat(textureFormat), threadPool);
+        // the uploads record the layout they leave their image in, the kept image stays in its own
+        VkImage keptImage = image;
+        VkDeviceMemory keptMemory = imageMemory;
+        VkImageLayout keptLayout = imageLayout;
+        auto timeUpload = [&](const std::function<void()>& upload){
+            auto start = std::chrono::high_resolution_clock::now();
+            upload();
+            auto end = std::chrono::high_resolution_clock::now();
+            vkDestroyImage(logicalDevice, image, nullptr);
+            vkFreeMemory(logicalDevice, imageMemory, nullptr);
+            return std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+        };
+        float hostCopyTime = timeUpload([&]{ uploadTextureHostCopy(chain.data.data(), chain.levels, textureFormat); });
+        float stagingTime = timeUpload([&]{ uploadTextureStaging(chain.data.data(), chain.levels, textureFormat); });
+        image = keptImage;
+        imageMemory = keptMemory;
+        imageLayout = keptLayout;
+        std::cout << "Texture upload compare: host image copy " << hostCopyTime << " ms, staging " << stagingTime << " ms, "
+            << mipLevels << " mip levels" << std::endl;
+    }
+
+    bool createCompressedTextureImage(const char* path){
+        auto uploadStart = std::chrono::high_resolution_clock::now();
+        Ktx2Texture texture;
+        if(!loadKtx2(path, texture)){
+            std::cout << "Texture upload: failed to load " << path << ", run ktx2Converter to bake it" << std::endl;
+            return false;
+        }
+        if(!supportsCompressedTexture(texture.format)){
+            std::cout << "Texture upload: format " << texture.format << " of " << path << " is not supported" << std::endl;
+            return false;
+        }
+
+        // the file carries every level, so nothing is blitted and no pixel is decoded
+        mipLevels = texture.levels.size();
+        textureFormat = texture.format;
+        textureExtent = {texture.width, texture.height};
+        const char* uploadPath = "staging";
+        if(hostImageCopy && supportsHostImageCopy(texture.format)){
+            uploadTextureHostCopy(texture.data.data(), texture.levels, texture.format);
+            uploadPath = "host image copy";
+        }
+        else
+            uploadTextureStaging(texture.data.data(), texture.levels, texture.format);
+        auto uploadEnd = std::chrono::high_resolution_clock::now();
+
+        createImageView(image, textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, imageView);
+
+        std::cout << "Texture upload: " << uploadPath << ", " << mipLevels << " mip levels (ktx2, " << texture.data.size() / 1024 << " KB), "
+            << std::chrono::duration<float, std::chrono::milliseconds::period>(uploadEnd - uploadStart).count() << " ms" << std::endl;
+        return true;
+    }
+
+    void uploadTextureStaging(const unsigned char* img, const std::vector<MipLevel>& levels, VkFormat format){
         // staging buffer
-        VkDeviceSize size = textureWidth * textureHeight * 4;
+        VkDeviceSize size = levels.back().offset + levels.back().size;
         VkBuffer stagingBuffer;
         VkDeviceMemory stagingMemory;
         createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VkMemoryPropertyFlagBits(
@@ -906,38 +3540,158 @@ private:
         memcpy(data, img, size);
         vkUnmapMemory(logicalDevice, stagingMemory);
 
-        stbi_image_free(img);
-
-        // create image
-        createImage2D(textureWidth, textureHeight, VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, image, imageMemory);
-        
-        // copy buffer
-        copyBufferToImage(stagingBuffer, image, static_cast<uint32_t>(textureWidth), static_cast<uint32_t>(textureHeight), 1);
+        uploadTextureFromStaging(stagingBuffer, levels, format);
 
         // clean
         vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
         vkFreeMemory(logicalDevice, stagingMemory, nullptr);
+    }
 
-        // image view
-        createImageView(image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, imageView);
+    void uploadTextureFromStaging(VkBuffer stagingBuffer, const std::vector<MipLevel>& levels, VkFormat format){
+        // create image, levels missing from the staging data are blitted on the gpu
+        createImage2D(levels[0].width, levels[0].height, mipLevels, format,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, image, imageMemory);
+        
+        // copy buffer
+        copyBufferToImage(stagingBuffer, image, levels, mipLevels);
+    }
+
+    void uploadTextureLinear(const unsigned char* img, const std::vector<MipLevel>& levels, VkFormat format){
+        // sample a linear image in place when device local memory is host visible
+        createImage2D(levels[0].width, levels[0].height, levels.size(), format, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, image, imageMemory,
+            VK_IMAGE_TILING_LINEAR, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        // copy rows with the row pitch chosen by the driver
+        void* data;
+        VK_CHECK(vkMapMemory(logicalDevice, imageMemory, 0, VK_WHOLE_SIZE, 0, &data));
+        for(size_t i = 0; i < levels.size(); ++i){
+            VkImageSubresource subresource = {VK_IMAGE_ASPECT_COLOR_BIT, static_cast<uint32_t>(i), 0};
+            VkSubresourceLayout subresourceLayout;
+            vkGetImageSubresourceLayout(logicalDevice, image, &subresource, &subresourceLayout);
+
+            size_t rowSize = levels[i].width * 4;
+            for(uint32_t y = 0; y < levels[i].height; ++y)
+                memcpy(static_cast<uint8_t*>(data) + subresourceLayout.offset + y * subresourceLayout.rowPitch,
+                    img + levels[i].offset + y * rowSize, rowSize);
+        }
+        vkUnmapMemory(logicalDevice, imageMemory);
+
+        // make host writes visible to the fragment shader
+        VkCommandBuffer commandBuffer = beginOneTimeCommands(commandPools[0]);
+        VkImageMemoryBarrier imageMemoryBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.image = image;
+        imageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, static_cast<uint32_t>(levels.size()), 0, 1};
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier
+        );
+        endOneTimeCommands(commandBuffer, commandPools[0], queues[0]);
+    }
+
+    void uploadTextureHostCopy(const unsigned char* img, const std::vector<MipLevel>& levels, VkFormat format){
+        // create image that the host is allowed to copy into
+        createImage2D(levels[0].width, levels[0].height, levels.size(), format,
+            VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, image, imageMemory);
+
+        // transition on the host, no command buffer or queue submission
+        VkHostImageLayoutTransitionInfoEXT transitionInfo = {VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT};
+        transitionInfo.image = image;
+        transitionInfo.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        transitionInfo.newLayout = hostImageCopyLayout;
+        transitionInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, static_cast<uint32_t>(levels.size()), 0, 1};
+        VK_CHECK(vkTransitionImageLayout(logicalDevice, 1, &transitionInfo));
+
+        // copy decoded pixels straight into the optimal tiled image, one region per level
+        std::vector<VkMemoryToImageCopyEXT> regions(levels.size(), {VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT});
+        for(size_t i = 0; i < levels.size(); ++i){
+            regions[i].pHostPointer = img + levels[i].offset;
+            regions[i].memoryRowLength = 0;
+            regions[i].memoryImageHeight = 0;
+            regions[i].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, static_cast<uint32_t>(i), 0, 1};
+            regions[i].imageOffset = {0, 0, 0};
+            regions[i].imageExtent = {levels[i].width, levels[i].height, 1};
+        }
+
+        VkCopyMemoryToImageInfoEXT copyInfo = {VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT};
+        copyInfo.dstImage = image;
+        copyInfo.dstImageLayout = hostImageCopyLayout;
+        copyInfo.regionCount = regions.size();
+        copyInfo.pRegions = regions.data();
+        VK_CHECK(vkCopyMemoryToImage(logicalDevice, &copyInfo));
+
+        imageLayout = hostImageCopyLayout;
+    }
+
+    bool supportsHostImageCopy(VkFormat format){
+        VkFormatProperties3 formatProps3 = {VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3};
+        VkFormatProperties2 formatProps = {VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2};
+        formatProps.pNext = &formatProps3;
+        vkGetPhysicalDeviceFormatProperties2(physicalDevice, format, &formatProps);
+        VkFormatFeatureFlags2 features = VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT | VK_FORMAT_FEATURE_2_SAMPLED_IMAGE_BIT |
+            VK_FORMAT_FEATURE_2_TRANSFER_SRC_BIT;
+        return (formatProps3.optimalTilingFeatures & features) == features;
+    }
+
+    bool supportsCompressedTexture(VkFormat format){
+        // block formats also need their device feature, which createLogicalDevice enables whenever supported
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        if(format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !supportedFeatures.textureCompressionBC)
+            return false;
+        if(format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK && !supportedFeatures.textureCompressionASTC_LDR)
+            return false;
+        VkFormatProperties formatProps;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProps);
+        VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+        return (formatProps.optimalTilingFeatures & features) == features;
+    }
+
+    bool supportsLinearBlit(VkFormat format){
+        // vkCmdBlitImage with linear filtering on optimal tiled images
+        VkFormatProperties formatProps;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProps);
+        VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (formatProps.optimalTilingFeatures & features) == features;
+    }
+
+    bool supportsLinearTexture(VkFormat format, uint32_t width, uint32_t height, uint32_t levels){
+        // linear tiled images must be sampled with linear filtering
+        VkFormatProperties formatProps;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProps);
+        VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+            VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+        if((formatProps.linearTilingFeatures & features) != features)
+            return false;
+
+        VkImageFormatProperties imageFormatProps;
+        if(vkGetPhysicalDeviceImageFormatProperties(physicalDevice, format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_LINEAR,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, &imageFormatProps) != VK_SUCCESS)
+            return false;
+        return width <= imageFormatProps.maxExtent.width && height <= imageFormatProps.maxExtent.height && levels <= imageFormatProps.maxMipLevels;
     }
 
     void createDepthImage(){
-        createImage2D(windowSize.width, windowSize.height, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImage, depthMemory);
-        createImageView(depthImage, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT, depthView);
+        createImage2D(windowSize.width, windowSize.height, 1, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImage, depthMemory);
+        createImageView(depthImage, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT, 1, depthView);
     }
     
-    void createImage2D(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImage &image, VkDeviceMemory &memory){
+    void createImage2D(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VkImage &image, VkDeviceMemory &memory,
+        VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL, VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT){
         // fill image info
         VkImageCreateInfo imageInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
         imageInfo.extent = VkExtent3D{width, height, 1};
-        imageInfo.mipLevels = 1;
+        imageInfo.mipLevels = mipLevels;
         imageInfo.arrayLayers = 1;
         imageInfo.format = format;
-        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.tiling = tiling;
+        imageInfo.initialLayout = tiling == VK_IMAGE_TILING_LINEAR ? VK_IMAGE_LAYOUT_PREINITIALIZED : VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = usage;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -945,23 +3699,13 @@ private:
         // create image
         VK_CHECK(vkCreateImage(logicalDevice, &imageInfo, nullptr, &image));
         
-        // get memory properties
-        VkPhysicalDeviceMemoryProperties memoryProps;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProps);
-
         // get memory requirements
         VkMemoryRequirements memoryRequirements;
         vkGetImageMemoryRequirements(logicalDevice, image, &memoryRequirements);
         
         // get memory type index
         uint32_t memoryTypeIndex = 0;
-        VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        for(auto i = 0; i < memoryProps.memoryTypeCount; ++i){
-            if((memoryRequirements.memoryTypeBits & (1 << i)) && (memoryProps.memoryTypes[i].propertyFlags & props) == props){
-                memoryTypeIndex = i;
-                break;
-            }
-        }    
+        VK_EXPECT_TRUE(findMemoryType(memoryRequirements.memoryTypeBits, props, memoryTypeIndex), "Failed to find image memory type.");
 
         // fill memory allocate info
         VkMemoryAllocateInfo memoryAllocateInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
@@ -975,7 +3719,7 @@ private:
         VK_CHECK(vkBindImageMemory(logicalDevice, image, memory, 0));
     }
 
-    void copyBufferToImage(VkBuffer src, VkImage dst, uint32_t width, uint32_t height, uint32_t depth){
+    void copyBufferToImage(VkBuffer src, VkImage dst, const std::vector<MipLevel>& levels, uint32_t mipLevels){
         // begin
         VkCommandBufferAllocateInfo copyBufferAllocateInfo1 = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
         copyBufferAllocateInfo1.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -997,29 +3741,31 @@ private:
         imageMemoryBarrierSrc.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         imageMemoryBarrierSrc.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         imageMemoryBarrierSrc.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageMemoryBarrierSrc.image = image;
+        imageMemoryBarrierSrc.image = dst;
         imageMemoryBarrierSrc.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         imageMemoryBarrierSrc.subresourceRange.baseArrayLayer = 0;
         imageMemoryBarrierSrc.subresourceRange.baseMipLevel = 0;
         imageMemoryBarrierSrc.subresourceRange.layerCount = 1;
-        imageMemoryBarrierSrc.subresourceRange.levelCount = 1;
+        imageMemoryBarrierSrc.subresourceRange.levelCount = mipLevels;
         vkCmdPipelineBarrier(copyCommandBuffer1,
             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
             0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrierSrc
         );
 
-        // copy
-        VkBufferImageCopy bufferImageCopy;
-        bufferImageCopy.bufferOffset = 0;
-        bufferImageCopy.bufferRowLength = 0;
-        bufferImageCopy.bufferImageHeight = 0;
-        bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        bufferImageCopy.imageSubresource.mipLevel = 0;
-        bufferImageCopy.imageSubresource.baseArrayLayer = 0;
-        bufferImageCopy.imageSubresource.layerCount = 1;
-        bufferImageCopy.bufferOffset = 0;
-        bufferImageCopy.imageExtent = VkExtent3D{width, height, depth};
-        vkCmdCopyBufferToImage(copyCommandBuffer1, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
+        // copy every level present in the buffer
+        std::vector<VkBufferImageCopy> bufferImageCopies(levels.size());
+        for(size_t i = 0; i < levels.size(); ++i){
+            bufferImageCopies[i].bufferOffset = levels[i].offset;
+            bufferImageCopies[i].bufferRowLength = 0;
+            bufferImageCopies[i].bufferImageHeight = 0;
+            bufferImageCopies[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            bufferImageCopies[i].imageSubresource.mipLevel = i;
+            bufferImageCopies[i].imageSubresource.baseArrayLayer = 0;
+            bufferImageCopies[i].imageSubresource.layerCount = 1;
+            bufferImageCopies[i].imageOffset = VkOffset3D{0, 0, 0};
+            bufferImageCopies[i].imageExtent = VkExtent3D{levels[i].width, levels[i].height, 1};
+        }
+        vkCmdCopyBufferToImage(copyCommandBuffer1, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferImageCopies.size(), bufferImageCopies.data());
 
         // end
         VK_CHECK(vkEndCommandBuffer(copyCommandBuffer1));
@@ -1033,7 +3779,7 @@ private:
 
         vkFreeCommandBuffers(logicalDevice, commandPools[1], 1, &copyCommandBuffer1);
 
-        // begin
+        // begin, blits need a graphics queue
         VkCommandBufferAllocateInfo copyBufferAllocateInfo2 = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
         copyBufferAllocateInfo2.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         copyBufferAllocateInfo2.commandPool = commandPools[0];
@@ -1046,7 +3792,47 @@ private:
         copyCommandBufferBeginInfo2.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         VK_CHECK(vkBeginCommandBuffer(copyCommandBuffer2, &copyCommandBufferBeginInfo2));
 
-        // image memory barrier last
+        // blit the missing levels, each one from the level above
+        VkImageMemoryBarrier imageMemoryBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.image = dst;
+        imageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        int32_t mipWidth = levels.back().width;
+        int32_t mipHeight = levels.back().height;
+        for(uint32_t i = levels.size(); i < mipLevels; ++i){
+            imageMemoryBarrier.subresourceRange.baseMipLevel = i - 1;
+            imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(copyCommandBuffer2,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier
+            );
+
+            VkImageBlit imageBlit = {};
+            imageBlit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 1};
+            imageBlit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            mipWidth = std::max(mipWidth / 2, 1);
+            mipHeight = std::max(mipHeight / 2, 1);
+            imageBlit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+            imageBlit.dstOffsets[1] = {mipWidth, mipHeight, 1};
+            vkCmdBlitImage(copyCommandBuffer2, dst, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &imageBlit, VK_FILTER_LINEAR);
+
+            imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(copyCommandBuffer2,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier
+            );
+        }
+
+        // image memory barrier last, for levels that were written but never blitted from
+        uint32_t firstWrittenLevel = levels.size() < mipLevels ? mipLevels - 1 : 0;
         VkImageMemoryBarrier imageMemoryBarrierDst = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
         imageMemoryBarrierDst.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         imageMemoryBarrierDst.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -1054,12 +3840,12 @@ private:
         imageMemoryBarrierDst.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
         imageMemoryBarrierDst.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         imageMemoryBarrierDst.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageMemoryBarrierDst.image = image;
+        imageMemoryBarrierDst.image = dst;
         imageMemoryBarrierDst.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         imageMemoryBarrierDst.subresourceRange.baseArrayLayer = 0;
-        imageMemoryBarrierDst.subresourceRange.baseMipLevel = 0;
+        imageMemoryBarrierDst.subresourceRange.baseMipLevel = firstWrittenLevel;
         imageMemoryBarrierDst.subresourceRange.layerCount = 1;
-        imageMemoryBarrierDst.subresourceRange.levelCount = 1;
+        imageMemoryBarrierDst.subresourceRange.levelCount = mipLevels - firstWrittenLevel;
         vkCmdPipelineBarrier(copyCommandBuffer2,
             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
             0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrierDst
@@ -1078,7 +3864,7 @@ private:
         vkFreeCommandBuffers(logicalDevice, commandPools[0], 1, &copyCommandBuffer2);
     }
 
-    void createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView &imageView){
+    void createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t mipLevels, VkImageView &imageView){
         // fill image view info
         VkImageViewCreateInfo imageViewInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
         imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
@@ -1088,31 +3874,33 @@ private:
         imageViewInfo.subresourceRange.baseArrayLayer = 0;
         imageViewInfo.subresourceRange.baseMipLevel = 0;
         imageViewInfo.subresourceRange.layerCount = 1;
-        imageViewInfo.subresourceRange.levelCount = 1;
+        imageViewInfo.subresourceRange.levelCount = mipLevels;
 
         // create image view
         VK_CHECK(vkCreateImageView(logicalDevice, &imageViewInfo, nullptr, &imageView));
     }
 
-    void createTextureSampler(){
+    VkSampler createTextureSampler(const TextureKey& key){
         // fill texture sampler
         VkSamplerCreateInfo samplerInfo = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
-        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeU = key.addressMode;
+        samplerInfo.addressModeV = key.addressMode;
+        samplerInfo.addressModeW = key.addressMode;
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.anisotropyEnable = VK_FALSE;
         samplerInfo.compareEnable = VK_FALSE;
-        samplerInfo.magFilter = VK_FILTER_LINEAR;
-        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.magFilter = key.filter;
+        samplerInfo.minFilter = key.filter;
         samplerInfo.unnormalizedCoordinates = VK_FALSE;
         samplerInfo.maxAnisotropy = 1.0;
         samplerInfo.mipLodBias = 0.0;
-        samplerInfo.maxLod = 0.0;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // stays valid when the cache drops top mips
         samplerInfo.minLod = 0.0;
 
         // create texture sampler
+        VkSampler sampler;
         VK_CHECK(vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &sampler));
+        return sampler;
     }
     
     void createDescriptorPool(){
@@ -1121,6 +3909,8 @@ private:
         descriptorPoolSizes[0].descriptorCount = FRAMES_IN_FLIGHT;
         descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         descriptorPoolSizes[1].descriptorCount = FRAMES_IN_FLIGHT;
+        descriptorPoolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorPoolSizes[2].descriptorCount = FRAMES_IN_FLIGHT;
         descriptorPoolInfo.poolSizeCount = descriptorPoolSizes.size();
         descriptorPoolInfo.pPoolSizes = descriptorPoolSizes.data();
         descriptorPoolInfo.maxSets = FRAMES_IN_FLIGHT;
@@ -1148,13 +3938,13 @@ private:
             descriptorBufferInfo.range = sizeof(Uniform);
 
             // fill descriptor image info
-            VkDescriptorImageInfo descriptorImageInfo;
-            descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            descriptorImageInfo.sampler = sampler;
-            descriptorImageInfo.imageView = imageView;
+            VkDescriptorImageInfo descriptorImageInfo = textureDescriptorInfo(i);
+
+            // every frame reads the same materials
+            VkDescriptorBufferInfo materialBufferInfo = {materialBuffer, 0, VK_WHOLE_SIZE};
             
             // fill write descriptor set
-            std::vector<VkWriteDescriptorSet> writeDescriptorSets(2, {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET});
+            std::vector<VkWriteDescriptorSet> writeDescriptorSets(3, {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET});
             writeDescriptorSets[0].dstSet = descriptorSets[i];
             writeDescriptorSets[0].dstBinding = 0;
             writeDescriptorSets[0].dstArrayElement = 0;
@@ -1167,12 +3957,48 @@ private:
             writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
             writeDescriptorSets[1].descriptorCount = 1;
             writeDescriptorSets[1].pImageInfo = &descriptorImageInfo;
+            writeDescriptorSets[2].dstSet = descriptorSets[i];
+            writeDescriptorSets[2].dstBinding = 2;
+            writeDescriptorSets[2].dstArrayElement = 0;
+            writeDescriptorSets[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writeDescriptorSets[2].descriptorCount = 1;
+            writeDescriptorSets[2].pBufferInfo = &materialBufferInfo;
 
             // update descriptor set
             vkUpdateDescriptorSets(logicalDevice, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, nullptr);
         }
     }
 
+    VkDescriptorImageInfo textureDescriptorInfo([[maybe_unused]] uint32_t frame){
+        VkDescriptorImageInfo descriptorImageInfo;
+    #if TEXTURE_DYNAMIC_DEMO
+        // each frame in flight samples its own copy
+        descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        descriptorImageInfo.sampler = dynamicTexture.sampler;
+        descriptorImageInfo.imageView = dynamicTexture.views[frame];
+    #else
+        descriptorImageInfo.imageLayout = modelTexture->layout;
+        descriptorImageInfo.sampler = modelTexture->sampler;
+        descriptorImageInfo.imageView = modelTexture->view;
+    #endif
+        return descriptorImageInfo;
+    }
+
+    void updateTextureDescriptors(uint32_t firstFrame = 0, uint32_t frameCount = FRAMES_IN_FLIGHT){
+        std::vector<VkDescriptorImageInfo> descriptorImageInfos(frameCount);
+        std::vector<VkWriteDescriptorSet> writeDescriptorSets(frameCount, {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET});
+        for(uint32_t i = 0; i < frameCount; ++i){
+            descriptorImageInfos[i] = textureDescriptorInfo(firstFrame + i);
+            writeDescriptorSets[i].dstSet = descriptorSets[firstFrame + i];
+            writeDescriptorSets[i].dstBinding = 1;
+            writeDescriptorSets[i].dstArrayElement = 0;
+            writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writeDescriptorSets[i].descriptorCount = 1;
+            writeDescriptorSets[i].pImageInfo = &descriptorImageInfos[i];
+        }
+        vkUpdateDescriptorSets(logicalDevice, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, nullptr);
+    }
+
     void allocateCommandBuffer(){
         // fill command buffer allocate info
         commandBufferAllocateInfo.commandPool = commandPools[0];
@@ -1199,9 +4025,16 @@ private:
         // set uniform data
         Uniform uniform;
         uniform.model = glm::rotate(glm::identity<glm::mat4>(), time * glm::radians(30.0f), glm::vec3(0, 0, 1));
-        uniform.view = glm::lookAt(glm::vec3(2, 2, 2), glm::vec3(0, 0, 0), glm::vec3(0, 0, 1));
-        uniform.proj = glm::perspective(glm::radians(45.0f), windowSize.width / (float)windowSize.height, 0.1f, 10.0f);
+        uniform.view = glm::lookAt(cameraPosition, glm::vec3(0, 0, 0), glm::vec3(0, 0, 1));
+        // the far plane moves out with the camera so the model stays in view at impostor distance
+        float farPlane = std::max(10.0f, glm::length(cameraPosition) + 2.0f * modelRadius);
+        uniform.proj = glm::perspective(cameraFovY, windowSize.width / (float)windowSize.height, 0.1f, farPlane);
+        uniform.uvTransform = uvDequant;
+        uniform.positionScale = positionScale;
+        uniform.positionOffset = positionOffset;
+        modelTransform = uniform.model;
         uniform.proj[1][1] *= -1;
+        viewProjection = uniform.proj * uniform.view;
         memcpy(uniformData[currentFrame], &uniform, sizeof(uniform));
     }
 
@@ -1245,6 +4078,8 @@ private:
             vkDestroyFramebuffer(logicalDevice, framebuffers[i], nullptr);
         vkFreeCommandBuffers(logicalDevice, commandPools[0], commandBuffers.size(), commandBuffers.data());
         vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
+        vkDestroyPipeline(logicalDevice, prepassPipeline, nullptr);
+        vkDestroyPipeline(logicalDevice, impostorPipeline, nullptr);
         vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
         vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
         vkDestroyImageView(logicalDevice, depthView, nullptr);
@@ -1261,26 +4096,46 @@ private:
         // clean up resources
         vkDestroyShaderModule(logicalDevice, vsShaderModule, nullptr);
         vkDestroyShaderModule(logicalDevice, fsShaderModule, nullptr);
+        vkDestroyShaderModule(logicalDevice, prepassShaderModule, nullptr);
+        vkDestroyQueryPool(logicalDevice, timestampPool, nullptr);
         for(int i = 0; i < FRAMES_IN_FLIGHT; ++i){
             vkDestroySemaphore(logicalDevice, imageAvailableSemaphores[i], nullptr);
             vkDestroySemaphore(logicalDevice, renderFinishedSemaphores[i], nullptr);
             vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
         }
         cleanupSwapchain();
-        vkDestroySampler(logicalDevice, sampler, nullptr);
-        vkDestroyImageView(logicalDevice, imageView, nullptr);
-        vkDestroyImage(logicalDevice, image, nullptr);
-        vkFreeMemory(logicalDevice, imageMemory, nullptr);
+    #if TEXTURE_DYNAMIC_DEMO
+        destroyDynamicTexture(dynamicTexture);
+    #endif
+        textureCache.release(modelTextureKey);
+        textureCache.printStats(std::cout);
+        textureCache.clear();
+        for(const auto& retired : retiredTextures){
+            if(retired.commandBuffer != VK_NULL_HANDLE)
+                vkFreeCommandBuffers(logicalDevice, commandPools[0], 1, &retired.commandBuffer);
+            vkDestroyImageView(logicalDevice, retired.view, nullptr);
+            vkDestroyImage(logicalDevice, retired.image, nullptr);
+            vkFreeMemory(logicalDevice, retired.memory, nullptr);
+        }
         for(auto i = 0; i < FRAMES_IN_FLIGHT; ++i){
             vkDestroyBuffer(logicalDevice, uniformBuffer[i], nullptr);
             vkFreeMemory(logicalDevice, uniformMemory[i], nullptr);
         }
         vkDestroyBuffer(logicalDevice, vertexBuffer, nullptr);
         vkFreeMemory(logicalDevice, vertexMemory, nullptr);
+        vkDestroyBuffer(logicalDevice, positionBuffer, nullptr);
+        vkFreeMemory(logicalDevice, positionMemory, nullptr);
         vkDestroyBuffer(logicalDevice, indexBuffer, nullptr);
         vkFreeMemory(logicalDevice, indexMemory, nullptr);
+        vkDestroyBuffer(logicalDevice, materialBuffer, nullptr);
+        vkFreeMemory(logicalDevice, materialMemory, nullptr);
+        for(auto i = 0; i < FRAMES_IN_FLIGHT; ++i){
+            vkDestroyBuffer(logicalDevice, indirectBuffer[i], nullptr);
+            vkFreeMemory(logicalDevice, indirectMemory[i], nullptr);
+        }
         vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
         vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+        destroyImpostor();
         vkDestroyCommandPool(logicalDevice, commandPools[0], nullptr);
         vkDestroyCommandPool(logicalDevice, commandPools[1], nullptr);
         vkDestroyDevice(logicalDevice, nullptr);
@@ -1294,6 +4149,13 @@ private:
         App* app = reinterpret_cast<App*>(glfwGetWindowUserPointer(window));
         app->framebufferResized = true;
     }
+
+    // the mouse wheel moves the camera along its line to the origin, far enough out for the impostor to show
+    static void scrollCallback(GLFWwindow* window, double, double yOffset){
+        App* app = reinterpret_cast<App*>(glfwGetWindowUserPointer(window));
+        float distance = glm::length(app->cameraPosition) * std::pow(CAMERA_ZOOM_STEP, float(-yOffset));
+        app->cameraPosition = glm::normalize(app->cameraPosition) * glm::clamp(distance, 0.5f, 1000.0f);
+    }
 };
 
 int main(){
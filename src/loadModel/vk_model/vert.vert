@@ -1,21 +1,115 @@
 #version 450
 
-layout (location = 0) in vec3 aPos;
+#ifdef VERTEX_PULLING
+#extension GL_EXT_buffer_reference : require
+
+// no vertex input state, vertices and indices are read as 4 byte words through buffer device addresses
+layout (buffer_reference, std430, buffer_reference_align = 4) readonly buffer Words{
+    uint words[];
+};
+
+const uint PULL_COMPACT = 1u; // CompactVertex instead of Vertex
+const uint PULL_HALF_POSITION = 2u;
+const uint PULL_COLOR = 4u;
+const uint PULL_INDICES = 8u; // non-indexed draw, the index comes from the index buffer too
+const uint PULL_SHORT_INDICES = 16u;
+
+layout (push_constant) uniform Pull{
+    Words vertices;
+    Words indices;
+    uint stride; // in words
+    uint flags;
+}pull;
+#else
+layout (location = 0) in vec4 aPos;
+#ifndef DEPTH_ONLY
+#ifdef VERTEX_COLOR
 layout (location = 1) in vec3 aCol;
+#endif
 layout (location = 2) in vec2 aUv;
+#endif
+#endif
+
+#ifndef DEPTH_ONLY
 layout (location = 0) out vec4 color;
 layout (location = 1) out vec2 texcoord;
+layout (location = 2) flat out uint material; // every draw passes its material as the first instance
+#endif
+
+// the depth prepass and the color pass have to agree on depth exactly
+invariant gl_Position;
 
 layout (set = 0, binding = 0) uniform UBO{
     float padding;
     mat4 model;
     mat4 view;
     mat4 proj;
+    vec4 uvTransform;
+    vec4 positionScale;
+    vec4 positionOffset;
 }ubo;
 
+#ifdef VERTEX_PULLING
+uint pullIndex(){
+    uint corner = uint(gl_VertexIndex);
+    if((pull.flags & PULL_INDICES) == 0u)
+        return corner;
+    if((pull.flags & PULL_SHORT_INDICES) == 0u)
+        return pull.indices.words[corner];
+    uint pair = pull.indices.words[corner >> 1];
+    return (corner & 1u) != 0u ? pair >> 16 : pair & 0xffffu;
+}
+
+// decoded the same way the vertex input formats of Vertex and CompactVertex are
+vec4 pullPosition(uint base){
+    if((pull.flags & PULL_COMPACT) == 0u)
+        return vec4(uintBitsToFloat(uvec3(pull.vertices.words[base], pull.vertices.words[base + 1], pull.vertices.words[base + 2])), 1);
+    uint xy = pull.vertices.words[base], zw = pull.vertices.words[base + 1];
+    if((pull.flags & PULL_HALF_POSITION) != 0u)
+        return vec4(unpackHalf2x16(xy), unpackHalf2x16(zw));
+    return vec4(unpackSnorm2x16(xy), unpackSnorm2x16(zw));
+}
+
+vec3 pullColor(uint base){
+    if((pull.flags & PULL_COMPACT) == 0u)
+        return uintBitsToFloat(uvec3(pull.vertices.words[base + 3], pull.vertices.words[base + 4], pull.vertices.words[base + 5]));
+    if((pull.flags & PULL_COLOR) != 0u)
+        return unpackUnorm4x8(pull.vertices.words[base + 3]).rgb;
+    return vec3(1);
+}
+
+vec2 pullTexcoord(uint base){
+    if((pull.flags & PULL_COMPACT) == 0u)
+        return uintBitsToFloat(uvec2(pull.vertices.words[base + 6], pull.vertices.words[base + 7]));
+    return unpackUnorm2x16(pull.vertices.words[base + 2]);
+}
+#endif
+
 void main(){
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(aPos, 1);
+#ifdef VERTEX_PULLING
+    uint base = pullIndex() * pull.stride;
+    vec4 position = pullPosition(base);
+#else
+    vec4 position = aPos;
+#endif
+
+    // quantized positions come in normalized to the model bounds, float ones with scale 1 and offset 0
+    vec3 pos = position.xyz * ubo.positionScale.xyz + ubo.positionOffset.xyz;
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(pos, 1);
 
+#ifndef DEPTH_ONLY
+#ifdef VERTEX_PULLING
+    color = vec4(pullColor(base), 1);
+    vec2 uv = pullTexcoord(base);
+#else
+#ifdef VERTEX_COLOR
     color = vec4(aCol, 1);
-    texcoord = aUv;
-}
\ No newline at end of file
+#else
+    color = vec4(1);
+#endif
+    vec2 uv = aUv;
+#endif
+    texcoord = uv * ubo.uvTransform.xy + ubo.uvTransform.zw;
+    material = uint(gl_InstanceIndex);
+#endif
+}
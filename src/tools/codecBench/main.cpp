@@ -0,0 +1,132 @@
+#include "common/meshCodec.h"
+#include "common/meshOptimizer.h"
+#include "common/vertexQuantize.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+    constexpr uint32_t GRID_SIZE = 512;
+    constexpr int REPEAT_CNT = 10;
+
+    // the layouts the model loader uploads, floats and the quantized one
+    struct Vertex {
+        float pos[3];
+        float col[3];
+        float texcoord[2];
+    };
+
+    struct CompactVertex {
+        int16_t pos[4];
+        uint16_t texcoord[2];
+    };
+
+    // best of several runs, in gigabytes of decoded data per second
+    float measure(size_t bytes, const std::function<void()>& kernel) {
+        float best = 0.0f;
+        for (int i = 0; i < REPEAT_CNT; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            kernel();
+            auto end = std::chrono::high_resolution_clock::now();
+            float seconds = std::chrono::duration<float>(end - start).count();
+            best = std::max(best, bytes / seconds / 1e9f);
+        }
+        return best;
+    }
+
+    void reportVertices(const char* name, const void* vertices, size_t vertexCnt, size_t vertexSize) {
+        size_t rawSize = vertexCnt * vertexSize;
+        std::vector<uint8_t> encoded(encodeVertexBufferBound(vertexCnt, vertexSize));
+        size_t encodedSize = 0;
+        float encodeRate = measure(rawSize, [&] {
+            encodedSize = encodeVertexBuffer(encoded.data(), encoded.size(), vertices, vertexCnt, vertexSize);
+        });
+
+        std::vector<uint8_t> scalar(rawSize), vector(rawSize);
+        bool valid = true;
+        float scalarRate = measure(rawSize, [&] {
+            valid &= decodeVertexBufferScalar(scalar.data(), vertexCnt, vertexSize, encoded.data(), encodedSize);
+        });
+        float vectorRate = measure(rawSize, [&] {
+            valid &= decodeVertexBuffer(vector.data(), vertexCnt, vertexSize, encoded.data(), encodedSize);
+        });
+        bool match = valid && memcmp(scalar.data(), vertices, rawSize) == 0 && scalar == vector;
+        std::cout << name << ": " << rawSize / 1024 << " KB to " << encodedSize / 1024 << " KB (" << float(rawSize) / encodedSize
+            << "x), encode " << encodeRate << " GB/s, decode scalar " << scalarRate << " GB/s, " << meshCodecIsa() << " " << vectorRate
+            << " GB/s (" << vectorRate / scalarRate << "x)" << (match ? "" : ", MISMATCH") << std::endl;
+    }
+
+    // triangles may come back rotated, anything else is a mismatch
+    template<typename Index>
+    void reportIndices(const char* name, const std::vector<uint32_t>& indices) {
+        std::vector<Index> raw(indices.begin(), indices.end()), decoded(raw.size());
+        size_t rawSize = raw.size() * sizeof(Index);
+        std::vector<uint8_t> encoded(encodeIndexBufferBound(raw.size()));
+        size_t encodedSize = 0;
+        float encodeRate = measure(rawSize, [&] {
+            encodedSize = encodeIndexBuffer(encoded.data(), encoded.size(), raw.data(), raw.size(), sizeof(Index));
+        });
+        bool match = true;
+        float decodeRate = measure(rawSize, [&] {
+            match &= decodeIndexBuffer(decoded.data(), decoded.size(), sizeof(Index), encoded.data(), encodedSize);
+        });
+        for (size_t i = 0; i < raw.size() && match; i += 3) {
+            bool rotated = false;
+            for (size_t r = 0; r < 3; ++r)
+                rotated |= decoded[i] == raw[i + r] && decoded[i + 1] == raw[i + (r + 1) % 3] && decoded[i + 2] == raw[i + (r + 2) % 3];
+            match = rotated;
+        }
+        std::cout << name << ": " << rawSize / 1024 << " KB to " << encodedSize / 1024 << " KB (" << float(rawSize) / encodedSize
+            << "x, " << encodedSize * 8.0f / (raw.size() / 3) << " bits per triangle), encode " << encodeRate << " GB/s, decode "
+            << decodeRate << " GB/s" << (match ? "" : ", MISMATCH") << std::endl;
+    }
+}
+
+int main() {
+    // a rolling height field, cache optimized and renumbered in fetch order like the loader does with MODEL_OPTIMIZE
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+    uint32_t side = GRID_SIZE + 1;
+    std::vector<Vertex> grid(side * side);
+    for (uint32_t y = 0; y < side; ++y) {
+        for (uint32_t x = 0; x < side; ++x) {
+            float u = float(x) / GRID_SIZE, v = float(y) / GRID_SIZE;
+            float height = 0.1f * std::sin(u * 12.0f) * std::cos(v * 9.0f) + noise(random);
+            grid[y * side + x] = {{u * 2.0f - 1.0f, height, v * 2.0f - 1.0f}, {1.0f, 1.0f, 1.0f}, {u, v}};
+        }
+    }
+    std::vector<uint32_t> gridIndices;
+    for (uint32_t y = 0; y < GRID_SIZE; ++y) {
+        for (uint32_t x = 0; x < GRID_SIZE; ++x) {
+            uint32_t a = y * side + x, b = a + 1, c = a + side, d = c + 1;
+            gridIndices.insert(gridIndices.end(), {a, c, b, b, c, d});
+        }
+    }
+
+    std::vector<uint32_t> indices(gridIndices.size());
+    optimizeVertexCache(indices.data(), gridIndices.data(), gridIndices.size(), grid.size());
+    std::vector<Vertex> vertices(grid.size());
+    vertices.resize(optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), grid.data(), grid.size(), sizeof(Vertex)));
+
+    std::vector<CompactVertex> compact(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        for (size_t c = 0; c < 3; ++c)
+            compact[i].pos[c] = quantizeSnorm16(vertices[i].pos[c]);
+        compact[i].pos[3] = 32767;
+        compact[i].texcoord[0] = quantizeUnorm16(vertices[i].texcoord[0]);
+        compact[i].texcoord[1] = quantizeUnorm16(vertices[i].texcoord[1]);
+    }
+
+    std::cout << vertices.size() << " vertices, " << indices.size() / 3 << " triangles" << std::endl;
+    reportVertices("float vertices", vertices.data(), vertices.size(), sizeof(Vertex));
+    reportVertices("compact vertices", compact.data(), compact.size(), sizeof(CompactVertex));
+    reportIndices<uint32_t>("32-bit indices", indices);
+    if (vertices.size() <= UINT16_MAX + 1)
+        reportIndices<uint16_t>("16-bit indices", indices);
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "common/vertexDedup.h"
+#include "common/threadPool.h"
+#include "common/objParser.h"
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    // same layout as the vertex of vk_model
+    struct Vertex {
+        float pos[3];
+        float col[3];
+        float texcoord[2];
+
+        bool operator==(const Vertex& other) const {
+            return memcmp(this, &other, sizeof(Vertex)) == 0;
+        }
+    };
+
+    // the hash vk_model used with std::unordered_map, glm combines components boost style
+    struct LegacyVertexHash {
+        static void combine(size_t& seed, float value) {
+            seed ^= std::hash<float>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+
+        size_t operator()(const Vertex& vertex) const {
+            size_t pos = 0, col = 0, texcoord = 0;
+            for (float value : vertex.pos)
+                combine(pos, value);
+            for (float value : vertex.col)
+                combine(col, value);
+            for (float value : vertex.texcoord)
+                combine(texcoord, value);
+            return ((pos ^ (col << 1)) >> 1) ^ (texcoord << 1);
+        }
+    };
+
+    float elapsedMs(const std::function<void()>& func) {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // one corner per index like loadModel, the grid shares every inner vertex between six corners
+    std::vector<Vertex> gridCorners(uint32_t quads) {
+        std::vector<Vertex> corners;
+        corners.reserve(size_t(quads) * quads * 6);
+        auto corner = [&](uint32_t x, uint32_t y) {
+            Vertex vertex = {{float(x), float(y), 0.0f}, {1.0f, 1.0f, 1.0f}, {x / float(quads), 1.0f - y / float(quads)}};
+            corners.push_back(vertex);
+        };
+        for (uint32_t y = 0; y < quads; ++y) {
+            for (uint32_t x = 0; x < quads; ++x) {
+                corner(x, y), corner(x + 1, y), corner(x + 1, y + 1);
+                corner(x, y), corner(x + 1, y + 1), corner(x, y + 1);
+            }
+        }
+        return corners;
+    }
+
+    bool objCorners(const char* path, std::vector<Vertex>& corners) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path)) {
+            std::cout << warn << err << std::endl;
+            return false;
+        }
+        for (const auto& shape : shapes) {
+            for (const auto& index : shape.mesh.indices) {
+                Vertex vertex = {};
+                memcpy(vertex.pos, &attrib.vertices[3 * index.vertex_index], sizeof(vertex.pos));
+                if (index.texcoord_index >= 0) {
+                    vertex.texcoord[0] = attrib.texcoords[2 * index.texcoord_index + 0];
+                    vertex.texcoord[1] = 1.0f - attrib.texcoords[2 * index.texcoord_index + 1];
+                }
+                vertex.col[0] = vertex.col[1] = vertex.col[2] = 1.0f;
+                corners.push_back(vertex);
+            }
+        }
+        return true;
+    }
+
+    bool fastObjCorners(const char* path, std::vector<Vertex>& corners, ThreadPool& threadPool) {
+        ObjMesh mesh;
+        std::string error;
+        if (!loadObj(path, mesh, threadPool, error)) {
+            std::cout << error << std::endl;
+            return false;
+        }
+        corners.resize(mesh.indices.size());
+        for (size_t i = 0; i < mesh.indices.size(); ++i) {
+            const ObjIndex& index = mesh.indices[i];
+            Vertex& vertex = corners[i];
+            vertex = {};
+            memcpy(vertex.pos, &mesh.positions[3 * index.position], sizeof(vertex.pos));
+            if (index.texcoord >= 0) {
+                vertex.texcoord[0] = mesh.texcoords[2 * index.texcoord + 0];
+                vertex.texcoord[1] = 1.0f - mesh.texcoords[2 * index.texcoord + 1];
+            }
+            vertex.col[0] = vertex.col[1] = vertex.col[2] = 1.0f;
+        }
+        return true;
+    }
+
+    void bench(const char* name, const std::vector<Vertex>& corners, ThreadPool& threadPool) {
+        size_t cornerCnt = corners.size();
+        std::cout << name << ": " << cornerCnt / 3 << " triangles, " << cornerCnt << " corners" << std::endl;
+
+        // what loadModel did, count then operator[]
+        std::vector<Vertex> legacyVertices;
+        std::vector<uint32_t> legacyIndices;
+        float legacyMs = elapsedMs([&] {
+            std::unordered_map<Vertex, uint32_t, LegacyVertexHash> uniqueVertices;
+            for (const auto& vertex : corners) {
+                if (uniqueVertices.count(vertex) == 0) {
+                    uniqueVertices[vertex] = legacyVertices.size();
+                    legacyVertices.push_back(vertex);
+                }
+                legacyIndices.push_back(uniqueVertices[vertex]);
+            }
+        });
+
+        std::vector<Vertex> serialVertices(cornerCnt), parallelVertices(cornerCnt);
+        std::vector<uint32_t> serialIndices(cornerCnt), parallelIndices(cornerCnt);
+        size_t serialCnt = 0, parallelCnt = 0;
+        float serialMs = elapsedMs([&] {
+            serialCnt = dedupVertices(corners.data(), cornerCnt, sizeof(Vertex), serialVertices.data(), serialIndices.data());
+        });
+        float parallelMs = elapsedMs([&] {
+            parallelCnt = dedupVerticesParallel(corners.data(), cornerCnt, sizeof(Vertex), parallelVertices.data(), parallelIndices.data(), threadPool);
+        });
+        serialVertices.resize(serialCnt);
+        parallelVertices.resize(parallelCnt);
+
+        // every method has to number vertices in first occurrence order
+        bool serialMatch = serialVertices == legacyVertices && serialIndices == legacyIndices;
+        bool parallelMatch = parallelVertices == legacyVertices && parallelIndices == legacyIndices;
+        std::cout << "    " << legacyVertices.size() << " unique" << std::endl;
+        std::cout << "    unordered_map: " << legacyMs << " ms" << std::endl;
+        std::cout << "    flat table: " << serialMs << " ms (" << legacyMs / serialMs << "x)" << (serialMatch ? "" : ", MISMATCH") << std::endl;
+        std::cout << "    flat table, " << threadPool.size() << " threads: " << parallelMs << " ms (" << legacyMs / parallelMs << "x)"
+            << (parallelMatch ? "" : ", MISMATCH") << std::endl;
+    }
+}
+
+// usage: dedupBench [model.obj ...], without arguments a 2M triangle grid is used, with them tinyobj is also
+// timed against the mapped parser
+int main(int argc, char** argv) {
+    ThreadPool threadPool;
+    if (argc < 2) {
+        bench("grid", gridCorners(1024), threadPool);
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::vector<Vertex> corners;
+        float parseMs = elapsedMs([&] {
+            objCorners(argv[i], corners);
+        });
+        std::cout << "parse " << argv[i] << ": " << parseMs << " ms" << std::endl;
+
+        // the mapped parser has to produce the same corners as tinyobj
+        std::vector<Vertex> fastCorners;
+        bool fastOk = false;
+        float fastMs = elapsedMs([&] {
+            fastOk = fastObjCorners(argv[i], fastCorners, threadPool);
+        });
+        if (fastOk) {
+            std::cout << "parse " << argv[i] << ", " << threadPool.size() << " threads: " << fastMs << " ms (" << parseMs / fastMs << "x)"
+                << (fastCorners == corners ? "" : ", MISMATCH") << std::endl;
+        }
+        if (!corners.empty())
+            bench(argv[i], corners, threadPool);
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "common/ktx2.h"
+#include "common/bcEncoder.h"
+#include "common/mipmap.h"
+#include "common/threadPool.h"
+
+#include <stb_image.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace {
+    struct Options {
+        BlockFormat format = BlockFormat::BC7;
+        bool srgb = true;
+    };
+
+    VkFormat toVkFormat(BlockFormat format, bool srgb) {
+        switch (format) {
+        case BlockFormat::BC1:
+            return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case BlockFormat::BC3:
+            return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        default:
+            return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        }
+    }
+
+    bool convert(const std::filesystem::path& input, const std::filesystem::path& output, const Options& options, ThreadPool& threadPool) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        int width, height, channel;
+        unsigned char* img = stbi_load(input.string().c_str(), &width, &height, &channel, STBI_rgb_alpha);
+        if (img == nullptr) {
+            std::cerr << "Failed to load " << input.string() << ": " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+
+        // mips are filtered on the decoded image, then every level is compressed on its own
+        MipChain chain = generateMipChain(img, width, height, options.srgb, threadPool);
+        stbi_image_free(img);
+
+        Ktx2Texture texture;
+        texture.format = toVkFormat(options.format, options.srgb);
+        texture.width = width;
+        texture.height = height;
+        for (const MipLevel& level : chain.levels) {
+            std::vector<uint8_t> blocks = compressImage(options.format, chain.data.data() + level.offset, level.width, level.height, threadPool);
+            texture.levels.push_back({level.width, level.height, texture.data.size(), blocks.size()});
+            texture.data.insert(texture.data.end(), blocks.begin(), blocks.end());
+        }
+
+        if (!writeKtx2(output.string(), texture)) {
+            std::cerr << "Failed to write " << output.string() << std::endl;
+            return false;
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << input.string() << " -> " << output.string() << ", " << texture.levels.size() << " mip levels, "
+            << chain.data.size() / 1024 << " KB -> " << texture.data.size() / 1024 << " KB, "
+            << std::chrono::duration<float, std::milli>(end - start).count() << " ms" << std::endl;
+        return true;
+    }
+
+    bool isImage(const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        return extension == ".png" || extension == ".jpg" || extension == ".jpeg";
+    }
+
+    void printUsage() {
+        std::cout << "usage: ktx2Converter [--format bc1|bc3|bc7] [--linear] [input output]" << std::endl;
+        std::cout << "without input every png/jpg under img/ is converted next to its source" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "bc1")
+                options.format = BlockFormat::BC1;
+            else if (format == "bc3")
+                options.format = BlockFormat::BC3;
+            else if (format == "bc7")
+                options.format = BlockFormat::BC7;
+            else {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--linear") == 0)
+            options.srgb = false;
+        else if (strcmp(argv[i], "--help") == 0) {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+
+    ThreadPool threadPool;
+    bool result = true;
+    if (files.size() == 2)
+        result = convert(files[0], files[1], options, threadPool);
+    else if (files.empty()) {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(HOME_DIR"/img")) {
+            if (!entry.is_regular_file() || !isImage(entry.path()))
+                continue;
+            std::filesystem::path output = entry.path();
+            output.replace_extension(".ktx2");
+            result = convert(entry.path(), output, options, threadPool) && result;
+        }
+    }
+    else {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
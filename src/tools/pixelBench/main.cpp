@@ -0,0 +1,101 @@
+#include "common/pixelConvert.h"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+    constexpr size_t PIXEL_CNT = 4096 * 4096;
+    constexpr int REPEAT_CNT = 10;
+
+    // best of several runs, in megapixels per second
+    float measure(const std::function<void()>& kernel) {
+        float best = 0.0f;
+        for (int i = 0; i < REPEAT_CNT; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            kernel();
+            auto end = std::chrono::high_resolution_clock::now();
+            float seconds = std::chrono::duration<float>(end - start).count();
+            best = std::max(best, PIXEL_CNT / seconds / 1e6f);
+        }
+        return best;
+    }
+
+    void report(const char* name, const std::function<void()>& scalar, const std::function<void()>& vector, bool match) {
+        float scalarRate = measure(scalar);
+        float vectorRate = measure(vector);
+        std::cout << name << ": scalar " << scalarRate << " MPix/s, " << pixelConvertIsa() << " " << vectorRate << " MPix/s ("
+            << vectorRate / scalarRate << "x)" << (match ? "" : ", MISMATCH") << std::endl;
+    }
+}
+
+int main() {
+    std::mt19937 random(42);
+    std::vector<uint8_t> rgba(PIXEL_CNT * 4), rgb(PIXEL_CNT * 3);
+    for (auto& value : rgba)
+        value = static_cast<uint8_t>(random());
+    for (auto& value : rgb)
+        value = static_cast<uint8_t>(random());
+    std::vector<float> linear(PIXEL_CNT * 4);
+    std::uniform_real_distribution<float> distribution(-0.1f, 1.1f);
+    for (auto& value : linear)
+        value = distribution(random);
+
+    std::vector<uint8_t> scalarBytes(PIXEL_CNT * 4), vectorBytes(PIXEL_CNT * 4);
+    std::vector<float> scalarFloats(PIXEL_CNT * 4), vectorFloats(PIXEL_CNT * 4);
+    std::vector<uint16_t> scalarHalves(PIXEL_CNT * 4), vectorHalves(PIXEL_CNT * 4);
+    const uint8_t bgra[4] = {2, 1, 0, 3};
+
+    expandRgbToRgbaScalar(rgb.data(), scalarBytes.data(), PIXEL_CNT);
+    expandRgbToRgba(rgb.data(), vectorBytes.data(), PIXEL_CNT);
+    report("rgb to rgba",
+        [&] { expandRgbToRgbaScalar(rgb.data(), scalarBytes.data(), PIXEL_CNT); },
+        [&] { expandRgbToRgba(rgb.data(), vectorBytes.data(), PIXEL_CNT); },
+        scalarBytes == vectorBytes);
+
+    swizzleRgbaScalar(rgba.data(), scalarBytes.data(), PIXEL_CNT, bgra);
+    swizzleRgba(rgba.data(), vectorBytes.data(), PIXEL_CNT, bgra);
+    report("swizzle bgra",
+        [&] { swizzleRgbaScalar(rgba.data(), scalarBytes.data(), PIXEL_CNT, bgra); },
+        [&] { swizzleRgba(rgba.data(), vectorBytes.data(), PIXEL_CNT, bgra); },
+        scalarBytes == vectorBytes);
+
+    premultiplyAlphaScalar(rgba.data(), scalarBytes.data(), PIXEL_CNT);
+    premultiplyAlpha(rgba.data(), vectorBytes.data(), PIXEL_CNT);
+    report("premultiply",
+        [&] { premultiplyAlphaScalar(rgba.data(), scalarBytes.data(), PIXEL_CNT); },
+        [&] { premultiplyAlpha(rgba.data(), vectorBytes.data(), PIXEL_CNT); },
+        scalarBytes == vectorBytes);
+
+    srgbToLinearScalar(rgba.data(), scalarFloats.data(), PIXEL_CNT);
+    srgbToLinear(rgba.data(), vectorFloats.data(), PIXEL_CNT);
+    report("srgb to linear",
+        [&] { srgbToLinearScalar(rgba.data(), scalarFloats.data(), PIXEL_CNT); },
+        [&] { srgbToLinear(rgba.data(), vectorFloats.data(), PIXEL_CNT); },
+        scalarFloats == vectorFloats);
+
+    linearToSrgbScalar(linear.data(), scalarBytes.data(), PIXEL_CNT);
+    linearToSrgb(linear.data(), vectorBytes.data(), PIXEL_CNT);
+    report("linear to srgb",
+        [&] { linearToSrgbScalar(linear.data(), scalarBytes.data(), PIXEL_CNT); },
+        [&] { linearToSrgb(linear.data(), vectorBytes.data(), PIXEL_CNT); },
+        scalarBytes == vectorBytes);
+
+    unormToHalfScalar(rgba.data(), scalarHalves.data(), PIXEL_CNT * 4);
+    unormToHalf(rgba.data(), vectorHalves.data(), PIXEL_CNT * 4);
+    report("unorm8 to half",
+        [&] { unormToHalfScalar(rgba.data(), scalarHalves.data(), PIXEL_CNT * 4); },
+        [&] { unormToHalf(rgba.data(), vectorHalves.data(), PIXEL_CNT * 4); },
+        scalarHalves == vectorHalves);
+
+    // in place expansion, rgb written into the tail of the rgba buffer like the texture decoder does
+    std::vector<uint8_t> inPlace(PIXEL_CNT * 4);
+    memcpy(inPlace.data() + PIXEL_CNT, rgb.data(), rgb.size());
+    expandRgbToRgba(inPlace.data() + PIXEL_CNT, inPlace.data(), PIXEL_CNT);
+    expandRgbToRgbaScalar(rgb.data(), scalarBytes.data(), PIXEL_CNT);
+    std::cout << "rgb to rgba in place: " << (inPlace == scalarBytes ? "ok" : "MISMATCH") << std::endl;
+    return 0;
+}